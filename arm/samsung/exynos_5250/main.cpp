@@ -28,43 +28,7 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <string.h>
 #include <time.h>
 #include <omp.h>
-
-/* ================================================================ */
-/* Find cycles elapsed */
-namespace cpu {
-	
-	inline static uint32_t get_ticks_acquire() {
-		struct timespec ts;
-		clock_gettime(CLOCK_MONOTONIC, &ts);
-		return ts.tv_sec * 1000000000ull + ts.tv_nsec;
-	}
-
-	inline static uint64_t get_ticks_release() {
-		struct timespec ts;
-		clock_gettime(CLOCK_MONOTONIC, &ts);
-		return ts.tv_sec * 1000000000ull + ts.tv_nsec;
-	}
-
-}
-/* ================================================================ */
-
-
-/* ================================================================ */
-/* Find difference in time to get elapsed time */
-timespec diff(timespec start, timespec end)
-{
-	timespec temp;
-	if ((end.tv_nsec-start.tv_nsec)<0) {
-		temp.tv_sec = end.tv_sec-start.tv_sec-1;
-		temp.tv_nsec = 1000000000+end.tv_nsec-start.tv_nsec;
-	} else {
-		temp.tv_sec = end.tv_sec-start.tv_sec;
-		temp.tv_nsec = end.tv_nsec-start.tv_nsec;
-	}
-	return temp;
-}
-/* ================================================================ */
-
+#include "timer.h"
 
 extern "C" void sumsq(const double* data, size_t length);
 extern "C" void sumsqf(const float* data, size_t length);
@@ -72,9 +36,9 @@ extern "C" void sumsqf(const float* data, size_t length);
 
 int main(int argc, char** argv) {
 
-	/* Timers */
-	timespec time1, time2, time3;
-	timespec time4, time5, time6;
+	/* Timer */
+	uint64_t start0, end0, start1, end1;
+	timer::init ();
 
 	/* Array size */
 	const size_t array_length = 64 * 1024 * 1024;
@@ -96,20 +60,17 @@ int main(int argc, char** argv) {
 				{
 					printf ("Executing double precision benchmak on core 0\n");
 
-					clock_gettime (CLOCK_MONOTONIC, &time1);
-					/* const uint32_t start0 = cpu::get_ticks_acquire (); */
+					start0 = timer::get_ticks_acquire ();
 
 					sumsq(data0, array_length);
 
-					/* const uint32_t end0 = cpu::get_ticks_release (); */
-					clock_gettime (CLOCK_MONOTONIC, &time2);
+					end0 = timer::get_ticks_release ();
 	
-					time3 = diff (time1, time2);	
 					/*
 					printf ("Ticks per element (double): %5.03lf\n", 
 									double(end0 - start0) / double(array_length));
 					 */
-					printf ("Execution time: %lu.%09lu\n", time3.tv_sec, time3.tv_nsec);
+					timer::report (stdout, "Execution time", timer::elapsed_ticks (start0, end0));
 		
 					printf ("Intensity: %5.04lf\n", (2.0 * MLA_PER_DOUBLE) / 
 									sizeof (double));
@@ -120,20 +81,17 @@ int main(int argc, char** argv) {
 				{
 					printf ("Executing double precision benchmak on core 1\n");
 
-					clock_gettime (CLOCK_MONOTONIC, &time4);
-					/* const uint32_t start1 = cpu::get_ticks_acquire (); */
+					start1 = timer::get_ticks_acquire ();
 
 					sumsq(data1, array_length);
 
-					/* const uint32_t end1 = cpu::get_ticks_release (); */
-					clock_gettime (CLOCK_MONOTONIC, &time5);
+					end1 = timer::get_ticks_release ();
 	
-					time6 = diff (time4, time5);	
 					/* 
 					printf ("Ticks per element (double): %5.03lf\n", 
 									double(end1 - start1) / double(array_length));
 					 */
-					printf ("Execution time: %lu.%09lu\n", time6.tv_sec, time6.tv_nsec);
+					timer::report (stdout, "Execution time", timer::elapsed_ticks (start1, end1));
 		
 					printf ("Intensity: %5.04lf\n", (2.0 * MLA_PER_DOUBLE) / 
 									sizeof (double));
@@ -155,20 +113,17 @@ int main(int argc, char** argv) {
 				{
 					printf ("Executing single precision benchmak on core 0\n");
 
-					clock_gettime (CLOCK_MONOTONIC, &time1);
-					/* const uint32_t start0 = cpu::get_ticks_acquire (); */
+					start0 = timer::get_ticks_acquire ();
 
 					sumsqf ((float*) data0, array_length * 2);
 
-					/* const uint32_t end0 = cpu::get_ticks_release (); */
-					clock_gettime (CLOCK_MONOTONIC, &time2);
+					end0 = timer::get_ticks_release ();
 	
-					time3 = diff (time1, time2);	
 					/*
 					printf ("Ticks per element (double): %5.03lf\n", 
 									double(end0 - start0) / double(array_length));
 					 */
-					printf ("Execution time: %lu.%09lu\n", time3.tv_sec, time3.tv_nsec);
+					timer::report (stdout, "Execution time", timer::elapsed_ticks (start0, end0));
 		
 					printf ("Intensity: %5.04lf\n", (2.0 * MLA_PER_FLOAT) / 
 									sizeof (float));
@@ -179,20 +134,17 @@ int main(int argc, char** argv) {
 				{
 					printf ("Executing single precision benchmak on core 1\n");
 
-					clock_gettime (CLOCK_MONOTONIC, &time4);
-					/* const uint32_t start1 = cpu::get_ticks_acquire (); */
+					start1 = timer::get_ticks_acquire ();
 
 					sumsqf ((float*) data1, array_length * 2);
 
-					/* const uint32_t end1 = cpu::get_ticks_release (); */
-					clock_gettime (CLOCK_MONOTONIC, &time5);
+					end1 = timer::get_ticks_release ();
 	
-					time6 = diff (time4, time5);	
 					/* 
 					printf ("Ticks per element (double): %5.03lf\n", 
 									double(end1 - start1) / double(array_length));
 					 */
-					printf ("Execution time: %lu.%09lu\n", time6.tv_sec, time6.tv_nsec);
+					timer::report (stdout, "Execution time", timer::elapsed_ticks (start1, end1));
 		
 					printf ("Intensity: %5.04lf\n", (2.0 * MLA_PER_FLOAT) / 
 									sizeof (float));
@@ -26,47 +26,9 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <time.h>
 #include <unistd.h>
 #include <omp.h>
+#include "timer.h"
 
 
-namespace cpu {
-	
-	inline static uint32_t get_ticks_acquire() {
-		uint32_t ticks;
-		asm volatile (
-			"MRC p15, 0, %0, c9, c13, 0;"
-			: "=r" (ticks)
-			:
-			:
-		);
-		return ticks;
-	}
-
-	inline static uint64_t get_ticks_release() {
-		uint32_t ticks;
-		asm volatile (
-			"MRC p15, 0, %0, c9, c13, 0;"
-			: "=r" (ticks)
-			:
-			:
-		);
-		return ticks;
-	}
-
-}
-
-timespec diff(timespec start, timespec end)
-{
-	timespec temp;
-	if ((end.tv_nsec-start.tv_nsec)<0) {
-		temp.tv_sec = end.tv_sec-start.tv_sec-1;
-		temp.tv_nsec = 1000000000+end.tv_nsec-start.tv_nsec;
-	} else {
-		temp.tv_sec = end.tv_sec-start.tv_sec;
-		temp.tv_nsec = end.tv_nsec-start.tv_nsec;
-	}
-	return temp;
-}
-
 extern "C" void stdev(const double* data, size_t length);
 extern "C" void stdevf(const float* data, size_t length);
 
@@ -77,8 +39,8 @@ extern "C" void stdevf(const float* data, size_t length);
 int main(int argc, char** argv) {
 
 	/* Timer */
-	timespec time1, time2, time3;
-	timespec time4, time5, time6;
+	uint64_t start0, end0, start1, end1;
+	timer::init ();
 	const size_t array_length = 12 * 1024 * 1024;
 
 		
@@ -108,17 +70,13 @@ int main(int argc, char** argv) {
 					fprintf (stderr, "CPU benchmark for core 0 running on thread %d\n",
 									 omp_get_thread_num ());
 
-					clock_gettime (CLOCK_MONOTONIC, &time1);
-					/* const uint32_t start = cpu::get_ticks_acquire(); */
+					start0 = timer::get_ticks_acquire ();
 
 					stdev (data0, array_length);
 
-					/* const uint32_t end = cpu::get_ticks_release(); */
-					clock_gettime (CLOCK_MONOTONIC, &time2);
+					end0 = timer::get_ticks_release ();
 
-					time3 = diff (time1, time2);
-					fprintf (stderr, "Execution time: %lu.%09lu\n", time3.tv_sec, 
-									 time3.tv_nsec);
+					timer::report (stderr, "Execution time", timer::elapsed_ticks (start0, end0));
 
 					/*
 					printf("Ticks per element (double): %5.03lf\n", 
@@ -148,18 +106,13 @@ int main(int argc, char** argv) {
 					fprintf (stderr, "CPU benchmark for core 1 running on thread %d\n",
 									 omp_get_thread_num ());
 
-					clock_gettime (CLOCK_MONOTONIC, &time4);
-					/* const uint32_t start = cpu::get_ticks_acquire(); */
+					start1 = timer::get_ticks_acquire ();
 
 					stdev (data1, array_length);
 
-					/* const uint32_t end = cpu::get_ticks_release(); */
-					clock_gettime (CLOCK_MONOTONIC, &time5);
-
-					time6 = diff (time4, time5);
+					end1 = timer::get_ticks_release ();
 
-					fprintf (stderr, "Execution time: %lu.%09lu\n", time6.tv_sec, 
-									 time6.tv_nsec);
+					timer::report (stderr, "Execution time", timer::elapsed_ticks (start1, end1));
 					fprintf (stderr, "Intensity: %5.03lf\n", 
 									 double((MLA_PER_DOUBLE * 3.0) / sizeof (double)));
 				}
@@ -178,22 +131,13 @@ int main(int argc, char** argv) {
 					fprintf (stderr, "CPU benchmark for core 0 running on thread %d\n",
 									 omp_get_thread_num ());
 
-					clock_gettime (CLOCK_MONOTONIC, &time1);
-					/* const uint32_t start = cpu::get_ticks_acquire(); */
+					start0 = timer::get_ticks_acquire ();
 
 					stdevf ((float*) data0, array_length * 2);
 
-					/* const uint32_t end = cpu::get_ticks_release(); */
-					clock_gettime (CLOCK_MONOTONIC, &time2);
+					end0 = timer::get_ticks_release ();
 
-					time3 = diff (time1, time2);
-					/*
-					double exec_time_float = (double) time3.tv_sec + 
-																	 (double) (time3.tv_nsec)/1e9;
-					printf ("Execution time: %f\n", exec_time_float);
-		 			*/
-					fprintf (stderr, "Execution time: %lu.%09lu\n",
-									 time3.tv_sec, time3.tv_nsec);
+					timer::report (stderr, "Execution time", timer::elapsed_ticks (start0, end0));
 					fprintf (stderr, "Intensity: %5.03lf\n",  
 								 	 double((2 * MLA_PER_FLOAT * 2.0) / sizeof (double)));
 				}
@@ -202,17 +146,13 @@ int main(int argc, char** argv) {
 					fprintf (stderr, "CPU benchmark for core 1 running on thread %d\n",
 									 omp_get_thread_num ());
 
-					clock_gettime (CLOCK_MONOTONIC, &time4);
-					/* const uint32_t start = cpu::get_ticks_acquire(); */
+					start1 = timer::get_ticks_acquire ();
 
 					stdevf ((float*) data1, array_length * 2);
 
-					/* const uint32_t end = cpu::get_ticks_release(); */
-					clock_gettime (CLOCK_MONOTONIC, &time5);
+					end1 = timer::get_ticks_release ();
 
-					time6 = diff (time4, time5);
-					fprintf(stderr, "Execution time: %lu.%09lu\n",
-									time6.tv_sec, time6.tv_nsec);
+					timer::report (stderr, "Execution time", timer::elapsed_ticks (start1, end1));
 					fprintf(stderr, "Intensity: %5.03lf\n", 
 									double((2 * MLA_PER_FLOAT * 2.0) / sizeof(double)));
 				}
@@ -25,37 +25,7 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <string.h>
 #include <omp.h>
 #include <unistd.h>
-
-/* ======================================================== */
-/* Timer */
-namespace cpu {
-	
-	inline static uint64_t get_ticks_acquire() {
-		uint32_t low, high;
-		__asm__ __volatile__ (
-			"xor %%eax, %%eax;"
-			"cpuid;"
-			"rdtsc;"
-		: "=a"(low), "=d"(high)
-		:
-		: "%rbx", "%rcx"
-		);
-		return (uint64_t(high) << 32) | uint64_t(low);
-	}
-
-	inline static uint64_t get_ticks_release() {
-		uint32_t low, high;
-		__asm__ __volatile__ (
-			"rdtscp;"
-		: "=a"(low), "=d"(high)
-		:
-		: "%rcx"
-		);
-		return (uint64_t(high) << 32) | uint64_t(low);
-	}
-
-}
-/* ======================================================== */
+#include "timer.h"
 
 /* Single and double precision sum squared functions */
 extern "C" void sumsq(const double* data, size_t length);
@@ -73,7 +43,8 @@ int main(int argc, char** argv) {
 	memset (data1, 0, array_length * sizeof (double));
 
 	/* Timers */	
-	double execTime0, execTime1;
+	uint64_t ticks0, ticks1;
+	timer::init();
 
 	/* Since the i3-3217U has 2 cores, we use OpenMP to run computation on both
 		 cores. 
@@ -92,20 +63,20 @@ int main(int argc, char** argv) {
 				/* For double	precision */
 				{
 					fprintf (stderr, "Double precision...\n");
-					const uint64_t start0 = cpu::get_ticks_acquire();
+					const uint64_t start0 = timer::get_ticks_acquire();
 					sumsq(data0, array_length);
-					const uint64_t end0 = cpu::get_ticks_release();
+					const uint64_t end0 = timer::get_ticks_release();
 
-					execTime0 = double(end0 - start0) / 1.7e+9;
+					ticks0 = timer::elapsed_ticks(start0, end0);
 				}
 				#else
 				/* For single precision */
 				{
-					const uint64_t start0 = cpu::get_ticks_acquire();
+					const uint64_t start0 = timer::get_ticks_acquire();
 					sumsqf((const float*)data0, array_length * 2);
-					const uint64_t end0 = cpu::get_ticks_release();
+					const uint64_t end0 = timer::get_ticks_release();
 
-					execTime0 = double(end0 - start0) / 1.7e+9;
+					ticks0 = timer::elapsed_ticks(start0, end0);
 				}
 				#endif
 			}
@@ -116,20 +87,20 @@ int main(int argc, char** argv) {
 				#if(TYPE)
 				/* For double	precision */
 				{
-					const uint64_t start1 = cpu::get_ticks_acquire();
+					const uint64_t start1 = timer::get_ticks_acquire();
 					sumsq(data1, array_length);
-					const uint64_t end1 = cpu::get_ticks_release();
+					const uint64_t end1 = timer::get_ticks_release();
 
-					execTime1 = double(end1 - start1) / 1.7e+9;
+					ticks1 = timer::elapsed_ticks(start1, end1);
 				}
 				#else
 				/* For single precision */
 				{
-					const uint64_t start1 = cpu::get_ticks_acquire();
+					const uint64_t start1 = timer::get_ticks_acquire();
 					sumsqf((const float*)data1, array_length * 2);
-					const uint64_t end1 = cpu::get_ticks_release();
+					const uint64_t end1 = timer::get_ticks_release();
 
-					execTime1 = double(end1 - start1) / 1.7e+9;
+					ticks1 = timer::elapsed_ticks(start1, end1);
 				}
 				#endif
 
@@ -155,13 +126,13 @@ int main(int argc, char** argv) {
 	double bytes = 2 * array_length * sizeof(double);
 
 	/* take the maximum of the execution times of the two cores */
-	double execTime;
-	if(execTime0 > execTime1) execTime = execTime0; else execTime = execTime1;
+	const uint64_t ticks = ticks0 > ticks1 ? ticks0 : ticks1;
+	const double execTime = timer::ticks_to_secs(ticks);
 
 	/* Print performance info */
-	fprintf (stderr, "Execution time 0: %lf\tExecution time 1: %lf\n", 
-					 execTime0, execTime1);
-	fprintf (stderr, "Execution time: %lf\n", execTime);
+	timer::report(stderr, "Execution time 0", ticks0);
+	timer::report(stderr, "Execution time 1", ticks1);
+	timer::report(stderr, "Execution time", ticks);
 	fprintf (stderr, "GBytes: %5.03lf GFlops: %5.03lf\n", bytes/1.0e+9, 
 					 flops/1.0e+9);
 	fprintf (stderr, "Bandwidth: %lf GB/s\n", bytes/execTime/1.0e+9);
@@ -21,28 +21,117 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <stdint.h>
+#include <sched.h>
 #include <omp.h>
+#include <atomic>
 #include "timer.h"
+#include "powercap.h"
 
-/* This needs to be changed depending on the number of cores available */
-#define NUM_CORES 4
 #define NUM_ITER 10
 
 /* Kernel in assembly */
 extern "C" void polevl(const double* data, size_t length);
 
+/* Memory kernels of ../../../../generic/random-and-cache for co-run mode */
+extern "C" void uBench_ReadMemory_Sequential_SSE_NoPrefetch(const void* memory, size_t bytes);
+extern "C" void uBench_ReadMemory_Random28_MOV_Stride64(const void* memory);
+
+/* The random kernel visits every 64-byte line of a 2^28-byte region once */
+#define RANDOM_BYTES (size_t(1) << 28)
+
+/* Runs: compute threads alone, memory threads alone, both together */
+enum phase_t {
+	PHASE_COMPUTE,
+	PHASE_MEMORY,
+	PHASE_CORUN,
+	PHASE_COUNT
+};
+
+struct corun_t {
+	/* Memory threads, their CPUs and kernel; 0 threads disables co-run */
+	int num_threads;
+	const char* cpu_list;
+	int random;
+};
+
 /* =================================================================== */
 /* Parse program input */
-void usage(int argc, char** argv, int* data_size, float* intensity)
+void usage(int argc, char** argv, int* data_size, float* intensity,
+					 int* num_threads, const char** cpu_list, corun_t* corun)
 {
 	if(argc < 3) {
-		fprintf(stderr, "usage: %s <data size in bytes> <intensity>\n", 
-						argv[0]);
+		fprintf(stderr, "usage: %s <data size in bytes> <intensity> "
+						"[threads] [cpu list, e.g. 0,2,4-7] "
+						"[memory threads] [memory cpu list] [seq|random]\n", argv[0]);
 		exit (0);
 	} else {
 		*data_size = atoi (argv[1]);
 		*intensity = atof (argv[2]);
 	}
+	/* Default to one thread per available CPU */
+	*num_threads = (argc > 3) ? atoi (argv[3]) : omp_get_num_procs ();
+	*cpu_list = (argc > 4) ? argv[4] : NULL;
+	if(*num_threads < 1) {
+		fprintf(stderr, "Thread count must be at least 1\n");
+		exit (1);
+	}
+	/* Co-run: memory-bound threads next to the polevl threads */
+	corun->num_threads = (argc > 5) ? atoi (argv[5]) : 0;
+	corun->cpu_list = (argc > 6) ? argv[6] : NULL;
+	corun->random = (argc > 7) && strcmp (argv[7], "random") == 0;
+	if(corun->num_threads > 0 && corun->cpu_list == NULL) {
+		fprintf(stderr, "Co-run needs a CPU list for the memory threads\n");
+		exit (1);
+	}
+}
+/* =================================================================== */
+
+
+/* =================================================================== */
+/* Expand a CPU list such as "0,2,4-7" into cpus[0..max); returns the
+	 number of CPUs in the list, or -1 when a CPU is outside 0..CPU_SETSIZE-1.
+	 Without a list, thread i runs on CPU i. */
+int parse_cpu_list (const char* list, int* cpus, int max)
+{
+	int count = 0;
+	if(list == NULL) {
+		for(int i = 0; i < max; i++) {
+			cpus[i] = i % omp_get_num_procs ();
+		}
+		return max;
+	}
+	const char* p = list;
+	while(*p != '\0' && count < max) {
+		char* end;
+		const int first = (int) strtol (p, &end, 10);
+		int last = first;
+		if(end == p) break;
+		if(*end == '-') {
+			p = end + 1;
+			last = (int) strtol (p, &end, 10);
+		}
+		if(first < 0 || last < first || last >= CPU_SETSIZE) {
+			fprintf(stderr, "CPU list %s: CPUs must be in ascending ranges within 0-%d\n", list,
+							CPU_SETSIZE - 1);
+			return -1;
+		}
+		for(int cpu = first; cpu <= last && count < max; cpu++) {
+			cpus[count++] = cpu;
+		}
+		p = (*end == ',') ? end + 1 : end;
+	}
+	return count;
+}
+
+/* Pin the calling thread to one CPU */
+int pin_to_cpu (int cpu)
+{
+	cpu_set_t set;
+	if(cpu < 0 || cpu >= CPU_SETSIZE) return -1;
+	CPU_ZERO (&set);
+	CPU_SET (cpu, &set);
+	return sched_setaffinity (0, sizeof (set), &set);
 }
 /* =================================================================== */
 
@@ -60,162 +149,216 @@ void computePerformance (long double t, int array_size, float intensity)
 
 
 /* =================================================================== */
-/* Find the minimum, maximum, and average execution times */
-long double find_min (long double a, long double b, long double c, 
-											long double d, int num_iter)
+/* Find the minimum, maximum, and average per-iteration execution times
+	 over n threads */
+long double find_min (const long double* t, int n, int num_iter)
 {
-	long double val[4];
-	val[0] = a / num_iter;
-	val[1] = b / num_iter;
-	val[2] = c / num_iter;
-	val[3] = d / num_iter;
-	long double min = val[0];
-	for(int i = 1; i < 4; i++) {
-		if(val[i] < min) min = val[i];	
+	long double min = t[0] / num_iter;
+	for(int i = 1; i < n; i++) {
+		if(t[i] / num_iter < min) min = t[i] / num_iter;
 	}
 	return min;
 }
-long double find_max (long double a, long double b, long double c, 
-											long double d, int num_iter)
+long double find_max (const long double* t, int n, int num_iter)
 {
-	long double val[4];
-	val[0] = a / num_iter;
-	val[1] = b / num_iter;
-	val[2] = c / num_iter;
-	val[3] = d / num_iter;
-	long double max = val[0];
-	for(int i = 1; i < 4; i++) {
-		if(val[i] > max) max = val[i];	
+	long double max = t[0] / num_iter;
+	for(int i = 1; i < n; i++) {
+		if(t[i] / num_iter > max) max = t[i] / num_iter;
 	}
 	return max;
 }
-long double find_avg (long double a, long double b, long double c, 
-											long double d, int num_iter)
+long double find_avg (const long double* t, int n, int num_iter)
 {
-	long double val[4];
-	val[0] = a / num_iter;
-	val[1] = b / num_iter;
-	val[2] = c / num_iter;
-	val[3] = d / num_iter;
-	long double sum = val[0];
-	for(int i = 1; i < 4; i++) {
-		sum += val[i];
-	}
-	return sum / 4;
+	long double sum = 0;
+	for(int i = 0; i < n; i++) {
+		sum += t[i] / num_iter;
+	}
+	return sum / n;
 }
 /* =================================================================== */
 
 
-int main(int argc, char** argv)
+/* =================================================================== */
+/* Slowest thread of a group in one phase */
+uint64_t group_ticks (const uint64_t* ticks, int first, int count)
 {
-	int i;
+	uint64_t slowest = 0;
+	for(int i = first; i < first + count; i++) {
+		if(ticks[i] > slowest) slowest = ticks[i];
+	}
+	return slowest;
+}
+/* =================================================================== */
 
-	/* Timer */
-	struct stopwatch_t* timer = NULL;
-	long double t_pol, t_0, t_1, t_2, t_3, t_max, t_min, t_avg;
 
+int main(int argc, char** argv)
+{
 	/* Amount of data to load */
 	float intensity;
 	int data_size;
 	int array_size;
 	int array_per_core;
-	double *data0, *data1, *data2, *data3;
+	int num_threads;
+	const char* cpu_list;
+	corun_t corun;
 
-	usage (argc, argv, &data_size, &intensity);
+	usage (argc, argv, &data_size, &intensity, &num_threads, &cpu_list, &corun);
 
 	array_size = data_size / sizeof (double);
-	array_per_core = array_size / NUM_CORES;
-	data0 = (double*) malloc (array_per_core * sizeof (double));
-	data1 = (double*) malloc (array_per_core * sizeof (double));
-	data2 = (double*) malloc (array_per_core * sizeof (double));
-	data3 = (double*) malloc (array_per_core * sizeof (double));
-
-	fprintf(stderr, "Loading %f GB of data\n", 1.0 * array_size * sizeof (double) 
-					/ 1e9);
+	array_per_core = array_size / num_threads;
+	/* Count only the data the threads actually load */
+	array_size = array_per_core * num_threads;
 
-	
-	/* Allocate memory for polynomial kernel */
-	for(i = 0; i < array_per_core; i++) {
-		data0[i] = 0.0;
-		data1[i] = 0.0;
-		data2[i] = 0.0;
-		data3[i] = 0.0;
+	/* Compute threads are 0 .. num_threads-1, memory threads follow */
+	const int num_memory = corun.num_threads;
+	const int num_workers = num_threads + num_memory;
+	int* cpus = (int*) malloc (num_workers * sizeof (int));
+	const int listed = parse_cpu_list (cpu_list, cpus, num_threads);
+	if(listed < 0) return 1;
+	if(listed < num_threads) {
+		fprintf(stderr, "CPU list %s has fewer than %d CPUs\n", cpu_list,
+						num_threads);
+		return 1;
+	}
+	if(num_memory > 0) {
+		const int memory_listed = parse_cpu_list (corun.cpu_list, cpus + num_threads, num_memory);
+		if(memory_listed < 0) return 1;
+		if(memory_listed < num_memory) {
+			fprintf(stderr, "CPU list %s has fewer than %d CPUs\n", corun.cpu_list,
+							num_memory);
+			return 1;
+		}
 	}
+	/* Sequential memory threads read as much per pass as a compute thread */
+	const size_t memory_bytes = corun.random ? RANDOM_BYTES : array_per_core * sizeof (double);
 
+	/* Per-thread data, start/end ticks (per phase) and execution times */
+	double** data = (double**) malloc (num_workers * sizeof (double*));
+	uint64_t* tick_start = (uint64_t*) calloc (PHASE_COUNT * num_workers, sizeof (uint64_t));
+	uint64_t* tick_end = (uint64_t*) calloc (PHASE_COUNT * num_workers, sizeof (uint64_t));
+	uint64_t* ticks = (uint64_t*) calloc (PHASE_COUNT * num_workers, sizeof (uint64_t));
+	long double* t = (long double*) malloc (num_threads * sizeof (long double));
+	double watts[PHASE_COUNT] = { 0.0, 0.0, 0.0 };
+	const int num_phases = num_memory > 0 ? PHASE_COUNT : 1;
+	/* Workers of the current phase that finished their timed iterations */
+	std::atomic<int> finished (0);
 
-	/* Setup tiemr */
-	stopwatch_init ();
-	timer = stopwatch_create ();
+	fprintf(stderr, "Loading %f GB of data on %d threads\n",
+					1.0 * array_size * sizeof (double) / 1e9, num_threads);
+	if(num_memory > 0) {
+		fprintf(stderr, "Co-running %d %s memory threads (%zu MB each)\n", num_memory,
+						corun.random ? "random" : "sequential", memory_bytes >> 20);
+	}
 
-	/* Start timing from the beginning of the block */
-	stopwatch_start (timer);
+	/* Setup timer */
+	timer::init ();
 
-	#pragma omp parallel num_threads(5)
+	/* One extra thread (the last one) is left for power measurement */
+	#pragma omp parallel num_threads(num_workers + 1)
 	{
-		#pragma omp sections
-		{
+		const int tid = omp_get_thread_num ();
+		const int is_compute = tid < num_threads;
+		const int is_memory = tid >= num_threads && tid < num_workers;
+		powercap::reading_t energy_start = powercap::reading_t (), energy_end;
+
+		if(tid < num_workers) {
+			/* Pin, then allocate and touch the array from this thread so that
+				 its pages are placed on this thread's memory node */
+			if(pin_to_cpu (cpus[tid]) != 0) {
+				fprintf (stderr, "Could not pin thread %d to CPU %d\n", tid, cpus[tid]);
+			}
+			const size_t bytes = is_compute ? array_per_core * sizeof (double) : memory_bytes;
+			data[tid] = (double*) malloc (bytes);
+			memset (data[tid], 0, bytes);
+		} else {
 			/* Power measurement thread */
-			#pragma omp section
-			{
-				fprintf (stderr, "Power measurement code running on the thread %d\n",
-								 omp_get_thread_num ());
+			fprintf (stderr, "Power measurement code running on the thread %d\n",
+							 tid);
+		}
+
+		for(int phase = 0; phase < num_phases; phase++) {
+			const int active = (phase == PHASE_COMPUTE) ? num_threads :
+				(phase == PHASE_MEMORY) ? num_memory : num_workers;
+			const int runs = (phase == PHASE_COMPUTE && is_compute) ||
+				(phase == PHASE_MEMORY && is_memory) || (phase == PHASE_CORUN && tid < num_workers);
+			uint64_t* start = tick_start + phase * num_workers;
+			uint64_t* end = tick_end + phase * num_workers;
+
+			/* All threads start together */
+			#pragma omp barrier
+			if(tid == num_workers) {
+				powercap::read ("/sys", &energy_start);
 			}
-			/* Kernel execution thread 0 */
-			#pragma omp section
-			{
+
+			if(runs) {
+				/* Timed iterations, then keep the load on (untimed) until every
+					 active thread is done, so that in the co-run the slower group
+					 is disturbed for its whole run */
+				start[tid] = timer::get_ticks_acquire ();
 				for(int iter = 0; iter < NUM_ITER; iter++) {
-					polevl(data1, array_per_core);
+					if(is_compute) {
+						polevl(data[tid], array_per_core);
+					} else if(corun.random) {
+						uBench_ReadMemory_Random28_MOV_Stride64 (data[tid]);
+					} else {
+						uBench_ReadMemory_Sequential_SSE_NoPrefetch (data[tid], memory_bytes);
+					}
 				}
-				t_0 = stopwatch_elapsed (timer);
-				fprintf (stderr, "CPU benchmark code running on thread %d\n",
-								 omp_get_thread_num ());
-			}
-			/* Kernel execution thread 1 */
-			#pragma omp section
-			{
-				for(int iter = 0; iter < NUM_ITER; iter++) {
-					polevl(data0, array_per_core);
+				end[tid] = timer::get_ticks_release ();
+				finished.fetch_add (1, std::memory_order_release);
+				while(finished.load (std::memory_order_acquire) < active) {
+					if(is_compute) {
+						polevl(data[tid], array_per_core);
+					} else if(corun.random) {
+						uBench_ReadMemory_Random28_MOV_Stride64 (data[tid]);
+					} else {
+						uBench_ReadMemory_Sequential_SSE_NoPrefetch (data[tid], memory_bytes);
+					}
 				}
-				t_1 = stopwatch_elapsed (timer);
-				fprintf (stderr, "CPU benchmark code running on thread %d\n",
-								 omp_get_thread_num ());
 			}
-			/* Kernel execution thread 2 */
-			#pragma omp section
-			{
-				for(int iter = 0; iter < NUM_ITER; iter++) {
-					polevl(data2, array_per_core);
-				}
-				t_2 = stopwatch_elapsed (timer);
-				fprintf (stderr, "CPU benchmark code running on thread %d\n",
-								 omp_get_thread_num ());
-			}
-			/* Kernel execution thread 3 */
-			#pragma omp section
-			{
-				for(int iter = 0; iter < NUM_ITER; iter++) {
-					polevl(data3, array_per_core);
+
+			#pragma omp barrier
+			if(tid == num_workers) {
+				/* Package power over the phase, up to the last thread's end */
+				const uint64_t phase_end = timer::get_ticks_release ();
+				if(powercap::read ("/sys", &energy_end) > 0) {
+					uint64_t phase_start = phase_end;
+					for(int i = 0; i < num_workers; i++) {
+						if(start[i] != 0 && start[i] < phase_start) phase_start = start[i];
+					}
+					watts[phase] = powercap::joules (&energy_start, &energy_end) /
+						timer::ticks_to_secs (timer::elapsed_ticks (phase_start, phase_end));
 				}
-				t_3 = stopwatch_elapsed (timer);
-				fprintf (stderr, "CPU benchmark code running on thread %d\n",
-								 omp_get_thread_num ());
+				finished.store (0, std::memory_order_relaxed);
 			}
 		}
 	}
 
-	/* Finish measuring time for the entire block */
-	t_pol = stopwatch_elapsed (timer);
+	for(int i = 0; i < PHASE_COUNT * num_workers; i++) {
+		if(tick_end[i] != 0) ticks[i] = timer::elapsed_ticks (tick_start[i], tick_end[i]);
+	}
+
+	/* The block runs from the first thread's start to the last one's end */
+	uint64_t first_start = tick_start[0];
+	uint64_t last_end = tick_end[0];
+	for(int i = 0; i < num_threads; i++) {
+		if(tick_start[i] < first_start) first_start = tick_start[i];
+		if(tick_end[i] > last_end) last_end = tick_end[i];
+	}
+	const uint64_t tick_pol = timer::elapsed_ticks (first_start, last_end);
 
 	/* Print execution times for the different threads */
-	fprintf (stderr, "Execution time: %Lg secs\n", t_pol);
-	fprintf (stderr, "Execution time 0: %Lg secs\n", t_0);
-	fprintf (stderr, "Execution time 1: %Lg secs\n", t_1);
-	fprintf (stderr, "Execution time 2: %Lg secs\n", t_2);
-	fprintf (stderr, "Execution time 3: %Lg secs\n", t_3);
-
-	t_max = find_max (t_0, t_1, t_2, t_3, NUM_ITER);
-	t_min = find_min (t_0, t_1, t_2, t_3, NUM_ITER);
-	t_avg = find_avg (t_0, t_1, t_2, t_3, NUM_ITER);
+	timer::report (stderr, "Execution time", tick_pol);
+	for(int i = 0; i < num_threads; i++) {
+		char label[64];
+		snprintf (label, sizeof (label), "Execution time %d (CPU %d)", i, cpus[i]);
+		timer::report (stderr, label, ticks[i]);
+		t[i] = timer::ticks_to_secs (ticks[i]);
+	}
+
+	const long double t_max = find_max (t, num_threads, NUM_ITER);
+	const long double t_min = find_min (t, num_threads, NUM_ITER);
+	const long double t_avg = find_avg (t, num_threads, NUM_ITER);
 	fprintf (stderr, "Execution time min: %Lg ::: max: %Lg ::: avg: %Lg secs\n", 
 					 t_min, t_max, t_avg);
 
@@ -224,12 +367,47 @@ int main(int argc, char** argv)
 	/* Compute performancem metrics */
 	computePerformance (t_max, array_size, intensity);
 
+	/* Co-run: each group's slowest thread alone and together */
+	if(num_memory > 0) {
+		const double compute_bytes = double(array_size) * sizeof (double) * NUM_ITER;
+		/* Random reads move one 64-byte line per load */
+		const double memory_bytes_total = double(memory_bytes) * num_memory * NUM_ITER;
+		const double alone[2] = {
+			timer::ticks_to_secs (group_ticks (ticks + PHASE_COMPUTE * num_workers, 0, num_threads)),
+			timer::ticks_to_secs (group_ticks (ticks + PHASE_MEMORY * num_workers, num_threads, num_memory))
+		};
+		const double together[2] = {
+			timer::ticks_to_secs (group_ticks (ticks + PHASE_CORUN * num_workers, 0, num_threads)),
+			timer::ticks_to_secs (group_ticks (ticks + PHASE_CORUN * num_workers, num_threads, num_memory))
+		};
+		printf ("Group" "\t" "Threads" "\t" "Alone secs" "\t" "Co-run secs" "\t" "Slowdown" "\t"
+						"Alone GB/s" "\t" "Co-run GB/s" "\n");
+		printf ("polevl" "\t" "%d" "\t" "%4.06lf" "\t" "%4.06lf" "\t" "%4.03lf" "\t" "%4.03lf" "\t" "%4.03lf" "\n",
+						num_threads, alone[0], together[0], together[0] / alone[0],
+						compute_bytes / alone[0] / 1e9, compute_bytes / together[0] / 1e9);
+		printf ("%s" "\t" "%d" "\t" "%4.06lf" "\t" "%4.06lf" "\t" "%4.03lf" "\t" "%4.03lf" "\t" "%4.03lf" "\n",
+						corun.random ? "random" : "seq", num_memory, alone[1], together[1],
+						together[1] / alone[1], memory_bytes_total / alone[1] / 1e9,
+						memory_bytes_total / together[1] / 1e9);
+		if(watts[PHASE_CORUN] > 0.0) {
+			printf ("\n" "Package power (W)" "\t" "polevl alone" "\t" "memory alone" "\t" "co-run" "\n");
+			printf ("\t" "%4.02lf" "\t" "%4.02lf" "\t" "%4.02lf" "\n", watts[PHASE_COMPUTE],
+							watts[PHASE_MEMORY], watts[PHASE_CORUN]);
+		} else {
+			fprintf (stderr, "No RAPL counters under /sys/class/powercap; power not reported\n");
+		}
+	}
+
 	/* Free CPU memory */
-	free (data0);
-	free (data1);
-	free (data2);
-	free (data3);
-	stopwatch_destroy (timer);
+	for(int i = 0; i < num_workers; i++) {
+		free (data[i]);
+	}
+	free (data);
+	free (tick_start);
+	free (tick_end);
+	free (ticks);
+	free (t);
+	free (cpus);
 
 	fprintf (stderr, "Done..\n");
 
@@ -19,6 +19,8 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "common.h"
 #include "barriers.h"
+#include "timer.h"
+#include "timeline.h"
 #include <unistd.h>
 #include <sys/time.h>
 
@@ -29,7 +31,6 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
 #define SIZEPERTHREAD 400000
-#define CPUFREQ 1.09
 #define NRUNS   10
 
 
@@ -52,17 +53,19 @@ int main (int argc, char **argv)
 
 	int tid;
 	int ratio;
-	__int64 t0;
-	__int64 t1;
 	int nthreads;
 	int nn;
 	double density;
 	double bandwidth[NRUNS];
 	double flops[NRUNS];
 	double execTime[NRUNS];
+	uint64_t ticks[NRUNS];
 	double maxflops;
 	double maxbandwidth;
 	double minTime;
+	uint64_t minTicks;
+	int best;
+	uint64_t *stamps;
 
 	if (argc != 2) {
 		printf ("Usage: %s <no. of threads>\n", argv[0]);
@@ -70,6 +73,10 @@ int main (int argc, char **argv)
 	}  
 	/* Number of threads to use */
 	nthreads = atoi (argv[1]);
+	if (nthreads < 1 || nthreads > MAXTHREADS) {
+		printf ("Error: need 1-%d threads\n", MAXTHREADS);
+		exit (1);
+	}
 
 	/* Number of elements per thread */
 	g_sizeperthread = SIZEPERTHREAD * SIMDW;
@@ -94,12 +101,19 @@ int main (int argc, char **argv)
 	tbarrier.Init (nthreads);
 
 	/* Initialize timer */
+	timer::init ();
+	g_cpufreq = timer::ticks_per_sec () / GHZ;
 	struct timeval now;
 	int rc = gettimeofday (&now, NULL);
 	if(rc==0) {
 		fprintf(stderr, "Time = %lu.%06lu\n", now.tv_sec, now.tv_usec);
 	}
 
+	/* mytime[] holds each run's per-thread stamps, one cache line per
+	   thread; every run is kept for the timeline */
+	stamps = timeline::allocate (NRUNS, nthreads);
+	assert (stamps != NULL);
+
 	/* Start execution */
 	for (int run = 0; run < NRUNS; run++)
 	{
@@ -121,8 +135,9 @@ int main (int argc, char **argv)
 			end = (tid + 1) * g_sizeperthread;
      
 			/* Start time measurement */       
-			t0 = __rdtsc ();
+			mytime[TIMELINE_SLOT (tid, TIMELINE_START)] = timer::get_ticks_acquire ();
 			Barrier (tid);
+			mytime[TIMELINE_SLOT (tid, TIMELINE_BARRIER_EXIT)] = timer::get_ticks_acquire ();
             
 			for (i = start; i < end; i+=SIMDW)
 			{
@@ -541,30 +556,51 @@ int main (int argc, char **argv)
 			}
 
 			/* End timer */
+			mytime[TIMELINE_SLOT (tid, TIMELINE_WORK_END)] = timer::get_ticks_release ();
 			Barrier (tid);
-			t1 = __rdtsc ();
+			mytime[TIMELINE_SLOT (tid, TIMELINE_END)] = timer::get_ticks_release ();
 
 			if (tid == 0) {
-				flops[run] = nn * 2.0 * g_arraysize * CPUFREQ / (double) (t1 - t0);
-				bandwidth[run] = (double) g_arraysize * sizeof (fptype_t) * CPUFREQ / 
-												 (double) (t1 - t0);
-				execTime[run] = (double) (t1 - t0) / (CPUFREQ * 1.0e9);
+				ticks[run] = timer::elapsed_ticks (mytime[TIMELINE_SLOT (0, TIMELINE_START)],
+																					 mytime[TIMELINE_SLOT (0, TIMELINE_END)]);
+				execTime[run] = timer::ticks_to_secs (ticks[run]);
+				flops[run] = nn * 2.0 * g_arraysize / execTime[run] / GHZ;
+				bandwidth[run] = (double) g_arraysize * sizeof (fptype_t) / 
+												 execTime[run] / GHZ;
 			}
 		}
+		memcpy (timeline::run (stamps, nthreads, run), mytime,
+						nthreads * TIMELINE_STRIDE * sizeof (uint64_t));
 	}
 
 	maxflops = 0.0;
 	maxbandwidth = 0.0;
  	minTime = 1000.0;
+	minTicks = ~0ull;
+	best = 0;
 	for (int run = 0; run < NRUNS; run++) {
 		maxflops = maxflops > flops[run] ? maxflops : flops[run];
 		maxbandwidth = maxbandwidth > bandwidth[run] ? maxbandwidth : 
 									 bandwidth[run];
 		minTime = minTime < execTime[run] ? minTime : execTime[run];
+		if (ticks[run] < minTicks) {
+			minTicks = ticks[run];
+			best = run;
+		}
 	}
         
- 	fprintf (stderr , "%.2lf, %.3lf Gflops, %.3lf GB/s %.8lf secs %d iters\n",
-					 density, maxflops, maxbandwidth, minTime, NRUNS);
+ 	fprintf (stderr , "%.2lf, %.3lf Gflops, %.3lf GB/s %.8lf secs %llu cycles %d iters\n",
+					 density, maxflops, maxbandwidth, minTime,
+					 (unsigned long long) minTicks, NRUNS);
+
+	/* Whether the best run was held back by a few slow threads */
+	timeline::stats_t stragglers;
+	timeline::analyse (timeline::run (stamps, nthreads, best), nthreads, &stragglers);
+	timeline::report ("best run", &stragglers);
+	const char *trace = getenv ("UBENCH_TRACE");
+	if (trace != NULL && timeline::write_chrome (trace, argv[0], stamps, NRUNS, nthreads) != 0)
+		fprintf (stderr, "Warning: cannot write the timeline to %s\n", trace);
+	free (stamps);
 
 	return 0;
 }
@@ -18,6 +18,7 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
 #include "common.h"
+#include "affinity.h"
 
 
 // global variables
@@ -32,7 +33,8 @@ pthread_mutex_t *g_lock_y;
 TreeBarrier tbarrier;
 char g_filename[1024];
 double g_cpufreq;
-__int64 mytime[MAXTHREADS * 8];
+// one 64-byte line of timeline stamps per thread (timeline.h)
+__declspec (align (64)) __int64 mytime[MAXTHREADS * 8];
 char *g_isgprefetch;
 int g_nqueue;
 int g_ntasksperqueue;
@@ -60,22 +62,13 @@ void initvec (fptype_t * v, int size, fptype_t initval)
 }
 
 
+/* Pin the threads with generic/common/affinity.h instead of Intel's
+   kmp_set_defaults: compact, as KMP_AFFINITY=granularity=fine,compact was,
+   unless UBENCH_CPUS or UBENCH_AFFINITY say otherwise */
 void initomp (int nthreads, int verbose)
 {
-    char schedule[1024];
-
-    if (verbose == 1)
-    {
-        sprintf (schedule,
-                 "KMP_AFFINITY=granularity=fine,compact,verbose");
-    }
-    else
-    {
-        sprintf (schedule,
-                 "KMP_AFFINITY=granularity=fine,compact");
-    }
-    kmp_set_defaults (schedule);
     omp_set_num_threads (nthreads);
+    affinity::pin_team_from_env (nthreads, affinity::POLICY_COMPACT, verbose == 1);
 }
 
 
@@ -26,7 +26,6 @@ extern int iuser2;
 
 // KNC hardware configurations
 #define MAXTHREADS        240
-#define CPUFREQ           1.09
 #define GHZ               1e9
 #define LINESIZE          64
 #define CACHESIZE         512*1024
@@ -0,0 +1,258 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "balance.h"
+
+
+const char *balancer_name (int balancer)
+{
+	switch (balancer) {
+		case NNZ_BAL: return "nnz";
+		case MISS_BAL: return "miss";
+		case ADAPTIVE_BAL: return "adaptive";
+		case SHARE_BAL: return "share";
+		case STEAL_BAL: return "steal";
+		case HYBRID_BAL: return "hybrid";
+		default: return "unknown";
+	}
+}
+
+int balancer_from_name (const char *name)
+{
+	for (int b = NNZ_BAL; b <= HYBRID_BAL; b++)
+		if (strcmp (name, balancer_name (b)) == 0)
+			return b;
+	return 0;
+}
+
+void partition_prefix (const double *prefix, int m, int nparts, int *partition)
+{
+	const double total = prefix[m];
+	partition[0] = 0;
+	for (int p = 1; p < nparts; p++) {
+		/* First row boundary at or past p/nparts of the cost */
+		const double target = total * p / nparts;
+		int lo = partition[p - 1];
+		int hi = m;
+		while (lo < hi) {
+			const int mid = lo + (hi - lo) / 2;
+			if (prefix[mid] < target)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		partition[p] = lo;
+	}
+	partition[nparts] = m;
+}
+
+void nnz_partition (const csr_t *A, int nparts, int granularity, int *partition)
+{
+	if (granularity == ELEMENT) {
+		for (int p = 0; p <= nparts; p++)
+			partition[p] = (int) ((int64_t) A->nnz * p / nparts);
+		return;
+	}
+	double *prefix = (double *) malloc ((A->m + 1) * sizeof (double));
+	for (int i = 0; i <= A->m; i++)
+		prefix[i] = A->rowptr[i];
+	partition_prefix (prefix, A->m, nparts, partition);
+	free (prefix);
+}
+
+/* =================================================================== */
+/* Set-associative LRU cache of CACHESIZE bytes, ASSOCIATE ways and
+	 LINESIZE-byte lines: the cache one thread's block runs through */
+struct cache_sim_t {
+	int sets;
+	uint64_t *tags;
+	/* Last use of each way; the smallest is the LRU victim */
+	uint32_t *stamps;
+	uint32_t clock;
+};
+
+static void sim_init (cache_sim_t *c)
+{
+	c->sets = CACHESIZE / (LINESIZE * ASSOCIATE);
+	c->tags = (uint64_t *) malloc ((size_t) c->sets * ASSOCIATE * sizeof (uint64_t));
+	c->stamps = (uint32_t *) malloc ((size_t) c->sets * ASSOCIATE * sizeof (uint32_t));
+	memset (c->tags, 0xFF, (size_t) c->sets * ASSOCIATE * sizeof (uint64_t));
+	memset (c->stamps, 0, (size_t) c->sets * ASSOCIATE * sizeof (uint32_t));
+	c->clock = 0;
+}
+
+static void sim_free (cache_sim_t *c)
+{
+	free (c->tags);
+	free (c->stamps);
+}
+
+/* Returns 1 on a miss, after which the line is cached */
+inline static int sim_access (cache_sim_t *c, const void *address)
+{
+	const uint64_t line = (uint64_t) (uintptr_t) address / LINESIZE;
+	const int set = (int) (line % (uint64_t) c->sets);
+	uint64_t *tags = &c->tags[set * ASSOCIATE];
+	uint32_t *stamps = &c->stamps[set * ASSOCIATE];
+	const uint32_t now = ++c->clock;
+	int victim = 0;
+	for (int w = 0; w < ASSOCIATE; w++) {
+		if (tags[w] == line) {
+			stamps[w] = now;
+			return 0;
+		}
+		if (stamps[w] < stamps[victim])
+			victim = w;
+	}
+	tags[victim] = line;
+	stamps[victim] = now;
+	return 1;
+}
+
+/* Weighted misses of every row when each block of the partition runs
+	 through its own cold cache: the matrix streams (weight 1), x
+	 (MISS_X_WEIGHT) and y (MISS_Y_WEIGHT) */
+static void miss_costs (const csr_t *A, const fptype_t *x, const fptype_t *y,
+												int nparts, const int *partition, double *cost)
+{
+	#pragma omp parallel for num_threads(nparts) schedule(dynamic, 1)
+	for (int t = 0; t < nparts; t++) {
+		cache_sim_t c;
+		sim_init (&c);
+		for (int i = partition[t]; i < partition[t + 1]; i++) {
+			int stream = sim_access (&c, &A->rowptr[i + 1]);
+			int xmisses = 0;
+			for (int k = A->rowptr[i]; k < A->rowptr[i + 1]; k++) {
+				stream += sim_access (&c, &A->val[k]);
+				stream += sim_access (&c, &A->colidx[k]);
+				xmisses += sim_access (&c, &x[A->colidx[k]]);
+			}
+			const int ymisses = sim_access (&c, &y[i]);
+			cost[i] = stream + MISS_X_WEIGHT * xmisses + MISS_Y_WEIGHT * ymisses;
+		}
+		sim_free (&c);
+	}
+}
+
+void miss_partition (const csr_t *A, const fptype_t *x, const fptype_t *y, int nparts, int *partition)
+{
+	double *cost = (double *) malloc (A->m * sizeof (double));
+	double *prefix = (double *) malloc ((A->m + 1) * sizeof (double));
+	/* Where a block starts changes what its cache holds, so simulate the
+		 current cut and re-cut until it settles */
+	nnz_partition (A, nparts, ROW, partition);
+	for (int iteration = 0; iteration < MISS_ITERATIONS; iteration++) {
+		miss_costs (A, x, y, nparts, partition, cost);
+		prefix[0] = 0.0;
+		for (int i = 0; i < A->m; i++)
+			prefix[i + 1] = prefix[i] + cost[i];
+		partition_prefix (prefix, A->m, nparts, partition);
+	}
+	free (prefix);
+	free (cost);
+}
+
+double miss_imbalance (const csr_t *A, const fptype_t *x, const fptype_t *y, int nparts, const int *partition)
+{
+	double *cost = (double *) malloc (A->m * sizeof (double));
+	miss_costs (A, x, y, nparts, partition, cost);
+	double sum = 0.0;
+	double largest = 0.0;
+	for (int t = 0; t < nparts; t++) {
+		double block = 0.0;
+		for (int i = partition[t]; i < partition[t + 1]; i++)
+			block += cost[i];
+		sum += block;
+		largest = max (largest, block);
+	}
+	free (cost);
+	return sum > 0.0 ? largest / (sum / nparts) : 1.0;
+}
+/* =================================================================== */
+
+void adaptive_partition (const csr_t *A, int nparts, const double *busy, int *partition)
+{
+	/* Mean seconds per unit of work over the timed blocks */
+	double timed = 0.0;
+	double timedwork = 0.0;
+	for (int t = 0; t < nparts; t++) {
+		const int r0 = partition[t];
+		const int r1 = partition[t + 1];
+		const double work = (double) (A->rowptr[r1] - A->rowptr[r0]) + (r1 - r0);
+		if (work > 0.0 && busy[t] > 0.0) {
+			timed += busy[t];
+			timedwork += work;
+		}
+	}
+	const double mean = timedwork > 0.0 ? timed / timedwork : 0.0;
+
+	double *prefix = (double *) malloc ((A->m + 1) * sizeof (double));
+	prefix[0] = 0.0;
+	for (int t = 0; t < nparts; t++) {
+		const int r0 = partition[t];
+		const int r1 = partition[t + 1];
+		const double work = (double) (A->rowptr[r1] - A->rowptr[r0]) + (r1 - r0);
+		/* Seconds per unit of work in this block; a block without a
+			 time keeps the mean rate so its rows still count */
+		const double rate = (work > 0.0 && busy[t] > 0.0) ? busy[t] / work : mean;
+		for (int i = r0; i < r1; i++) {
+			const double w = (double) (A->rowptr[i + 1] - A->rowptr[i]) + 1.0;
+			prefix[i + 1] = prefix[i] + w * rate;
+		}
+	}
+	if (prefix[A->m] > 0.0)
+		partition_prefix (prefix, A->m, nparts, partition);
+	free (prefix);
+}
+
+int build_tasks (const csr_t *A, int balancer, int nqueue, int ntasksperqueue, int *task_rows)
+{
+	const int ntasks = nqueue * ntasksperqueue;
+	if (balancer != HYBRID_BAL || ntasksperqueue < 2) {
+		nnz_partition (A, ntasks, ROW, task_rows);
+	} else {
+		/* One nonzero-balanced block per queue: its first task holds
+			 HYBRID_STATIC_SHARE of the block, the rest is cut finely */
+		int *blocks = (int *) malloc ((nqueue + 1) * sizeof (int));
+		double *prefix = (double *) malloc ((A->m + 1) * sizeof (double));
+		nnz_partition (A, nqueue, ROW, blocks);
+		for (int q = 0; q < nqueue; q++) {
+			const int r0 = blocks[q];
+			const int r1 = blocks[q + 1];
+			const int base = A->rowptr[r0];
+			const int nnz = A->rowptr[r1] - base;
+			int *t = &task_rows[q * ntasksperqueue];
+			/* Cost prefix over the block: the static task counts as
+				 ntasksperqueue - 1 fine tasks' worth */
+			const double scale = (ntasksperqueue - 1) * HYBRID_STATIC_SHARE / (1.0 - HYBRID_STATIC_SHARE);
+			const double split = HYBRID_STATIC_SHARE * nnz;
+			for (int i = r0; i <= r1; i++) {
+				const double x = A->rowptr[i] - base;
+				prefix[i - r0] = x <= split ? x / scale : split / scale + (x - split);
+			}
+			partition_prefix (prefix, r1 - r0, ntasksperqueue, t);
+			for (int k = 0; k < ntasksperqueue; k++)
+				t[k] += r0;
+		}
+		task_rows[ntasks] = A->m;
+		free (prefix);
+		free (blocks);
+	}
+	return ntasks;
+}
@@ -0,0 +1,75 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Load balancers of the SpMV benchmark.
+
+	 Static (NNZ_BAL, MISS_BAL) and adaptive (ADAPTIVE_BAL) balancers cut the
+	 matrix into one contiguous block per thread, stored in g_partition:
+	 thread t owns rows (or, with ELEMENT granularity, nonzeros)
+	 [g_partition[t], g_partition[t+1]). The dynamic balancers cut it into
+	 row-block tasks handed out at run time (generic/common/tasks.h):
+	 SHARE_BAL from one shared queue, STEAL_BAL and HYBRID_BAL from g_nqueue
+	 work-stealing deques of g_ntasksperqueue tasks each.
+ */
+
+#ifndef __BALANCE_H__
+#define __BALANCE_H__
+
+#include "matrix.h"
+
+// share of a thread's nonzeros HYBRID_BAL keeps in its first, static task
+#define HYBRID_STATIC_SHARE 0.75
+// simulate-and-cut rounds of MISS_BAL
+#define MISS_ITERATIONS 3
+
+const char *balancer_name (int balancer);
+
+/** \brief Balancer ID from its name (nnz, miss, adaptive, share, steal,
+ * hybrid), 0 if unknown. */
+int balancer_from_name (const char *name);
+
+/** \brief Cut [0, m) into nparts blocks of equal cost, given the prefix
+ * sums of the per-row cost (m + 1 entries, prefix[0] = 0). */
+void partition_prefix (const double *prefix, int m, int nparts, int *partition);
+
+/** \brief Blocks of equal nonzeros: row boundaries (ROW) or exact nonzero
+ * offsets (ELEMENT). */
+void nnz_partition (const csr_t *A, int nparts, int granularity, int *partition);
+
+/** \brief Row blocks of equal weighted cache misses. Each block's accesses
+ * to the matrix, x and y are run through a simulated CACHESIZE-byte,
+ * ASSOCIATE-way LRU cache; x misses weigh MISS_X_WEIGHT, y misses
+ * MISS_Y_WEIGHT and matrix misses 1. Starts from the nnz partition and
+ * re-cuts MISS_ITERATIONS times. */
+void miss_partition (const csr_t *A, const fptype_t *x, const fptype_t *y, int nparts, int *partition);
+
+/** \brief Largest block's simulated weighted misses over the mean. */
+double miss_imbalance (const csr_t *A, const fptype_t *x, const fptype_t *y, int nparts, const int *partition);
+
+/** \brief Re-cut a row partition so every block takes equal time, costing
+ * each row of block t as busy[t] spread over that block's rows and
+ * nonzeros. */
+void adaptive_partition (const csr_t *A, int nparts, const double *busy, int *partition);
+
+/** \brief Build the tasks of a dynamic balancer: task_rows gets the
+ * row boundaries of nqueue * ntasksperqueue tasks, those of queue q being
+ * q * ntasksperqueue onwards. Returns the number of tasks. */
+int build_tasks (const csr_t *A, int balancer, int nqueue, int ntasksperqueue, int *task_rows);
+
+#endif /* __BALANCE_H__ */
@@ -0,0 +1,215 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* x86-64 port of ../bench.c: the KNC load+FMA intensity model with the
+	 ratio chosen at runtime, run with AVX-512 or, on CPUs without it, AVX2 */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+#include <omp.h>
+#include "bench.h"
+#include "affinity.h"
+#include "barrier.h"
+#include "chase.h"
+#include "cpuid.h"
+#include "timer.h"
+#include "timeline.h"
+
+
+#define SIZEPERTHREAD 400000
+#define NRUNS   10
+#define GHZ     1e9
+
+
+barrier::TreeBarrier tbarrier;
+
+inline static void Barrier(int tid) {
+	tbarrier.Wait(tid);
+}
+
+int main (int argc, char **argv)
+{
+	int nthreads;
+	int nn;
+	int dp;
+	bench::isa_t isa;
+	bench::kernel_t kernel;
+	double density;
+	double bandwidth[NRUNS];
+	double flops[NRUNS];
+	double execTime[NRUNS];
+	uint64_t ticks[NRUNS];
+	double maxflops;
+	double maxbandwidth;
+	double minTime;
+	uint64_t minTicks;
+	int best;
+
+	if (argc < 3 || argc > 5) {
+		printf ("Usage: %s <no. of threads> <ratio> [single|double] [avx512|avx2]\n", argv[0]);
+		exit (0);
+	}
+	/* Number of threads to use */
+	nthreads = atoi (argv[1]);
+	/* 512-bit FMAs per 64-byte line */
+	nn = atoi (argv[2]);
+	dp = !(argc > 3 && strcmp (argv[3], "single") == 0);
+	if (nthreads < 1 || nthreads > BARRIER_MAX_THREADS || nn < 0) {
+		fprintf (stderr, "Error: need 1-%d threads and a ratio >= 0\n", BARRIER_MAX_THREADS);
+		return 1;
+	}
+
+	/* AVX-512 when the CPU and OS support it, AVX2-FMA otherwise */
+	if (!cpu::has_avx2 () || !cpu::has_fma ()) {
+		fprintf (stderr, "Error: the CPU supports neither AVX-512 nor AVX2-FMA\n");
+		return 1;
+	}
+	isa = cpu::has_avx512f () ? bench::ISA_AVX512 : bench::ISA_AVX2_FMA;
+	if (argc > 4 && strcmp (argv[4], "avx2") == 0)
+		isa = bench::ISA_AVX2_FMA;
+	else if (argc > 4 && isa != bench::ISA_AVX512)
+		fprintf (stderr, "Warning: AVX-512 not supported, falling back to AVX2-FMA\n");
+	if (isa == bench::ISA_AVX512)
+		kernel = dp ? bench::avx512_double : bench::avx512_float;
+	else
+		kernel = dp ? bench::avx2_fma_double : bench::avx2_fma_float;
+
+	/* Lines per thread, as SIZEPERTHREAD zmm-sized vectors on KNC */
+	const size_t linesperthread = SIZEPERTHREAD;
+	const size_t elemsize = dp ? sizeof (double) : sizeof (float);
+	const size_t simdw = BENCH_LINE_BYTES / elemsize;
+	/* Number of elements per thread */
+	const size_t sizeperthread = linesperthread * simdw;
+	/* Total array size */
+	const size_t arraysize = sizeperthread * nthreads;
+	const size_t arraybytes = arraysize * elemsize;
+	/* Allocate memory for the array */
+	char *A = (char *) chase::allocate (arraybytes);
+	if (A == NULL) {
+		fprintf (stderr, "Error: cannot allocate %zu bytes\n", arraybytes);
+		return 1;
+	}
+
+	/* For each 512/8 Bytes of data loaded, you do (SIMDW units FMA * nn) */
+	density = 2.0 * nn * simdw / (512 / 8);
+
+	fprintf (stderr, "Run x86-64 microbenchmark: %s (%s, %s)\n  nn = %d\n  density (flops/bytes) = %.2lf\n  array size = %.2lf MB (%.2lf MB per thread)\n",
+					 argv[0], isa == bench::ISA_AVX512 ? "AVX-512" : "AVX2-FMA",
+					 dp ? "double" : "single", nn, density,
+					 arraybytes / 1024.0 / 1024.0,
+					 sizeperthread * elemsize / 1024.0 / 1024.0);
+
+	/* Initialize threading mechanism; threads are pinned compact as with
+		 KMP_AFFINITY unless UBENCH_CPUS or UBENCH_AFFINITY say otherwise */
+	omp_set_dynamic (0);
+	omp_set_num_threads (nthreads);
+	affinity::pin_team_from_env (nthreads, affinity::POLICY_COMPACT, 1);
+	tbarrier.Init (nthreads);
+
+	/* Initialize timer */
+	timer::init ();
+	struct timeval now;
+	int rc = gettimeofday (&now, NULL);
+	if(rc==0) {
+		fprintf(stderr, "Time = %lu.%06lu\n", now.tv_sec, now.tv_usec);
+	}
+
+	/* Per-thread stamps of every run, one cache line per thread */
+	uint64_t *stamps = timeline::allocate (NRUNS, nthreads);
+	if (stamps == NULL) {
+		fprintf (stderr, "Error: cannot allocate the timeline\n");
+		return 1;
+	}
+
+	/* First touch by the owning thread places each share on its node */
+	#pragma omp parallel for num_threads(nthreads) schedule(static, 1)
+	for (int tid = 0; tid < nthreads; tid++)
+		memset (A + tid * linesperthread * BENCH_LINE_BYTES, 0, linesperthread * BENCH_LINE_BYTES);
+
+	/* Start execution */
+	for (int run = 0; run < NRUNS; run++)
+	{
+		uint64_t *mytime = timeline::run (stamps, nthreads, run);
+
+		/* One loop iteration per thread */
+		#pragma omp parallel for num_threads(nthreads) schedule(static, 1)
+		for (int tid = 0; tid < nthreads; tid++)
+		{
+			double result[2];
+
+			/* Find this thread/iteration's starting point in the global array */
+			const char *start = A + tid * linesperthread * BENCH_LINE_BYTES;
+
+			/* Start time measurement */
+			const uint64_t t0 = timer::get_ticks_acquire ();
+			Barrier (tid);
+			mytime[TIMELINE_SLOT (tid, TIMELINE_BARRIER_EXIT)] = timer::get_ticks_acquire ();
+
+			kernel (start, linesperthread, nn, result);
+
+			mytime[TIMELINE_SLOT (tid, TIMELINE_WORK_END)] = timer::get_ticks_release ();
+			Barrier (tid);
+			const uint64_t t1 = timer::get_ticks_release ();
+			mytime[TIMELINE_SLOT (tid, TIMELINE_START)] = t0;
+			mytime[TIMELINE_SLOT (tid, TIMELINE_END)] = t1;
+
+			if (tid == 0) {
+				ticks[run] = timer::elapsed_ticks (t0, t1);
+				execTime[run] = timer::ticks_to_secs (ticks[run]);
+				flops[run] = nn * 2.0 * arraysize / execTime[run] / GHZ;
+				bandwidth[run] = (double) arraybytes / execTime[run] / GHZ;
+			}
+		}
+	}
+
+	maxflops = 0.0;
+	maxbandwidth = 0.0;
+	minTime = 1000.0;
+	minTicks = ~0ull;
+	best = 0;
+	for (int run = 0; run < NRUNS; run++) {
+		maxflops = maxflops > flops[run] ? maxflops : flops[run];
+		maxbandwidth = maxbandwidth > bandwidth[run] ? maxbandwidth :
+									 bandwidth[run];
+		minTime = minTime < execTime[run] ? minTime : execTime[run];
+		if (ticks[run] < minTicks) {
+			minTicks = ticks[run];
+			best = run;
+		}
+	}
+
+	fprintf (stderr , "%.2lf, %.3lf Gflops, %.3lf GB/s %.8lf secs %llu cycles %d iters\n",
+					 density, maxflops, maxbandwidth, minTime,
+					 (unsigned long long) minTicks, NRUNS);
+
+	/* Whether the best run was held back by a few slow threads */
+	timeline::stats_t stragglers;
+	timeline::analyse (timeline::run (stamps, nthreads, best), nthreads, &stragglers);
+	timeline::report ("best run", &stragglers);
+	const char *trace = getenv ("UBENCH_TRACE");
+	if (trace != NULL && timeline::write_chrome (trace, argv[0], stamps, NRUNS, nthreads) != 0)
+		fprintf (stderr, "Warning: cannot write the timeline to %s\n", trace);
+
+	free (stamps);
+	chase::release (A, arraybytes);
+	return 0;
+}
@@ -0,0 +1,173 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* x86-64 port of the KNC load+FMA kernel in ../bench.c.
+
+	 For every 64-byte line of its share of the array a thread issues `ratio`
+	 512-bit FMAs (zmm0..zmm9 round-robin, as in the KNC code) and one
+	 prefetcht1, the x86 counterpart of vprefetch1. The AVX2 fallback covers
+	 a line with two ymm FMAs per 512-bit FMA, so flops per byte do not
+	 depend on the instruction set.
+
+	 The ratio is a runtime argument: the FMAs of a line are split into
+	 blocks of BENCH_ACCUMULATORS, issued in a loop, and a tail of fewer,
+	 unrolled at compile time for every possible length.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <immintrin.h>
+
+#define BENCH_LINE_BYTES   64
+#define BENCH_ACCUMULATORS 10
+
+namespace bench {
+
+	enum isa_t {
+		ISA_AVX2_FMA = 0,
+		ISA_AVX512
+	};
+
+	/** \brief Runs the kernel over `lines` 64-byte lines from `data`; the
+	 * accumulators are summed into *result so the FMAs cannot be removed. */
+	typedef void (*kernel_t)(const void* data, size_t lines, int ratio, void* result);
+
+	/* Kernels for each precision, defined in kernels-<isa>.cpp */
+	void avx2_fma_float(const void* data, size_t lines, int ratio, void* result);
+	void avx2_fma_double(const void* data, size_t lines, int ratio, void* result);
+	void avx512_float(const void* data, size_t lines, int ratio, void* result);
+	void avx512_double(const void* data, size_t lines, int ratio, void* result);
+
+	/* ----------------------------------------------------------------- */
+	/* Vector traits: per_line vector FMAs make one 512-bit FMA */
+
+	template <typename T, int ISA> struct simd;
+
+#if defined(__AVX2__) && defined(__FMA__)
+	template <> struct simd<float, ISA_AVX2_FMA> {
+		typedef __m256 vector_t;
+		enum { lanes = 8, per_line = 2 };
+		static inline vector_t set1(float x) { return _mm256_set1_ps(x); }
+		static inline vector_t fmadd(vector_t a, vector_t b, vector_t c) { return _mm256_fmadd_ps(a, b, c); }
+		static inline vector_t add(vector_t a, vector_t b) { return _mm256_add_ps(a, b); }
+		static inline void store(float* p, vector_t v) { _mm256_storeu_ps(p, v); }
+	};
+
+	template <> struct simd<double, ISA_AVX2_FMA> {
+		typedef __m256d vector_t;
+		enum { lanes = 4, per_line = 2 };
+		static inline vector_t set1(double x) { return _mm256_set1_pd(x); }
+		static inline vector_t fmadd(vector_t a, vector_t b, vector_t c) { return _mm256_fmadd_pd(a, b, c); }
+		static inline vector_t add(vector_t a, vector_t b) { return _mm256_add_pd(a, b); }
+		static inline void store(double* p, vector_t v) { _mm256_storeu_pd(p, v); }
+	};
+#endif
+
+#if defined(__AVX512F__)
+	template <> struct simd<float, ISA_AVX512> {
+		typedef __m512 vector_t;
+		enum { lanes = 16, per_line = 1 };
+		static inline vector_t set1(float x) { return _mm512_set1_ps(x); }
+		static inline vector_t fmadd(vector_t a, vector_t b, vector_t c) { return _mm512_fmadd_ps(a, b, c); }
+		static inline vector_t add(vector_t a, vector_t b) { return _mm512_add_ps(a, b); }
+		static inline void store(float* p, vector_t v) { _mm512_storeu_ps(p, v); }
+	};
+
+	template <> struct simd<double, ISA_AVX512> {
+		typedef __m512d vector_t;
+		enum { lanes = 8, per_line = 1 };
+		static inline vector_t set1(double x) { return _mm512_set1_pd(x); }
+		static inline vector_t fmadd(vector_t a, vector_t b, vector_t c) { return _mm512_fmadd_pd(a, b, c); }
+		static inline vector_t add(vector_t a, vector_t b) { return _mm512_add_pd(a, b); }
+		static inline void store(double* p, vector_t v) { _mm512_storeu_pd(p, v); }
+	};
+#endif
+
+	/* ----------------------------------------------------------------- */
+	/* acc = acc * b + a, the VFMADD132 zmmN, zmm11, zmm12 of the KNC code;
+		 b = 0.5 keeps the accumulators bounded and clear of denormals */
+
+	#define BENCH_FMA(n) acc##n = S::fmadd(acc##n, b, a)
+
+	template <typename T, int ISA, int TAIL>
+	inline static void lines_loop(const char* data, size_t lines, int blocks, T* result) {
+		typedef simd<T, ISA> S;
+		typedef typename S::vector_t vector_t;
+		const vector_t a = S::set1(T(1));
+		const vector_t b = S::set1(T(0.5));
+		vector_t acc0 = a, acc1 = a, acc2 = a, acc3 = a, acc4 = a;
+		vector_t acc5 = a, acc6 = a, acc7 = a, acc8 = a, acc9 = a;
+
+		for (size_t i = 0; i < lines; i++) {
+			const char* line = data + i * BENCH_LINE_BYTES;
+			for (int k = 0; k < blocks; k++) {
+				BENCH_FMA(0); BENCH_FMA(1); BENCH_FMA(2); BENCH_FMA(3); BENCH_FMA(4);
+				BENCH_FMA(5); BENCH_FMA(6); BENCH_FMA(7); BENCH_FMA(8); BENCH_FMA(9);
+			}
+			_mm_prefetch(line, _MM_HINT_T1);
+			if (TAIL >= 1) BENCH_FMA(0);
+			if (TAIL >= 2) BENCH_FMA(1);
+			if (TAIL >= 3) BENCH_FMA(2);
+			if (TAIL >= 4) BENCH_FMA(3);
+			if (TAIL >= 5) BENCH_FMA(4);
+			if (TAIL >= 6) BENCH_FMA(5);
+			if (TAIL >= 7) BENCH_FMA(6);
+			if (TAIL >= 8) BENCH_FMA(7);
+			if (TAIL >= 9) BENCH_FMA(8);
+		}
+
+		acc0 = S::add(S::add(S::add(acc0, acc1), S::add(acc2, acc3)), acc4);
+		acc5 = S::add(S::add(S::add(acc5, acc6), S::add(acc7, acc8)), acc9);
+		T sum[S::lanes];
+		S::store(sum, S::add(acc0, acc5));
+		T total = T(0);
+		for (int i = 0; i < int(S::lanes); i++)
+			total += sum[i];
+		*result = total;
+	}
+
+	#undef BENCH_FMA
+
+	/** \brief ratio 512-bit FMAs per line: picks the tail variant for the
+	 * vector FMAs that do not fill a block. */
+	template <typename T, int ISA>
+	inline static void kernel(const void* data, size_t lines, int ratio, void* result) {
+		const int fmas = ratio * int(simd<T, ISA>::per_line);
+		const int blocks = fmas / BENCH_ACCUMULATORS;
+		const char* p = (const char*) data;
+		T* r = (T*) result;
+		switch (fmas % BENCH_ACCUMULATORS) {
+			case 0: lines_loop<T, ISA, 0>(p, lines, blocks, r); break;
+			case 1: lines_loop<T, ISA, 1>(p, lines, blocks, r); break;
+			case 2: lines_loop<T, ISA, 2>(p, lines, blocks, r); break;
+			case 3: lines_loop<T, ISA, 3>(p, lines, blocks, r); break;
+			case 4: lines_loop<T, ISA, 4>(p, lines, blocks, r); break;
+			case 5: lines_loop<T, ISA, 5>(p, lines, blocks, r); break;
+			case 6: lines_loop<T, ISA, 6>(p, lines, blocks, r); break;
+			case 7: lines_loop<T, ISA, 7>(p, lines, blocks, r); break;
+			case 8: lines_loop<T, ISA, 8>(p, lines, blocks, r); break;
+			default: lines_loop<T, ISA, 9>(p, lines, blocks, r); break;
+		}
+	}
+
+}
+
+#endif /* BENCH_H */
@@ -0,0 +1,67 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "common.h"
+#include "affinity.h"
+
+
+// global variables
+int g_balancer;
+int g_m;
+int g_n;
+int g_nnz;
+fptype_t *g_x;
+int *g_partition;
+fptype_t *g_y;
+pthread_mutex_t *g_lock_y;
+barrier::TreeBarrier tbarrier;
+char g_filename[1024];
+int g_nqueue;
+int g_ntasksperqueue;
+
+
+void initvec (fptype_t * v, int size, fptype_t initval)
+{
+	int i;
+	if (initval < 0.0)
+	{
+		for (i = 0; i < size; i++)
+		{
+			v[i] = (double)(i % 10000) / 10000;
+		}
+	}
+	else
+	{
+		for (i = 0; i < size; i++)
+		{
+			v[i] = initval;
+		}
+	}
+}
+
+
+/* Threads are pinned with generic/common/affinity.h: UBENCH_CPUS or
+	 UBENCH_AFFINITY, by default compact as KMP_AFFINITY=granularity=fine,compact
+	 was; UBENCH_AFFINITY=none leaves placement to OMP_PROC_BIND and OMP_PLACES */
+void initomp (int nthreads, int verbose)
+{
+	omp_set_dynamic (0);
+	omp_set_num_threads (nthreads);
+	affinity::pin_team_from_env (nthreads, affinity::POLICY_COMPACT, verbose == 1);
+}
@@ -0,0 +1,133 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* x86-64 counterpart of ../common.h: the configuration and the globals of
+	 the SpMV benchmark, without the KNC intrinsics and the Intel runtime */
+
+#ifndef __COMMON_H__
+#define __COMMON_H__
+
+#include <immintrin.h>
+#include <stdio.h>
+#include <omp.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <assert.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "barrier.h"
+
+#define min(a,b) (((a)>(b))?(b):(a))
+#define max(a,b) (((a)<(b))?(b):(a))
+
+// Hardware configuration; the cache is the per-core KNC L2 the miss
+// model simulates (build with e.g. -DCACHESIZE='2048*1024' -DASSOCIATE=16
+// to model another L2)
+#define MAXTHREADS        BARRIER_MAX_THREADS
+#define GHZ               1e9
+#define LINESIZE          64
+#ifndef CACHESIZE
+#define CACHESIZE         512*1024
+#endif
+#ifndef ASSOCIATE
+#define ASSOCIATE         8
+#endif
+
+#define MISS_X_WEIGHT     4
+#define MISS_Y_WEIGHT     1
+
+// double precision
+#if defined(_PRECISION_) && (_PRECISION_ == 2)
+#define FZERO 0.0
+#define THRESH 0.000001
+#define fptype_t double
+#define SIMDW 8
+#define NONE -1.0
+typedef unsigned char bitmask_t;
+// single precision
+#elif defined(_PRECISION_) && (_PRECISION_ == 1)
+#define FZERO 0.0f
+#define THRESH 0.0005f
+#define fptype_t float
+#define SIMDW 16
+#define NONE -1.0f
+typedef unsigned short bitmask_t;
+// error
+#else
+#error "Undefined _PRECISION_: should be 1 (single) or 2 (double)"
+#endif /* #if defined(_PRECISION_) && (_PRECISION_ == 2) */
+
+// partition granularity
+#define ROW 0
+#define ELEMENT 1
+
+// load balancers
+// static
+#define NNZ_BAL      1
+#define MISS_BAL     2
+// adaptive
+#define ADAPTIVE_BAL 3
+//dynamic
+#define SHARE_BAL    4
+#define STEAL_BAL    5
+#define HYBRID_BAL   6
+
+// locks guarding rows split between threads
+#define NLOCKS_Y     64
+
+#define Barrier(tid) tbarrier.Wait(tid)
+
+/* Anonymous mapping, backed by transparent huge pages where allowed */
+inline static void* _my_malloc(size_t size, size_t alignment) {
+	(void) alignment;
+	void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		return NULL;
+	#ifdef MADV_HUGEPAGE
+		madvise(p, size, MADV_HUGEPAGE);
+	#endif
+	return p;
+}
+#define MY_MALLOC_FAILED NULL
+#define _my_free(addr, size) munmap(addr, size)
+
+
+extern int g_balancer;
+extern int g_m;
+extern int g_n;
+extern int g_nnz;
+extern fptype_t *g_x;
+extern int *g_partition;
+extern fptype_t *g_y;
+extern pthread_mutex_t *g_lock_y;
+extern barrier::TreeBarrier tbarrier;
+extern char g_filename[1024];
+extern int g_nqueue;
+extern int g_ntasksperqueue;
+
+
+void initvec (fptype_t * v, int size, fptype_t initval);
+
+void initomp (int nthreads, int verbose);
+
+
+#endif /* __COMMON_H__ */
@@ -0,0 +1,291 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "matrix.h"
+
+
+enum field_t { FIELD_REAL, FIELD_INTEGER, FIELD_PATTERN };
+enum symmetry_t { SYM_GENERAL, SYM_SYMMETRIC, SYM_SKEW };
+
+
+/* Cursor over the mapped file; nothing is read at or past end */
+struct cursor_t {
+	const char *p;
+	const char *end;
+	int line;
+};
+
+static void skip_blanks (cursor_t *c)
+{
+	while (c->p < c->end && (*c->p == ' ' || *c->p == '\t' || *c->p == '\r'))
+		c->p++;
+}
+
+static void next_line (cursor_t *c)
+{
+	while (c->p < c->end && *c->p != '\n')
+		c->p++;
+	if (c->p < c->end) {
+		c->p++;
+		c->line++;
+	}
+}
+
+/* Copies the next whitespace-delimited token of the current line */
+static int read_token (cursor_t *c, char *token, size_t size)
+{
+	size_t len = 0;
+	skip_blanks (c);
+	while (c->p < c->end && !isspace ((unsigned char) *c->p)) {
+		if (len + 1 < size)
+			token[len++] = *c->p;
+		c->p++;
+	}
+	token[len] = '\0';
+	return len > 0 ? 0 : -1;
+}
+
+static int read_long (cursor_t *c, long *value)
+{
+	char token[64];
+	char *tail;
+	if (read_token (c, token, sizeof (token)) != 0)
+		return -1;
+	*value = strtol (token, &tail, 10);
+	return *tail == '\0' ? 0 : -1;
+}
+
+static int read_double (cursor_t *c, double *value)
+{
+	char token[64];
+	char *tail;
+	if (read_token (c, token, sizeof (token)) != 0)
+		return -1;
+	*value = strtod (token, &tail);
+	return *tail == '\0' ? 0 : -1;
+}
+
+static int parse_banner (cursor_t *c, field_t *field, symmetry_t *symmetry)
+{
+	char token[64];
+	if (read_token (c, token, sizeof (token)) != 0 || strcmp (token, "%%MatrixMarket") != 0) {
+		fprintf (stderr, "Error: not a Matrix Market file (no %%%%MatrixMarket banner)\n");
+		return -1;
+	}
+	if (read_token (c, token, sizeof (token)) != 0 || strcasecmp (token, "matrix") != 0) {
+		fprintf (stderr, "Error: Matrix Market object \"%s\" is not a matrix\n", token);
+		return -1;
+	}
+	if (read_token (c, token, sizeof (token)) != 0 || strcasecmp (token, "coordinate") != 0) {
+		fprintf (stderr, "Error: only coordinate (sparse) Matrix Market files are supported\n");
+		return -1;
+	}
+	read_token (c, token, sizeof (token));
+	if (strcasecmp (token, "real") == 0 || strcasecmp (token, "double") == 0)
+		*field = FIELD_REAL;
+	else if (strcasecmp (token, "integer") == 0)
+		*field = FIELD_INTEGER;
+	else if (strcasecmp (token, "pattern") == 0)
+		*field = FIELD_PATTERN;
+	else {
+		fprintf (stderr, "Error: unsupported Matrix Market field \"%s\"\n", token);
+		return -1;
+	}
+	read_token (c, token, sizeof (token));
+	if (strcasecmp (token, "general") == 0)
+		*symmetry = SYM_GENERAL;
+	else if (strcasecmp (token, "symmetric") == 0 || strcasecmp (token, "hermitian") == 0)
+		*symmetry = SYM_SYMMETRIC;
+	else if (strcasecmp (token, "skew-symmetric") == 0)
+		*symmetry = SYM_SKEW;
+	else {
+		fprintf (stderr, "Error: unsupported Matrix Market symmetry \"%s\"\n", token);
+		return -1;
+	}
+	next_line (c);
+	return 0;
+}
+
+/* Entries sorted by column first, so the stable scatter into rows leaves
+	 the column indices of every row in ascending order */
+static int coo_to_csr (int m, int n, int nnz, const int *row, const int *col,
+											 const fptype_t *val, csr_t *A)
+{
+	int *count = (int *) calloc ((m > n ? m : n) + 1, sizeof (int));
+	int *order = (int *) malloc ((size_t) nnz * sizeof (int));
+	A->rowptr = (int *) _my_malloc ((size_t) (m + 1) * sizeof (int), 64);
+	A->colidx = (int *) _my_malloc ((size_t) nnz * sizeof (int) + 1, 64);
+	A->val = (fptype_t *) _my_malloc ((size_t) nnz * sizeof (fptype_t) + 1, 64);
+	if (count == NULL || order == NULL || A->rowptr == MY_MALLOC_FAILED ||
+			A->colidx == MY_MALLOC_FAILED || A->val == MY_MALLOC_FAILED) {
+		fprintf (stderr, "Error: out of memory converting %d nonzeros to CSR\n", nnz);
+		free (count);
+		free (order);
+		return -1;
+	}
+
+	/* Counting sort by column */
+	for (int k = 0; k < nnz; k++)
+		count[col[k] + 1]++;
+	for (int j = 0; j < n; j++)
+		count[j + 1] += count[j];
+	for (int k = 0; k < nnz; k++)
+		order[count[col[k]]++] = k;
+
+	/* Stable counting sort by row */
+	memset (A->rowptr, 0, (size_t) (m + 1) * sizeof (int));
+	for (int k = 0; k < nnz; k++)
+		A->rowptr[row[k] + 1]++;
+	for (int i = 0; i < m; i++)
+		A->rowptr[i + 1] += A->rowptr[i];
+	memset (count, 0, (size_t) m * sizeof (int));
+	for (int t = 0; t < nnz; t++) {
+		const int k = order[t];
+		const int dst = A->rowptr[row[k]] + count[row[k]]++;
+		A->colidx[dst] = col[k];
+		A->val[dst] = val[k];
+	}
+
+	free (count);
+	free (order);
+	A->m = m;
+	A->n = n;
+	A->nnz = nnz;
+	return 0;
+}
+
+int read_matrix_market (const char *path, csr_t *A)
+{
+	memset (A, 0, sizeof (*A));
+	const int fd = open (path, O_RDONLY);
+	if (fd < 0) {
+		fprintf (stderr, "Error: cannot open %s\n", path);
+		return -1;
+	}
+	struct stat st;
+	if (fstat (fd, &st) != 0 || st.st_size == 0) {
+		fprintf (stderr, "Error: cannot read %s\n", path);
+		close (fd);
+		return -1;
+	}
+	const size_t size = (size_t) st.st_size;
+	void *map = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd);
+	if (map == MAP_FAILED) {
+		fprintf (stderr, "Error: cannot map %s\n", path);
+		return -1;
+	}
+	madvise (map, size, MADV_SEQUENTIAL);
+
+	cursor_t c = { (const char *) map, (const char *) map + size, 1 };
+	field_t field;
+	symmetry_t symmetry;
+	int rc = -1;
+	int *row = NULL;
+	int *col = NULL;
+	fptype_t *val = NULL;
+	long m, n, entries;
+	long k = 0;
+	long nnz = 0;
+
+	if (parse_banner (&c, &field, &symmetry) != 0)
+		goto done;
+	/* Comments and blank lines up to the size line */
+	for (;;) {
+		skip_blanks (&c);
+		if (c.p >= c.end || (*c.p != '%' && *c.p != '\n'))
+			break;
+		next_line (&c);
+	}
+	if (read_long (&c, &m) != 0 || read_long (&c, &n) != 0 || read_long (&c, &entries) != 0 ||
+			m <= 0 || n <= 0 || entries < 0 || m > INT32_MAX - 1 || n > INT32_MAX - 1) {
+		fprintf (stderr, "Error: %s:%d: bad size line\n", path, c.line);
+		goto done;
+	}
+	if ((symmetry != SYM_GENERAL && m != n) ||
+			(symmetry != SYM_GENERAL ? 2 * entries : entries) > INT32_MAX) {
+		fprintf (stderr, "Error: %s: %ld x %ld with %ld entries is not supported\n", path, m, n, entries);
+		goto done;
+	}
+	next_line (&c);
+
+	row = (int *) malloc ((symmetry != SYM_GENERAL ? 2 : 1) * entries * sizeof (int) + 1);
+	col = (int *) malloc ((symmetry != SYM_GENERAL ? 2 : 1) * entries * sizeof (int) + 1);
+	val = (fptype_t *) malloc ((symmetry != SYM_GENERAL ? 2 : 1) * entries * sizeof (fptype_t) + 1);
+	if (row == NULL || col == NULL || val == NULL) {
+		fprintf (stderr, "Error: out of memory reading %ld entries\n", entries);
+		goto done;
+	}
+
+	for (k = 0; k < entries; k++) {
+		long i, j;
+		double v = 1.0;
+		/* Skip blank lines between entries */
+		for (;;) {
+			skip_blanks (&c);
+			if (c.p >= c.end || *c.p != '\n')
+				break;
+			next_line (&c);
+		}
+		if (read_long (&c, &i) != 0 || read_long (&c, &j) != 0 ||
+				(field != FIELD_PATTERN && read_double (&c, &v) != 0)) {
+			fprintf (stderr, "Error: %s:%d: bad entry %ld of %ld\n", path, c.line, k + 1, entries);
+			goto done;
+		}
+		if (i < 1 || i > m || j < 1 || j > n) {
+			fprintf (stderr, "Error: %s:%d: entry (%ld, %ld) outside %ld x %ld\n", path, c.line, i, j, m, n);
+			goto done;
+		}
+		next_line (&c);
+		row[nnz] = (int) (i - 1);
+		col[nnz] = (int) (j - 1);
+		val[nnz] = (fptype_t) v;
+		nnz++;
+		if (symmetry != SYM_GENERAL && i != j) {
+			row[nnz] = (int) (j - 1);
+			col[nnz] = (int) (i - 1);
+			val[nnz] = (fptype_t) (symmetry == SYM_SKEW ? -v : v);
+			nnz++;
+		}
+	}
+
+	rc = coo_to_csr ((int) m, (int) n, (int) nnz, row, col, val, A);
+
+done:
+	free (row);
+	free (col);
+	free (val);
+	munmap (map, size);
+	return rc;
+}
+
+void free_csr (csr_t *A)
+{
+	if (A->rowptr != NULL)
+		_my_free (A->rowptr, (size_t) (A->m + 1) * sizeof (int));
+	if (A->colidx != NULL)
+		_my_free (A->colidx, (size_t) A->nnz * sizeof (int) + 1);
+	if (A->val != NULL)
+		_my_free (A->val, (size_t) A->nnz * sizeof (fptype_t) + 1);
+	memset (A, 0, sizeof (*A));
+}
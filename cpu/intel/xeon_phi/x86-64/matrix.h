@@ -0,0 +1,47 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Compressed sparse row matrices read from Matrix Market files */
+
+#ifndef __MATRIX_H__
+#define __MATRIX_H__
+
+#include "common.h"
+
+struct csr_t {
+	int m;
+	int n;
+	int nnz;
+	/* m + 1 offsets into colidx and val; row i is [rowptr[i], rowptr[i+1]) */
+	int *rowptr;
+	/* Column indices, ascending within each row */
+	int *colidx;
+	fptype_t *val;
+};
+
+/** \brief Read a Matrix Market coordinate file (real, integer or pattern;
+ * general, symmetric or skew-symmetric) into CSR. The file is memory-mapped
+ * and parsed in place; symmetric matrices are expanded to both triangles.
+ * Returns 0 on success, -1 after printing the reason to stderr.
+ */
+int read_matrix_market (const char *path, csr_t *A);
+
+void free_csr (csr_t *A);
+
+#endif /* __MATRIX_H__ */
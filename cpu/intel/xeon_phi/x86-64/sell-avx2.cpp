@@ -0,0 +1,97 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* SELL-C-sigma kernels for AVX2 (build with -mavx2 -mfma): a chunk is two
+	 ymm of lanes. AVX2 has no mask registers, so with _BITMASK_ the lane
+	 bits become a vector mask for the gathers only; the padding values are
+	 zero, so the FMAs need none. */
+
+#include "sell.h"
+
+#if _PRECISION_ == 2
+/* Lanes 4h .. 4h+3 of the bitmask as 64-bit all-ones / zero */
+inline static __m256d lane_mask (unsigned bits, int h)
+{
+	const __m256i bit = _mm256_setr_epi64x (1, 2, 4, 8);
+	const __m256i set = _mm256_and_si256 (_mm256_set1_epi64x ((bits >> (4 * h)) & 0xF), bit);
+	return _mm256_castsi256_pd (_mm256_cmpeq_epi64 (set, bit));
+}
+#else
+/* Lanes 8h .. 8h+7 of the bitmask as 32-bit all-ones / zero */
+inline static __m256 lane_mask (unsigned bits, int h)
+{
+	const __m256i bit = _mm256_setr_epi32 (1, 2, 4, 8, 16, 32, 64, 128);
+	const __m256i set = _mm256_and_si256 (_mm256_set1_epi32 ((bits >> (8 * h)) & 0xFF), bit);
+	return _mm256_castsi256_ps (_mm256_cmpeq_epi32 (set, bit));
+}
+#endif
+
+void sell_avx2 (const sell_t *S, int c0, int c1, const fptype_t *x, fptype_t *y)
+{
+	const int *colidx = S->colidx;
+	const fptype_t *val = S->val;
+	for (int c = c0; c < c1; c++) {
+		const int64_t base = S->chunk_ptr[c];
+		const int64_t end = S->chunk_ptr[c + 1];
+		fptype_t sum[SELL_C] __attribute__((aligned (64)));
+#if _PRECISION_ == 2
+		__m256d acc0 = _mm256_setzero_pd ();
+		__m256d acc1 = _mm256_setzero_pd ();
+		for (int64_t s = base; s < end; s += SELL_C) {
+			const __m128i idx0 = _mm_load_si128 ((const __m128i *) &colidx[s]);
+			const __m128i idx1 = _mm_load_si128 ((const __m128i *) &colidx[s + 4]);
+	#ifdef _BITMASK_
+			const unsigned bits = S->mask[s / SELL_C];
+			const __m256d x0 = _mm256_mask_i32gather_pd (_mm256_setzero_pd (), x, idx0, lane_mask (bits, 0), 8);
+			const __m256d x1 = _mm256_mask_i32gather_pd (_mm256_setzero_pd (), x, idx1, lane_mask (bits, 1), 8);
+	#else
+			const __m256d x0 = _mm256_i32gather_pd (x, idx0, 8);
+			const __m256d x1 = _mm256_i32gather_pd (x, idx1, 8);
+	#endif
+			acc0 = _mm256_fmadd_pd (_mm256_load_pd (&val[s]), x0, acc0);
+			acc1 = _mm256_fmadd_pd (_mm256_load_pd (&val[s + 4]), x1, acc1);
+		}
+		_mm256_store_pd (sum, acc0);
+		_mm256_store_pd (sum + 4, acc1);
+#else
+		__m256 acc0 = _mm256_setzero_ps ();
+		__m256 acc1 = _mm256_setzero_ps ();
+		for (int64_t s = base; s < end; s += SELL_C) {
+			const __m256i idx0 = _mm256_load_si256 ((const __m256i *) &colidx[s]);
+			const __m256i idx1 = _mm256_load_si256 ((const __m256i *) &colidx[s + 8]);
+	#ifdef _BITMASK_
+			const unsigned bits = S->mask[s / SELL_C];
+			const __m256 x0 = _mm256_mask_i32gather_ps (_mm256_setzero_ps (), x, idx0, lane_mask (bits, 0), 4);
+			const __m256 x1 = _mm256_mask_i32gather_ps (_mm256_setzero_ps (), x, idx1, lane_mask (bits, 1), 4);
+	#else
+			const __m256 x0 = _mm256_i32gather_ps (x, idx0, 4);
+			const __m256 x1 = _mm256_i32gather_ps (x, idx1, 4);
+	#endif
+			acc0 = _mm256_fmadd_ps (_mm256_load_ps (&val[s]), x0, acc0);
+			acc1 = _mm256_fmadd_ps (_mm256_load_ps (&val[s + 8]), x1, acc1);
+		}
+		_mm256_store_ps (sum, acc0);
+		_mm256_store_ps (sum + 8, acc1);
+#endif
+		const int *perm = &S->perm[c * SELL_C];
+		for (int l = 0; l < SELL_C; l++)
+			if (perm[l] >= 0)
+				y[perm[l]] = sum[l];
+	}
+}
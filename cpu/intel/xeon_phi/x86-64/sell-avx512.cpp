@@ -0,0 +1,68 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* SELL-C-sigma kernels for AVX-512 (build with -mavx512f): one chunk is
+	 one zmm of lanes, x is gathered with the chunk column's indices and,
+	 with _BITMASK_, the gather and FMA are masked to the valid lanes */
+
+#include "sell.h"
+
+void sell_avx512 (const sell_t *S, int c0, int c1, const fptype_t *x, fptype_t *y)
+{
+	const int *colidx = S->colidx;
+	const fptype_t *val = S->val;
+	for (int c = c0; c < c1; c++) {
+		const int64_t base = S->chunk_ptr[c];
+		const int64_t end = S->chunk_ptr[c + 1];
+		fptype_t sum[SELL_C] __attribute__((aligned (64)));
+#if _PRECISION_ == 2
+		__m512d acc = _mm512_setzero_pd ();
+		for (int64_t s = base; s < end; s += SELL_C) {
+			const __m256i idx = _mm256_load_si256 ((const __m256i *) &colidx[s]);
+			const __m512d v = _mm512_load_pd (&val[s]);
+	#ifdef _BITMASK_
+			const __mmask8 k = S->mask[s / SELL_C];
+			const __m512d xv = _mm512_mask_i32gather_pd (_mm512_setzero_pd (), k, idx, x, 8);
+			acc = _mm512_mask3_fmadd_pd (v, xv, acc, k);
+	#else
+			acc = _mm512_fmadd_pd (v, _mm512_i32gather_pd (idx, x, 8), acc);
+	#endif
+		}
+		_mm512_store_pd (sum, acc);
+#else
+		__m512 acc = _mm512_setzero_ps ();
+		for (int64_t s = base; s < end; s += SELL_C) {
+			const __m512i idx = _mm512_load_si512 ((const void *) &colidx[s]);
+			const __m512 v = _mm512_load_ps (&val[s]);
+	#ifdef _BITMASK_
+			const __mmask16 k = S->mask[s / SELL_C];
+			const __m512 xv = _mm512_mask_i32gather_ps (_mm512_setzero_ps (), k, idx, x, 4);
+			acc = _mm512_mask3_fmadd_ps (v, xv, acc, k);
+	#else
+			acc = _mm512_fmadd_ps (v, _mm512_i32gather_ps (idx, x, 4), acc);
+	#endif
+		}
+		_mm512_store_ps (sum, acc);
+#endif
+		const int *perm = &S->perm[c * SELL_C];
+		for (int l = 0; l < SELL_C; l++)
+			if (perm[l] >= 0)
+				y[perm[l]] = sum[l];
+	}
+}
@@ -0,0 +1,169 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include "sell.h"
+#include "cpuid.h"
+
+
+int csr_to_sell (const csr_t *A, int sigma, sell_t *S)
+{
+	memset (S, 0, sizeof (*S));
+	if (sigma < SELL_C)
+		sigma = SELL_C;
+	sigma = (sigma + SELL_C - 1) / SELL_C * SELL_C;
+	S->m = A->m;
+	S->n = A->n;
+	S->nnz = A->nnz;
+	S->sigma = sigma;
+	S->nchunks = (A->m + SELL_C - 1) / SELL_C;
+
+	/* Rows by descending length within each sigma window */
+	const int padded = S->nchunks * SELL_C;
+	S->perm = (int *) _my_malloc ((size_t) padded * sizeof (int), 64);
+	S->chunk_ptr = (int64_t *) _my_malloc ((size_t) (S->nchunks + 1) * sizeof (int64_t), 64);
+	if (S->perm == MY_MALLOC_FAILED || S->chunk_ptr == MY_MALLOC_FAILED) {
+		free_sell (S);
+		return -1;
+	}
+	for (int i = 0; i < padded; i++)
+		S->perm[i] = i < A->m ? i : -1;
+	const int *rowptr = A->rowptr;
+	for (int w = 0; w < A->m; w += sigma)
+		std::stable_sort (S->perm + w, S->perm + min (w + sigma, A->m), [rowptr] (int a, int b) {
+			return rowptr[a + 1] - rowptr[a] > rowptr[b + 1] - rowptr[b];
+		});
+
+	/* Chunk widths: the first (longest) row of each chunk */
+	S->chunk_ptr[0] = 0;
+	for (int c = 0; c < S->nchunks; c++) {
+		const int r = S->perm[c * SELL_C];
+		const int width = rowptr[r + 1] - rowptr[r];
+		S->chunk_ptr[c + 1] = S->chunk_ptr[c] + (int64_t) width * SELL_C;
+	}
+	S->stored = S->chunk_ptr[S->nchunks];
+	S->colidx = (int *) _my_malloc ((size_t) S->stored * sizeof (int) + 1, 64);
+	S->val = (fptype_t *) _my_malloc ((size_t) S->stored * sizeof (fptype_t) + 1, 64);
+#ifdef _BITMASK_
+	S->mask = (bitmask_t *) _my_malloc ((size_t) (S->stored / SELL_C) * sizeof (bitmask_t) + 1, 64);
+	if (S->mask == MY_MALLOC_FAILED) {
+		free_sell (S);
+		return -1;
+	}
+#endif
+	if (S->colidx == MY_MALLOC_FAILED || S->val == MY_MALLOC_FAILED) {
+		free_sell (S);
+		return -1;
+	}
+
+	#pragma omp parallel for schedule(dynamic, 64)
+	for (int c = 0; c < S->nchunks; c++) {
+		const int64_t base = S->chunk_ptr[c];
+		const int width = (int) ((S->chunk_ptr[c + 1] - base) / SELL_C);
+		for (int l = 0; l < SELL_C; l++) {
+			const int r = S->perm[c * SELL_C + l];
+			const int k0 = r >= 0 ? rowptr[r] : 0;
+			const int len = r >= 0 ? rowptr[r + 1] - k0 : 0;
+			for (int j = 0; j < width; j++) {
+				const int64_t s = base + (int64_t) j * SELL_C + l;
+				if (j < len) {
+					S->colidx[s] = A->colidx[k0 + j];
+					S->val[s] = A->val[k0 + j];
+				} else {
+					S->colidx[s] = len > 0 ? A->colidx[k0 + len - 1] : 0;
+					S->val[s] = FZERO;
+				}
+			}
+		}
+#ifdef _BITMASK_
+		for (int j = 0; j < width; j++) {
+			bitmask_t bits = 0;
+			for (int l = 0; l < SELL_C; l++) {
+				const int r = S->perm[c * SELL_C + l];
+				if (r >= 0 && j < rowptr[r + 1] - rowptr[r])
+					bits |= (bitmask_t) (1u << l);
+			}
+			S->mask[base / SELL_C + j] = bits;
+		}
+#endif
+	}
+	return 0;
+}
+
+void free_sell (sell_t *S)
+{
+	if (S->perm != NULL)
+		_my_free (S->perm, (size_t) S->nchunks * SELL_C * sizeof (int));
+	if (S->chunk_ptr != NULL)
+		_my_free (S->chunk_ptr, (size_t) (S->nchunks + 1) * sizeof (int64_t));
+	if (S->colidx != NULL)
+		_my_free (S->colidx, (size_t) S->stored * sizeof (int) + 1);
+	if (S->val != NULL)
+		_my_free (S->val, (size_t) S->stored * sizeof (fptype_t) + 1);
+#ifdef _BITMASK_
+	if (S->mask != NULL)
+		_my_free (S->mask, (size_t) (S->stored / SELL_C) * sizeof (bitmask_t) + 1);
+#endif
+	memset (S, 0, sizeof (*S));
+}
+
+double sell_bytes (const sell_t *S)
+{
+	double bytes = (double) S->stored * (sizeof (fptype_t) + sizeof (int)) +
+		(S->nchunks + 1.0) * sizeof (int64_t) + (double) S->nchunks * SELL_C * sizeof (int);
+#ifdef _BITMASK_
+	bytes += (double) (S->stored / SELL_C) * sizeof (bitmask_t);
+#endif
+	return bytes;
+}
+
+void sell_scalar (const sell_t *S, int c0, int c1, const fptype_t *x, fptype_t *y)
+{
+	for (int c = c0; c < c1; c++) {
+		fptype_t sum[SELL_C];
+		const int64_t base = S->chunk_ptr[c];
+		const int width = (int) ((S->chunk_ptr[c + 1] - base) / SELL_C);
+		for (int l = 0; l < SELL_C; l++)
+			sum[l] = FZERO;
+		for (int j = 0; j < width; j++) {
+			const int64_t s = base + (int64_t) j * SELL_C;
+			for (int l = 0; l < SELL_C; l++)
+				sum[l] += S->val[s + l] * x[S->colidx[s + l]];
+		}
+		for (int l = 0; l < SELL_C; l++) {
+			const int r = S->perm[c * SELL_C + l];
+			if (r >= 0)
+				y[r] = sum[l];
+		}
+	}
+}
+
+sell_kernel_t sell_select (const char **name)
+{
+	if (cpu::has_avx512f ()) {
+		*name = "AVX-512";
+		return sell_avx512;
+	}
+	if (cpu::has_avx2 () && cpu::has_fma ()) {
+		*name = "AVX2-FMA";
+		return sell_avx2;
+	}
+	*name = "scalar";
+	return sell_scalar;
+}
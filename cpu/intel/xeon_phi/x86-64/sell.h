@@ -0,0 +1,82 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* SELL-C-sigma storage (Kreutzer et al., SIAM J. Sci. Comput. 2014): rows
+	 sorted by length within windows of sigma rows, cut into chunks of C =
+	 SIMDW rows (one 512-bit vector), each chunk stored column by column and
+	 padded to its longest row. Slot s = chunk_ptr[c] + j * C + l holds the
+	 j-th nonzero of lane l of chunk c.
+
+	 Padding slots have value 0 and repeat the row's last column (column 0
+	 for empty rows), so unmasked kernels gather an x element they already
+	 hold. With _BITMASK_ every chunk column also has a bitmask_t of its
+	 valid lanes, and the kernels mask the gathers and FMAs with it, as the
+	 KNC vector mask registers would.
+ */
+
+#ifndef __SELL_H__
+#define __SELL_H__
+
+#include "matrix.h"
+
+#define SELL_C SIMDW
+
+struct sell_t {
+	int m;
+	int n;
+	int nnz;
+	int sigma;
+	int nchunks;
+	/* Slots including padding */
+	int64_t stored;
+	/* nchunks + 1 slot offsets, multiples of SELL_C */
+	int64_t *chunk_ptr;
+	/* Original row of each lane, -1 past the last row */
+	int *perm;
+	int *colidx;
+	fptype_t *val;
+#ifdef _BITMASK_
+	/* Valid lanes of each chunk column: stored / SELL_C masks */
+	bitmask_t *mask;
+#endif
+};
+
+/** \brief Convert CSR to SELL-C-sigma; sigma is rounded up to a multiple
+ * of SELL_C. Returns 0, or -1 when out of memory. */
+int csr_to_sell (const csr_t *A, int sigma, sell_t *S);
+
+void free_sell (sell_t *S);
+
+/** \brief Bytes of the arrays a product streams: values, column indices,
+ * chunk offsets, the row permutation (and the masks). */
+double sell_bytes (const sell_t *S);
+
+/** \brief y = A x over chunks [c0, c1). */
+typedef void (*sell_kernel_t) (const sell_t *S, int c0, int c1, const fptype_t *x, fptype_t *y);
+
+void sell_scalar (const sell_t *S, int c0, int c1, const fptype_t *x, fptype_t *y);
+
+/* Defined in sell-avx2.cpp and sell-avx512.cpp */
+void sell_avx2 (const sell_t *S, int c0, int c1, const fptype_t *x, fptype_t *y);
+void sell_avx512 (const sell_t *S, int c0, int c1, const fptype_t *x, fptype_t *y);
+
+/** \brief The widest kernel the CPU supports, and its name. */
+sell_kernel_t sell_select (const char **name);
+
+#endif /* __SELL_H__ */
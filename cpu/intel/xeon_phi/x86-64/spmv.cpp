@@ -0,0 +1,542 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* CSR sparse matrix-vector multiply, y = A x, over a Matrix Market matrix:
+	 each load balancer of common.h in turn, timed like bench.c (rdtsc between
+	 tree barriers, best of the runs), and placed on the roofline of the
+	 machine profile. */
+
+#include <unistd.h>
+#include "common.h"
+#include "matrix.h"
+#include "balance.h"
+#include "sell.h"
+#include "profile.h"
+#include "tasks.h"
+#include "timer.h"
+
+
+#define NRUNS   10
+// task-size sweep of the dynamic balancers, in tasks per queue
+#define MAXSIZES 16
+
+// storage formats run
+#define FORMAT_CSR  1
+#define FORMAT_SELL 2
+#define FORMAT_ALL  (FORMAT_CSR | FORMAT_SELL)
+
+
+struct options_t {
+	int nthreads;
+	/* 0 runs every balancer */
+	int balancer;
+	int granularity;
+	int nruns;
+	const char *profile;
+	/* Values of g_ntasksperqueue the dynamic balancers run with */
+	int nsizes;
+	int sizes[MAXSIZES];
+	int format;
+	int sigma;
+};
+
+/* One line of the results table */
+struct row_t {
+	const char *format;
+	int balancer;
+	int ntasks;
+	double secs;
+	double flops;
+	double bytes;
+	double imbalance;
+	int dynamic;
+	int64_t steals;
+	double overhead;
+	double error;
+};
+
+/* Per-thread seconds between leaving the first barrier and finishing the
+	 thread's share, one cache line apart */
+struct busy_t {
+	double secs;
+	char pad[LINESIZE - sizeof (double)];
+} __attribute__((aligned (LINESIZE)));
+
+
+/* =================================================================== */
+/* Parse program input */
+static void usage (int argc, char **argv, options_t *o)
+{
+	o->nthreads = omp_get_max_threads ();
+	o->balancer = 0;
+	o->granularity = ROW;
+	o->nruns = NRUNS;
+	o->profile = profile::default_path ();
+	o->nsizes = 3;
+	o->sizes[0] = 4;
+	o->sizes[1] = 16;
+	o->sizes[2] = 64;
+	o->format = FORMAT_ALL;
+	o->sigma = 256;
+	int c;
+	while ((c = getopt (argc, argv, "t:b:g:q:r:p:f:S:h")) != -1) {
+		switch (c) {
+			case 't': o->nthreads = atoi (optarg); break;
+			case 'b':
+				o->balancer = strcmp (optarg, "all") == 0 ? 0 : balancer_from_name (optarg);
+				if (o->balancer == 0 && strcmp (optarg, "all") != 0)
+					o->balancer = -1;
+				break;
+			case 'g':
+				o->granularity = strcmp (optarg, "element") == 0 ? ELEMENT :
+					strcmp (optarg, "row") == 0 ? ROW : -1;
+				break;
+			case 'q':
+				o->nsizes = 0;
+				for (char *item = strtok (optarg, ","); item != NULL && o->nsizes < MAXSIZES;
+						 item = strtok (NULL, ","))
+					o->sizes[o->nsizes++] = atoi (item);
+				break;
+			case 'r': o->nruns = atoi (optarg); break;
+			case 'p': o->profile = optarg; break;
+			case 'f':
+				o->format = strcmp (optarg, "csr") == 0 ? FORMAT_CSR :
+					strcmp (optarg, "sell") == 0 ? FORMAT_SELL :
+					strcmp (optarg, "all") == 0 ? FORMAT_ALL : -1;
+				break;
+			case 'S': o->sigma = atoi (optarg); break;
+			default:
+				fprintf (stderr,
+								 "usage: %s [-t threads] [-b nnz|miss|adaptive|share|steal|hybrid|all]\n"
+								 "          [-g row|element] [-q tasks per queue[,...]] [-r runs] [-p profile]\n"
+								 "          [-f csr|sell|all] [-S sigma] <matrix.mtx>\n",
+								 argv[0]);
+				exit (c != 'h');
+		}
+	}
+	int badsize = o->nsizes == 0;
+	for (int i = 0; i < o->nsizes; i++)
+		badsize |= o->sizes[i] < 1;
+	if (optind != argc - 1 || o->nthreads < 1 || o->nthreads > MAXTHREADS || o->balancer < 0 ||
+			o->granularity < 0 || badsize || o->nruns < 1 || o->format < 0 || o->sigma < 1) {
+		fprintf (stderr, "Invalid arguments; %s -h for usage\n", argv[0]);
+		exit (1);
+	}
+	snprintf (g_filename, sizeof (g_filename), "%s", argv[optind]);
+}
+/* =================================================================== */
+
+
+/* =================================================================== */
+/* Kernels */
+static void spmv_rows (const csr_t *A, int r0, int r1)
+{
+	const int *rowptr = A->rowptr;
+	const int *colidx = A->colidx;
+	const fptype_t *val = A->val;
+	const fptype_t *x = g_x;
+	fptype_t *y = g_y;
+	for (int i = r0; i < r1; i++) {
+		fptype_t sum = FZERO;
+		for (int k = rowptr[i]; k < rowptr[i + 1]; k++)
+			sum += val[k] * x[colidx[k]];
+		y[i] = sum;
+	}
+}
+
+/* Nonzeros [e0, e1): rows cut by either end are shared with the
+	 neighbouring threads and added to y under g_lock_y */
+static void spmv_elements (const csr_t *A, int e0, int e1)
+{
+	if (e0 >= e1)
+		return;
+	const int *rowptr = A->rowptr;
+	/* Row holding nonzero e0 */
+	int lo = 0;
+	int hi = A->m - 1;
+	while (lo < hi) {
+		const int mid = lo + (hi - lo + 1) / 2;
+		if (rowptr[mid] <= e0)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	for (int i = lo; i < A->m && rowptr[i] < e1; i++) {
+		const int k0 = max (rowptr[i], e0);
+		const int k1 = min (rowptr[i + 1], e1);
+		fptype_t sum = FZERO;
+		for (int k = k0; k < k1; k++)
+			sum += A->val[k] * g_x[A->colidx[k]];
+		if (k0 == rowptr[i] && k1 == rowptr[i + 1]) {
+			g_y[i] = sum;
+		} else {
+			pthread_mutex_t *lock = &g_lock_y[i % NLOCKS_Y];
+			pthread_mutex_lock (lock);
+			g_y[i] += sum;
+			pthread_mutex_unlock (lock);
+		}
+	}
+}
+
+/* Zero the rows spmv_elements() accumulates into */
+static void clear_split_rows (const csr_t *A, int nthreads)
+{
+	for (int t = 1; t < nthreads; t++) {
+		const int e = g_partition[t];
+		if (e <= 0 || e >= A->nnz)
+			continue;
+		int lo = 0;
+		int hi = A->m - 1;
+		while (lo < hi) {
+			const int mid = lo + (hi - lo + 1) / 2;
+			if (A->rowptr[mid] <= e)
+				lo = mid;
+			else
+				hi = mid - 1;
+		}
+		/* The row holding nonzero e */
+		g_y[lo] = FZERO;
+	}
+}
+/* =================================================================== */
+
+
+/* =================================================================== */
+/* Largest difference from the reference, relative to its largest element */
+static double check (const fptype_t *y, const fptype_t *ref, int m)
+{
+	double diff = 0.0;
+	double scale = 0.0;
+	for (int i = 0; i < m; i++) {
+		diff = max (diff, fabs ((double) y[i] - (double) ref[i]));
+		scale = max (scale, fabs ((double) ref[i]));
+	}
+	return scale > 0.0 ? diff / scale : diff;
+}
+
+/* Rates of the best run and, with a fitted profile, its place under the
+	 roofline at the product's arithmetic intensity */
+static void print_row (const row_t *r, int nthreads, const profile::machine_t *machine, int has_roofline)
+{
+	const double gflops = r->flops / r->secs / GHZ;
+	const double intensity = r->flops / r->bytes;
+	printf ("%s\t%s\t%d\t%d\t%.6lf\t%.3lf\t%.3lf\t%.3lf", r->format, balancer_name (r->balancer),
+					nthreads, r->ntasks, r->secs, gflops, r->bytes / r->secs / GHZ, intensity);
+	if (has_roofline) {
+		const double memory = intensity * machine->roofline.peak_gbps;
+		const double roof = min (memory, machine->roofline.peak_gflops);
+		printf ("\t%.3lf\t%.1lf\t%s", roof, 100.0 * gflops / roof,
+						memory < machine->roofline.peak_gflops ? "memory" : "compute");
+	} else {
+		printf ("\tn/a\tn/a\t-");
+	}
+	printf ("\t%.3lf", r->imbalance);
+	if (r->dynamic)
+		printf ("\t%lld\t%.2lf", (long long) r->steals, r->overhead);
+	else
+		printf ("\t-\t-");
+	printf ("\t%s\n", r->error <= THRESH ? "ok" : "FAIL");
+	fflush (stdout);
+}
+/* =================================================================== */
+
+
+int main (int argc, char **argv)
+{
+	options_t o;
+	csr_t A;
+	profile::machine_t machine;
+
+	usage (argc, argv, &o);
+	const int nthreads = o.nthreads;
+
+	timer::init ();
+	uint64_t t0 = timer::get_ticks_acquire ();
+	if (read_matrix_market (g_filename, &A) != 0)
+		return 1;
+	uint64_t t1 = timer::get_ticks_release ();
+	g_m = A.m;
+	g_n = A.n;
+	g_nnz = A.nnz;
+
+	int minrow = g_nnz;
+	int maxrow = 0;
+	for (int i = 0; i < g_m; i++) {
+		minrow = min (minrow, A.rowptr[i + 1] - A.rowptr[i]);
+		maxrow = max (maxrow, A.rowptr[i + 1] - A.rowptr[i]);
+	}
+	fprintf (stderr, "Matrix: %s\n  %d x %d, %d nonzeros, nonzeros per row %d / %.2lf / %d (min / avg / max)\n  read and converted in %.3lf secs\n",
+					 g_filename, g_m, g_n, g_nnz, minrow, (double) g_nnz / g_m, maxrow,
+					 timer::ticks_to_secs (timer::elapsed_ticks (t0, t1)));
+
+	/* Vectors and the serial reference */
+	g_x = (fptype_t *) _my_malloc ((size_t) g_n * sizeof (fptype_t), 64);
+	g_y = (fptype_t *) _my_malloc ((size_t) g_m * sizeof (fptype_t), 64);
+	fptype_t *ref = (fptype_t *) malloc ((size_t) g_m * sizeof (fptype_t));
+	assert (g_x != MY_MALLOC_FAILED && g_y != MY_MALLOC_FAILED && ref != NULL);
+	initvec (g_x, g_n, NONE);
+	spmv_rows (&A, 0, g_m);
+	memcpy (ref, g_y, (size_t) g_m * sizeof (fptype_t));
+
+	g_lock_y = (pthread_mutex_t *) malloc (NLOCKS_Y * sizeof (pthread_mutex_t));
+	for (int l = 0; l < NLOCKS_Y; l++)
+		pthread_mutex_init (&g_lock_y[l], NULL);
+	g_partition = (int *) malloc ((nthreads + 1) * sizeof (int));
+	g_nqueue = nthreads;
+	int maxsize = 1;
+	for (int i = 0; i < o.nsizes; i++)
+		maxsize = max (maxsize, o.sizes[i]);
+	int *task_rows = (int *) malloc (((size_t) g_nqueue * maxsize + 1) * sizeof (int));
+	busy_t *busy = (busy_t *) aligned_alloc (LINESIZE, nthreads * sizeof (busy_t));
+	double *busysecs = (double *) malloc (nthreads * sizeof (double));
+	tasks::stats_t *stats = (tasks::stats_t *) aligned_alloc (TASKS_LINE_BYTES, nthreads * sizeof (tasks::stats_t));
+	tasks::pool_t pool;
+	static tasks::shared_t shared;
+	if (tasks::init (&pool, nthreads, maxsize) != 0) {
+		fprintf (stderr, "Error: cannot allocate the task deques\n");
+		return 1;
+	}
+
+	/* Traffic of one product: the matrix, x and y once each */
+	const double flops = 2.0 * g_nnz;
+	const double bytes = (double) g_nnz * (sizeof (fptype_t) + sizeof (int)) +
+											 (g_m + 1.0) * sizeof (int) + ((double) g_n + g_m) * sizeof (fptype_t);
+
+	/* Roofline of the machine profile (../../../../generic/roofline-fit) */
+	profile::init (&machine);
+	const int has_roofline = profile::load (&machine, o.profile) == 0 &&
+		machine.roofline.peak_gflops > 0.0 && machine.roofline.peak_gbps > 0.0;
+	if (!has_roofline)
+		fprintf (stderr, "Warning: no roofline in %s; run roofline-fit to place SpMV on it\n", o.profile);
+
+	initomp (nthreads, 0);
+	tbarrier.Init (nthreads);
+
+	printf ("Format\tBalancer\tThreads\tTasks\tSecs\tGFLOPS\tGB/s\tFlop/byte\tRoofline GFLOPS\t%% of roofline\tBound\tImbalance\tSteals\tOverhead %%\tCheck\n");
+	for (int b = NNZ_BAL; b <= HYBRID_BAL; b++) {
+		if (!(o.format & FORMAT_CSR) || (o.balancer != 0 && b != o.balancer))
+			continue;
+		g_balancer = b;
+		const int dynamic = b == SHARE_BAL || b == STEAL_BAL || b == HYBRID_BAL;
+		const int granularity = b == NNZ_BAL ? o.granularity : ROW;
+
+		/* Static balancers run once, dynamic ones per task size */
+		for (int size = 0; size < (dynamic ? o.nsizes : 1); size++) {
+			g_ntasksperqueue = o.sizes[size];
+			/* SHARE_BAL serves every thread from one queue */
+			const int nqueue = b == SHARE_BAL ? 1 : g_nqueue;
+			const int ntasksperqueue = b == SHARE_BAL ? g_nqueue * g_ntasksperqueue : g_ntasksperqueue;
+			int ntasks = nthreads;
+
+			switch (b) {
+				case NNZ_BAL:
+				case ADAPTIVE_BAL:
+					nnz_partition (&A, nthreads, granularity, g_partition);
+					break;
+				case MISS_BAL: {
+					/* The model's view of both cuts */
+					const uint64_t m0 = timer::get_ticks_acquire ();
+					miss_partition (&A, g_x, g_y, nthreads, g_partition);
+					const uint64_t m1 = timer::get_ticks_release ();
+					int *nnzcut = (int *) malloc ((nthreads + 1) * sizeof (int));
+					nnz_partition (&A, nthreads, ROW, nnzcut);
+					fprintf (stderr, "Miss model (%d KB, %d-way): simulated miss imbalance %.3lf with nnz, %.3lf with miss balancing; partitioned in %.3lf secs\n",
+									 CACHESIZE / 1024, ASSOCIATE,
+									 miss_imbalance (&A, g_x, g_y, nthreads, nnzcut),
+									 miss_imbalance (&A, g_x, g_y, nthreads, g_partition),
+									 timer::ticks_to_secs (timer::elapsed_ticks (m0, m1)));
+					free (nnzcut);
+					break;
+				}
+				default:
+					ntasks = build_tasks (&A, b, nqueue, ntasksperqueue, task_rows);
+					break;
+			}
+
+			double minTime = 0.0;
+			double imbalance = 0.0;
+			double overhead = 0.0;
+			int64_t steals = 0;
+			memset (g_y, 0, (size_t) g_m * sizeof (fptype_t));
+			for (int run = 0; run < o.nruns; run++)
+			{
+				double secs = 0.0;
+				memset (stats, 0, nthreads * sizeof (tasks::stats_t));
+				if (b == SHARE_BAL)
+					tasks::reset (&shared, ntasks);
+				else if (dynamic)
+					tasks::reset (&pool, 0);
+				if (granularity == ELEMENT)
+					clear_split_rows (&A, nthreads);
+
+				/* One loop iteration per thread */
+				#pragma omp parallel for num_threads(nthreads) schedule(static, 1)
+				for (int tid = 0; tid < nthreads; tid++)
+				{
+					/* Own tasks in reverse, so the owner pops them in row order */
+					if (dynamic && b != SHARE_BAL)
+						for (int k = ntasksperqueue - 1; k >= 0; k--)
+							tasks::push (&pool.deques[tid], (int64_t) tid * ntasksperqueue + k);
+
+					/* Start time measurement */
+					const uint64_t start = timer::get_ticks_acquire ();
+					Barrier (tid);
+					const uint64_t begin = timer::get_ticks_acquire ();
+
+					if (dynamic) {
+						for (;;) {
+							const uint64_t s0 = timer::get_ticks_acquire ();
+							const int64_t task = b == SHARE_BAL ? tasks::take (&shared, &stats[tid]) :
+								tasks::next (&pool, tid, &stats[tid]);
+							stats[tid].ticks += timer::elapsed_ticks (s0, timer::get_ticks_release ());
+							if (task < 0)
+								break;
+							spmv_rows (&A, task_rows[task], task_rows[task + 1]);
+						}
+					} else if (granularity == ELEMENT) {
+						spmv_elements (&A, g_partition[tid], g_partition[tid + 1]);
+					} else {
+						spmv_rows (&A, g_partition[tid], g_partition[tid + 1]);
+					}
+
+					busy[tid].secs = timer::ticks_to_secs (timer::elapsed_ticks (begin, timer::get_ticks_release ()));
+					Barrier (tid);
+					const uint64_t end = timer::get_ticks_release ();
+					if (tid == 0)
+						secs = timer::ticks_to_secs (timer::elapsed_ticks (start, end));
+				}
+
+				double sum = 0.0;
+				double longest = 0.0;
+				double scheduling = 0.0;
+				int64_t stolen = 0;
+				for (int t = 0; t < nthreads; t++) {
+					busysecs[t] = busy[t].secs;
+					sum += busysecs[t];
+					longest = max (longest, busysecs[t]);
+					scheduling += timer::ticks_to_secs (stats[t].ticks);
+					stolen += stats[t].steals;
+				}
+				if (run == 0 || secs < minTime) {
+					minTime = secs;
+					imbalance = sum > 0.0 ? longest / (sum / nthreads) : 1.0;
+					overhead = sum > 0.0 ? 100.0 * scheduling / sum : 0.0;
+					steals = stolen;
+				}
+				/* Re-cut on this run's timings for the next one */
+				if (b == ADAPTIVE_BAL)
+					adaptive_partition (&A, nthreads, busysecs, g_partition);
+			}
+
+			row_t row = { "csr", b, ntasks, minTime, flops, bytes, imbalance, dynamic, steals, overhead,
+										check (g_y, ref, g_m) };
+			print_row (&row, nthreads, &machine, has_roofline);
+		}
+	}
+
+	/* SELL-C-sigma: chunks cut into blocks of equal stored slots */
+	if ((o.format & FORMAT_SELL) && (o.balancer == 0 || o.balancer == NNZ_BAL)) {
+		sell_t S;
+		const char *isa;
+		const sell_kernel_t kernel = sell_select (&isa);
+		t0 = timer::get_ticks_acquire ();
+		if (csr_to_sell (&A, o.sigma, &S) != 0) {
+			fprintf (stderr, "Error: out of memory converting to SELL-%d-%d\n", SELL_C, o.sigma);
+			return 1;
+		}
+		t1 = timer::get_ticks_release ();
+		const double csrbytes = (double) g_nnz * (sizeof (fptype_t) + sizeof (int)) + (g_m + 1.0) * sizeof (int);
+		fprintf (stderr, "SELL-%d-%d (%s kernel%s): converted in %.3lf secs, %.2lf MB against %.2lf MB of CSR, %.1lf%% padding\n",
+						 SELL_C, S.sigma, isa,
+#ifdef _BITMASK_
+						 ", bitmask",
+#else
+						 "",
+#endif
+						 timer::ticks_to_secs (timer::elapsed_ticks (t0, t1)),
+						 sell_bytes (&S) / 1024.0 / 1024.0, csrbytes / 1024.0 / 1024.0,
+						 100.0 * (double) (S.stored - S.nnz) / (double) max (S.stored, (int64_t) 1));
+
+		double *prefix = (double *) malloc ((S.nchunks + 1) * sizeof (double));
+		for (int c = 0; c <= S.nchunks; c++)
+			prefix[c] = (double) S.chunk_ptr[c];
+		partition_prefix (prefix, S.nchunks, nthreads, g_partition);
+		free (prefix);
+
+		double minTime = 0.0;
+		double imbalance = 0.0;
+		memset (g_y, 0, (size_t) g_m * sizeof (fptype_t));
+		for (int run = 0; run < o.nruns; run++)
+		{
+			double secs = 0.0;
+
+			/* One loop iteration per thread */
+			#pragma omp parallel for num_threads(nthreads) schedule(static, 1)
+			for (int tid = 0; tid < nthreads; tid++)
+			{
+				/* Start time measurement */
+				const uint64_t start = timer::get_ticks_acquire ();
+				Barrier (tid);
+				const uint64_t begin = timer::get_ticks_acquire ();
+
+				kernel (&S, g_partition[tid], g_partition[tid + 1], g_x, g_y);
+
+				busy[tid].secs = timer::ticks_to_secs (timer::elapsed_ticks (begin, timer::get_ticks_release ()));
+				Barrier (tid);
+				const uint64_t end = timer::get_ticks_release ();
+				if (tid == 0)
+					secs = timer::ticks_to_secs (timer::elapsed_ticks (start, end));
+			}
+
+			double sum = 0.0;
+			double longest = 0.0;
+			for (int t = 0; t < nthreads; t++) {
+				sum += busy[t].secs;
+				longest = max (longest, busy[t].secs);
+			}
+			if (run == 0 || secs < minTime) {
+				minTime = secs;
+				imbalance = sum > 0.0 ? longest / (sum / nthreads) : 1.0;
+			}
+		}
+
+		char name[64];
+		snprintf (name, sizeof (name), "sell-%d-%d", SELL_C, S.sigma);
+		row_t row = { name, NNZ_BAL, nthreads, minTime, flops,
+									sell_bytes (&S) + ((double) g_n + g_m) * sizeof (fptype_t), imbalance, 0, 0, 0.0,
+									check (g_y, ref, g_m) };
+		print_row (&row, nthreads, &machine, has_roofline);
+		free_sell (&S);
+	}
+
+	tasks::destroy (&pool);
+	free (stats);
+	free (busysecs);
+	free (busy);
+	free (task_rows);
+	free (g_partition);
+	for (int l = 0; l < NLOCKS_Y; l++)
+		pthread_mutex_destroy (&g_lock_y[l]);
+	free (g_lock_y);
+	free (ref);
+	_my_free (g_y, (size_t) g_m * sizeof (fptype_t));
+	_my_free (g_x, (size_t) g_n * sizeof (fptype_t));
+	free_csr (&A);
+	return 0;
+}
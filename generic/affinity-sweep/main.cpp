@@ -0,0 +1,277 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Affinity sweep: reruns benchmark commands under every thread placement
+	 policy of ../common/affinity.h and thread count, timing each run and
+	 reading its package energy. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "timer.h"
+#include "powercap.h"
+#include "affinity.h"
+
+#define MAX_COMMANDS 16
+#define MAX_COUNTS 16
+
+/* Benchmarks run under every placement when none are given; %t is
+	 replaced by the thread count */
+static const char* default_commands[] = {
+	"../intensity/intensity double",
+	"../../cpu/intel/xeon_phi/x86-64/bench %t 1 double"
+};
+
+struct options_t {
+	const char* root;
+	const char* output;
+	int policies[affinity::POLICY_COUNT];
+	int policy_count;
+	int threads[MAX_COUNTS];
+	int thread_count;
+	int print_topology;
+	const char* commands[MAX_COMMANDS];
+	int command_count;
+};
+
+/* =================================================================== */
+/* Parse program input */
+int parse_policies(const char* text, int* policies, int max)
+{
+	int count = 0;
+	char* copy = strdup(text);
+	for (char* t = strtok(copy, ","); t != NULL && count < max; t = strtok(NULL, ",")) {
+		const int p = affinity::policy_from_name(t);
+		if (p <= affinity::POLICY_NONE) {
+			count = -1;
+			break;
+		}
+		policies[count++] = p;
+	}
+	free(copy);
+	return count;
+}
+
+void usage(int argc, char** argv, options_t* o)
+{
+	memset(o, 0, sizeof(*o));
+	o->root = "/sys";
+	o->output = "affinity-results";
+	int c;
+	while ((c = getopt(argc, argv, "r:p:t:o:Th")) != -1) {
+		switch (c) {
+			case 'r': o->root = optarg; break;
+			case 'p': o->policy_count = parse_policies(optarg, o->policies, affinity::POLICY_COUNT); break;
+			case 't': o->thread_count = affinity::parse_list(optarg, o->threads, MAX_COUNTS); break;
+			case 'o': o->output = optarg; break;
+			case 'T': o->print_topology = 1; break;
+			default:
+				fprintf(stderr,
+								"usage: %s [-r sysfs root] [-p policy,policy,...] [-t threads,threads,...]\n"
+								"          [-o output dir] [-T] [\"command\" ...]\n"
+								"policies: compact, scatter, one-per-core, smt-paired\n", argv[0]);
+				exit(c != 'h');
+		}
+	}
+	if (o->policy_count < 0) {
+		fprintf(stderr, "Unknown policy\n");
+		exit(1);
+	}
+	if (o->policy_count == 0) {
+		for (int p = affinity::POLICY_NONE + 1; p < affinity::POLICY_COUNT; p++)
+			o->policies[o->policy_count++] = p;
+	}
+	for (int i = optind; i < argc && o->command_count < MAX_COMMANDS; i++)
+		o->commands[o->command_count++] = argv[i];
+	if (o->command_count == 0) {
+		for (size_t i = 0; i < sizeof(default_commands) / sizeof(default_commands[0]); i++)
+			o->commands[o->command_count++] = default_commands[i];
+	}
+}
+/* =================================================================== */
+
+
+/* =================================================================== */
+/* The command with every %t replaced by the thread count */
+void expand(const char* command, int threads, char* out, size_t len)
+{
+	size_t n = 0;
+	for (const char* p = command; *p != '\0' && n + 16 < len; p++) {
+		if (p[0] == '%' && p[1] == 't') {
+			n += snprintf(out + n, len - n, "%d", threads);
+			p++;
+		} else {
+			out[n++] = *p;
+		}
+	}
+	out[n] = '\0';
+}
+
+/* Cores and packages a placement occupies; the topology is in (package,
+	 core, hardware thread) order */
+void span(const affinity::topology_t* t, const int* cpus, int count, int* cores, int* packages)
+{
+	*cores = 0;
+	*packages = 0;
+	const affinity::cpu_t* last = NULL;
+	for (int i = 0; i < t->count; i++) {
+		const affinity::cpu_t* c = &t->cpu[i];
+		int used = 0;
+		for (int j = 0; j < count && !used; j++)
+			used = cpus[j] == c->cpu;
+		if (!used)
+			continue;
+		if (last == NULL || c->package != last->package)
+			(*packages)++;
+		if (last == NULL || c->package != last->package || c->core != last->core)
+			(*cores)++;
+		last = c;
+	}
+}
+
+void print_topology(const affinity::topology_t* t)
+{
+	printf("CPU" "\t" "Package" "\t" "Core" "\t" "SMT" "\n");
+	for (int i = 0; i < t->count; i++)
+		printf("%d" "\t" "%d" "\t" "%d" "\t" "%d" "\n", t->cpu[i].cpu, t->cpu[i].package, t->cpu[i].core,
+					 t->cpu[i].smt);
+	printf("\n" "Policy" "\t" "CPUs" "\n");
+	int* cpus = (int*) malloc(AFFINITY_MAX_CPUS * sizeof(int));
+	for (int p = affinity::POLICY_NONE + 1; p < affinity::POLICY_COUNT; p++) {
+		const int count = affinity::place(t, p, cpus, AFFINITY_MAX_CPUS);
+		printf("%s" "\t", affinity::policy_name(p));
+		for (int i = 0; i < count; i++)
+			printf("%s%d", i == 0 ? "" : ",", cpus[i]);
+		printf("\n");
+	}
+	free(cpus);
+}
+/* =================================================================== */
+
+
+/* =================================================================== */
+/* Run one command on the first `threads` CPUs of a placement: the process
+	 mask is restricted to them for any benchmark, OMP_PLACES binds OpenMP
+	 threads in order and UBENCH_CPUS does the same for ../common/affinity.h */
+void run(const options_t* o, int index, int policy, int threads, const int* cpus,
+				 int cores, int packages)
+{
+	char list[8 * AFFINITY_MAX_CPUS], places[10 * AFFINITY_MAX_CPUS], number[16];
+	size_t n = 0, m = 0;
+	for (int i = 0; i < threads; i++) {
+		n += snprintf(list + n, sizeof(list) - n, "%s%d", i == 0 ? "" : ",", cpus[i]);
+		m += snprintf(places + m, sizeof(places) - m, "%s{%d}", i == 0 ? "" : ",", cpus[i]);
+	}
+	snprintf(number, sizeof(number), "%d", threads);
+	setenv("UBENCH_CPUS", list, 1);
+	setenv("UBENCH_AFFINITY", affinity::policy_name(policy), 1);
+	setenv("OMP_NUM_THREADS", number, 1);
+	setenv("OMP_PLACES", places, 1);
+	setenv("OMP_PROC_BIND", "close", 1);
+
+	char expanded[4096], file[512], command[8192];
+	expand(o->commands[index], threads, expanded, sizeof(expanded));
+	snprintf(file, sizeof(file), "%s/%d-%s-%d.txt", o->output, index, affinity::policy_name(policy), threads);
+	snprintf(command, sizeof(command), "( %s ) > %s 2>&1", expanded, file);
+
+	cpu_set_t saved;
+	sched_getaffinity(0, sizeof(saved), &saved);
+	if (affinity::restrict_to(cpus, threads) != 0)
+		fprintf(stderr, "Warning: cannot restrict benchmark %d to CPUs %s\n", index, list);
+
+	powercap::reading_t before, after;
+	const int zones = powercap::read(o->root, &before);
+	const uint64_t start = timer::get_ticks_acquire();
+	const int status = system(command);
+	const uint64_t end = timer::get_ticks_release();
+	powercap::read(o->root, &after);
+	sched_setaffinity(0, sizeof(saved), &saved);
+
+	const double secs = timer::ticks_to_secs(timer::elapsed_ticks(start, end));
+	printf("%d" "\t" "%s" "\t" "%d" "\t" "%d" "\t" "%d" "\t" "%4.06lf", index, affinity::policy_name(policy),
+				 threads, cores, packages, secs);
+	if (zones > 0) {
+		const double joules = powercap::joules(&before, &after);
+		printf("\t" "%4.03lf" "\t" "%4.03lf", joules, joules / secs);
+	} else {
+		printf("\t" "n/a" "\t" "n/a");
+	}
+	printf("\t" "%s" "\t" "%s" "\n", status == 0 ? "ok" : "FAILED", list);
+	fflush(stdout);
+}
+/* =================================================================== */
+
+
+int main(int argc, char** argv)
+{
+	options_t o;
+	usage(argc, argv, &o);
+
+	affinity::topology_t* t = (affinity::topology_t*) malloc(sizeof(affinity::topology_t));
+	if (affinity::read(o.root, t) == 0) {
+		fprintf(stderr, "Cannot read the CPU topology under %s\n", o.root);
+		return 1;
+	}
+	if (o.print_topology) {
+		print_topology(t);
+		free(t);
+		return 0;
+	}
+	/* Default counts: one thread, one per core, one per hardware thread */
+	if (o.thread_count == 0) {
+		o.threads[o.thread_count++] = 1;
+		if (t->cores > 1)
+			o.threads[o.thread_count++] = t->cores;
+		if (t->count > t->cores)
+			o.threads[o.thread_count++] = t->count;
+	}
+
+	mkdir(o.output, 0755);
+	timer::init();
+
+	fprintf(stderr, "Topology: %d packages, %d cores, %d CPUs\n", t->packages, t->cores, t->count);
+	for (int i = 0; i < o.command_count; i++)
+		fprintf(stderr, "Benchmark %d: %s\n", i, o.commands[i]);
+	printf("Benchmark" "\t" "Policy" "\t" "Threads" "\t" "Cores" "\t" "Packages" "\t" "Secs" "\t"
+				 "Joules" "\t" "Watts" "\t" "Status" "\t" "CPUs" "\n");
+	fflush(stdout);
+
+	int* cpus = (int*) malloc(AFFINITY_MAX_CPUS * sizeof(int));
+	for (int i = 0; i < o.thread_count; i++) {
+		for (int p = 0; p < o.policy_count; p++) {
+			const int count = affinity::place(t, o.policies[p], cpus, AFFINITY_MAX_CPUS);
+			/* A placement never oversubscribes: one-per-core stops at the cores */
+			if (o.threads[i] < 1 || o.threads[i] > count) {
+				fprintf(stderr, "Skipping %s with %d threads: %d CPUs available\n",
+								affinity::policy_name(o.policies[p]), o.threads[i], count);
+				continue;
+			}
+			int cores, packages;
+			span(t, cpus, o.threads[i], &cores, &packages);
+			for (int c = 0; c < o.command_count; c++)
+				run(&o, c, o.policies[p], o.threads[i], cpus, cores, packages);
+		}
+	}
+
+	free(cpus);
+	free(t);
+	return 0;
+}
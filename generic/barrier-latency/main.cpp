@@ -0,0 +1,166 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Barrier latency versus thread count: the OpenMP and pthread barriers
+	 against the spin barriers of ../common/barrier.h. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <omp.h>
+#include <atomic>
+#include "timer.h"
+#include "barrier.h"
+
+/* Episodes checked before timing: every thread must see every other
+	 thread's episode number after each barrier */
+#define CHECK_EPISODES 100
+
+struct omp_barrier_t {
+	int init(int) { return 0; }
+	void wait(int) {
+		#pragma omp barrier
+	}
+	void fini() {}
+};
+
+struct pthread_barrier_wrapper_t {
+	pthread_barrier_t b;
+	int init(int n) { return pthread_barrier_init(&b, NULL, unsigned(n)) == 0 ? 0 : -1; }
+	void wait(int) { pthread_barrier_wait(&b); }
+	void fini() { pthread_barrier_destroy(&b); }
+};
+
+/* Adds fini() to the spin barriers, which hold no resources */
+template <class B>
+struct spin_t : B {
+	void fini() {}
+};
+
+/* Static storage: the spin barriers are over-aligned */
+static omp_barrier_t omp_barrier;
+static pthread_barrier_wrapper_t pthread_barrier;
+static spin_t<barrier::simple_t> simple_barrier;
+static spin_t<barrier::tree_t> tree_barrier;
+static spin_t<barrier::user_t> user_barrier;
+static spin_t<barrier::sense_t> sense_barrier;
+static spin_t<barrier::dissemination_t> dissemination_barrier;
+static spin_t<barrier::tournament_t> tournament_barrier;
+static std::atomic<unsigned> marks[BARRIER_MAX_THREADS];
+
+/* =================================================================== */
+/* Parse program input */
+void usage(int argc, char** argv, int* max_threads, int* episodes)
+{
+	if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+		fprintf(stderr, "usage: %s [max threads] [episodes]\n", argv[0]);
+		exit(0);
+	}
+	*max_threads = (argc > 1) ? atoi(argv[1]) : omp_get_num_procs();
+	*episodes = (argc > 2) ? atoi(argv[2]) : 100000;
+	if (*max_threads < 1 || *max_threads > BARRIER_MAX_THREADS || *episodes < 1) {
+		fprintf(stderr, "Threads must be 1 to %d and episodes at least 1\n", BARRIER_MAX_THREADS);
+		exit(1);
+	}
+	if (*max_threads > omp_get_num_procs())
+		fprintf(stderr, "Warning: %d threads on %d CPUs; spinning barriers will crawl\n",
+						*max_threads, omp_get_num_procs());
+}
+/* =================================================================== */
+
+
+/* =================================================================== */
+/* Check, then time `episodes` back-to-back barriers on `threads` threads.
+	 Returns ns per barrier, or a negative value if the check failed. */
+template <class B>
+double measure(B& b, int threads, int episodes)
+{
+	int failed = 0;
+	uint64_t ticks = 0;
+
+	#pragma omp parallel num_threads(threads) reduction(+:failed)
+	{
+		const int id = omp_get_thread_num();
+		for (unsigned e = 1; e <= CHECK_EPISODES; e++) {
+			marks[id].store(e, std::memory_order_relaxed);
+			b.wait(id);
+			for (int j = 0; j < threads; j++)
+				failed += marks[j].load(std::memory_order_relaxed) != e;
+			b.wait(id);
+		}
+
+		uint64_t start = 0;
+		if (id == 0)
+			start = timer::get_ticks_acquire();
+		for (int e = 0; e < episodes; e++)
+			b.wait(id);
+		/* Thread 0 leaves the last barrier no earlier than the last
+			 arrival, so its clock covers every episode */
+		if (id == 0)
+			ticks = timer::elapsed_ticks(start, timer::get_ticks_release());
+	}
+	if (failed)
+		return -1.0;
+	return timer::ticks_to_secs(ticks) * 1.0e+9 / double(episodes);
+}
+
+template <class B>
+void run(B& b, const char* name, int threads, int episodes)
+{
+	if (b.init(threads) != 0) {
+		fprintf(stderr, "Cannot create the %s barrier for %d threads\n", name, threads);
+		return;
+	}
+	const double ns = measure(b, threads, episodes);
+	b.fini();
+	if (ns >= 0.0)
+		printf("%d" "\t" "%s" "\t" "%4.01lf" "\t" "ok" "\n", threads, name, ns);
+	else
+		printf("%d" "\t" "%s" "\t" "n/a" "\t" "FAILED" "\n", threads, name);
+	fflush(stdout);
+}
+/* =================================================================== */
+
+
+int main(int argc, char** argv)
+{
+	int max_threads, episodes;
+	usage(argc, argv, &max_threads, &episodes);
+
+	timer::init();
+	/* Exactly the requested team size, or the barriers would deadlock */
+	omp_set_dynamic(0);
+
+	printf("Threads" "\t" "Barrier" "\t" "ns" "\t" "Check" "\n");
+	for (int threads = 1; ; threads = (threads * 2 > max_threads && threads < max_threads) ? max_threads : threads * 2) {
+		run(omp_barrier, "omp", threads, episodes);
+		run(pthread_barrier, "pthread", threads, episodes);
+		run(simple_barrier, "simple", threads, episodes);
+		run(tree_barrier, "tree", threads, episodes);
+		run(user_barrier, "user", threads, episodes);
+		run(sense_barrier, "sense", threads, episodes);
+		run(dissemination_barrier, "dissemination", threads, episodes);
+		run(tournament_barrier, "tournament", threads, episodes);
+		if (threads >= max_threads)
+			break;
+	}
+	return 0;
+}
@@ -0,0 +1,298 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "timer.h"
+#include "chase.h"
+#include "cacheinfo.h"
+#include "profile.h"
+
+/* Working-set sizes per doubling; 8 gives ~9% steps */
+#define STEPS_PER_OCTAVE 8
+#define MIN_BYTES (4 * 1024)
+#define STRIDE 64
+#define TRIALS 3
+
+/* A point belongs to a plateau while its latency stays below RISE times the
+	 plateau's base latency; a new plateau starts once consecutive points
+	 differ by less than FLAT. */
+#define RISE 1.3
+#define FLAT 1.08
+/* Adjacent plateaus closer than this are TLB or prefetch artefacts of one level */
+#define MERGE 1.5
+
+struct level_estimate_t {
+	size_t capacity;
+	double latency_ns;
+};
+
+/* =================================================================== */
+/* Parse program input */
+void usage(int argc, char** argv, size_t* max_bytes, const char** path)
+{
+	*max_bytes = 0;
+	*path = profile::default_path();
+	if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+		fprintf(stderr, "usage: %s [max working set in MiB] [profile path]\n", argv[0]);
+		exit(0);
+	}
+	if (argc > 1)
+		*max_bytes = size_t(atol(argv[1])) << 20;
+	if (argc > 2)
+		*path = argv[2];
+}
+/* =================================================================== */
+
+
+/* =================================================================== */
+/* Find plateaus and knees in the latency staircase.
+	 Returns the number of plateaus; the last one is DRAM when the sweep
+	 went far enough past the last-level cache. */
+int find_plateaus(const size_t* bytes, const double* latency, int points,
+									level_estimate_t* levels, int max_levels)
+{
+	int count = 0;
+	int in_plateau = 1;
+	double base = latency[0];
+	for (int i = 1; i < points && count < max_levels; i++) {
+		if (in_plateau) {
+			const int rising = latency[i] > base * RISE &&
+				(i + 1 == points || latency[i + 1] > base * RISE);
+			if (rising) {
+				/* The last point still at the base latency fits in this level */
+				levels[count].capacity = bytes[i - 1];
+				levels[count].latency_ns = base;
+				count++;
+				in_plateau = 0;
+			} else if (latency[i] < base) {
+				base = latency[i];
+			}
+		} else if (latency[i] < latency[i - 1] * FLAT) {
+			in_plateau = 1;
+			base = latency[i];
+		}
+	}
+	/* Final plateau: capacity unknown (memory) */
+	if (count < max_levels) {
+		levels[count].capacity = 0;
+		levels[count].latency_ns = in_plateau ? base : latency[points - 1];
+		count++;
+	}
+
+	/* A level extends to the end of the last plateau merged into it */
+	int merged = 0;
+	for (int i = 1; i < count; i++) {
+		if (levels[i].latency_ns < levels[merged].latency_ns * MERGE)
+			levels[merged].capacity = levels[i].capacity;
+		else
+			levels[++merged] = levels[i];
+	}
+	return merged + 1;
+}
+/* =================================================================== */
+
+
+/* =================================================================== */
+/* Compare a measured capacity with the reported one for the same level */
+const char* cross_check(size_t measured, size_t reported)
+{
+	if (reported == 0)
+		return "not reported";
+	const double ratio = double(measured) / double(reported);
+	/* The knee appears early for inclusive and shared caches */
+	if (ratio >= 0.45 && ratio <= 1.5)
+		return "consistent";
+	return "MISMATCH";
+}
+/* =================================================================== */
+
+
+int main(int argc, char** argv)
+{
+	size_t max_bytes;
+	const char* path;
+	usage(argc, argv, &max_bytes, &path);
+
+	timer::init();
+
+	/* Reported hierarchy */
+	cacheinfo::hierarchy_t by_cpuid, by_sysfs;
+	cacheinfo::from_cpuid(&by_cpuid);
+	cacheinfo::from_sysfs(&by_sysfs);
+	const cacheinfo::hierarchy_t* reported = by_sysfs.count != 0 ? &by_sysfs : &by_cpuid;
+	const int reported_levels = cacheinfo::last_level(reported);
+
+	/* Sweep to 4x the largest reported cache so that DRAM shows up; the
+		 1 GiB cap never cuts the sweep below twice the LLC */
+	const cacheinfo::level_t* llc = cacheinfo::find_data(reported, reported_levels);
+	const size_t llc_bytes = llc != NULL ? llc->size : 0;
+	if (max_bytes == 0) {
+		max_bytes = 4 * llc_bytes;
+		if (max_bytes < (64u << 20))
+			max_bytes = 64u << 20;
+		if (max_bytes > (1u << 30))
+			max_bytes = 2 * llc_bytes > (1u << 30) ? 2 * llc_bytes : (1u << 30);
+	} else if (max_bytes < 2 * llc_bytes) {
+		fprintf(stderr, "Warning: a sweep to %zu MiB does not reach twice the %zu MiB "
+						"last-level cache; DRAM will not show up\n", max_bytes >> 20, llc_bytes >> 20);
+	}
+
+	void* memory = chase::allocate(max_bytes);
+	if (memory == NULL) {
+		fprintf(stderr, "Cannot allocate %zu bytes\n", max_bytes);
+		return 1;
+	}
+
+	const int max_points = STEPS_PER_OCTAVE * 40;
+	size_t* bytes = (size_t*) malloc(max_points * sizeof(size_t));
+	double* latency = (double*) malloc(max_points * sizeof(double));
+	int points = 0;
+
+	printf("Bytes" "\t" "ns/load" "\n");
+	for (int step = 0; points < max_points; step++) {
+		size_t size = size_t(double(MIN_BYTES) * pow(2.0, double(step) / STEPS_PER_OCTAVE));
+		size -= size % STRIDE;
+		if (size > max_bytes)
+			break;
+		if (points != 0 && size == bytes[points - 1])
+			continue;
+		void** head = chase::build(memory, size, STRIDE, 0x9E3779B97F4A7C15ull + step);
+		size_t steps = 2 * (size / STRIDE);
+		if (steps < (1u << 18)) steps = 1u << 18;
+		if (steps > (1u << 21)) steps = 1u << 21;
+		bytes[points] = size;
+		latency[points] = chase::latency_ns(head, size, STRIDE, steps, TRIALS);
+		printf("%zu" "\t" "%4.03lf\n", bytes[points], latency[points]);
+		fflush(stdout);
+		points++;
+	}
+	chase::release(memory, max_bytes);
+
+	/* Median of three removes isolated outliers before looking for knees */
+	double* smooth = (double*) malloc(max_points * sizeof(double));
+	for (int i = 0; i < points; i++) {
+		const double a = latency[i > 0 ? i - 1 : i];
+		const double b = latency[i];
+		const double c = latency[i + 1 < points ? i + 1 : i];
+		smooth[i] = fmax(fmin(a, b), fmin(fmax(a, b), c));
+	}
+
+	level_estimate_t levels[PROFILE_MAX_LEVELS + 1];
+	const int plateaus = find_plateaus(bytes, smooth, points, levels, PROFILE_MAX_LEVELS + 1);
+	const int measured_levels = levels[plateaus - 1].capacity == 0 ? plateaus - 1 : plateaus;
+
+	/* Build the profile: capacities come from the reported topology,
+		 latencies always come from the staircase */
+	profile::machine_t m;
+	profile::init(&m);
+	profile::load(&m, path);
+	char host[64] = "";
+	gethostname(host, sizeof(host) - 1);
+	snprintf(m.name, sizeof(m.name), "%s", host);
+	m.cache_levels = measured_levels < PROFILE_MAX_LEVELS ? measured_levels : PROFILE_MAX_LEVELS;
+	/* A profile of too few levels would size "DRAM" buffers to fit in the
+		 caches the staircase missed; those levels keep their reported sizes */
+	const int measured = m.cache_levels;
+	if (reported_levels > m.cache_levels)
+		m.cache_levels = reported_levels < PROFILE_MAX_LEVELS ? reported_levels : PROFILE_MAX_LEVELS;
+
+	printf("\n" "Level" "\t" "Measured" "\t" "CPUID" "\t" "sysfs" "\t" "ns" "\t" "Check" "\n");
+	size_t below = 0;
+	for (int i = 0; i < measured; i++) {
+		const cacheinfo::level_t* c = cacheinfo::find_data(&by_cpuid, i + 1);
+		const cacheinfo::level_t* s = cacheinfo::find_data(&by_sysfs, i + 1);
+		const cacheinfo::level_t* r = cacheinfo::find_data(reported, i + 1);
+		const char* check = cross_check(levels[i].capacity, r != NULL ? r->size : 0);
+
+		/* A knee misplaced by prefetching or a noisy point would size
+			 every "DRAM" buffer of the other benchmarks to fit in a cache,
+			 so the reported size wins whenever there is one; a measured
+			 capacity alone is kept only if it grows past the level below */
+		profile::cache_t* out = &m.cache[i];
+		out->latency_ns = levels[i].latency_ns;
+		if (r != NULL) {
+			out->size = r->size;
+			out->line = r->line;
+			out->ways = r->ways;
+			out->shared = r->shared_cpus;
+			if (strcmp(check, "consistent") != 0)
+				check = "MISMATCH, reported size kept";
+		} else if (levels[i].capacity > below) {
+			out->size = levels[i].capacity;
+			out->line = STRIDE;
+			out->ways = 0;
+			out->shared = 0;
+		} else {
+			out->size = 0;
+			out->line = 0;
+			out->ways = 0;
+			out->shared = 0;
+			check = "not reported, rejected (not above the level below)";
+		}
+		if (out->size > below)
+			below = out->size;
+
+		printf("L%d" "\t" "%zu" "\t" "%zu" "\t" "%zu" "\t" "%4.03lf" "\t" "%s" "\n", i + 1,
+					 levels[i].capacity, c != NULL ? c->size : 0, s != NULL ? s->size : 0,
+					 levels[i].latency_ns, check);
+	}
+	for (int i = measured; i < m.cache_levels; i++) {
+		const cacheinfo::level_t* c = cacheinfo::find_data(&by_cpuid, i + 1);
+		const cacheinfo::level_t* s = cacheinfo::find_data(&by_sysfs, i + 1);
+		const cacheinfo::level_t* r = cacheinfo::find_data(reported, i + 1);
+		printf("L%d" "\t" "-" "\t" "%zu" "\t" "%zu" "\t" "-" "\t" "%s" "\n", i + 1,
+					 c != NULL ? c->size : 0, s != NULL ? s->size : 0, "reported only");
+		profile::cache_t* out = &m.cache[i];
+		memset(out, 0, sizeof(*out));
+		if (r != NULL) {
+			out->size = r->size;
+			out->line = r->line;
+			out->ways = r->ways;
+			out->shared = r->shared_cpus;
+		}
+	}
+	if (reported_levels > measured)
+		fprintf(stderr, "Warning: %d cache levels reported, %d found in the staircase; "
+						"L%d and beyond keep the reported sizes\n", reported_levels, measured, measured + 1);
+	/* Levels of an earlier profile that this machine no longer has */
+	for (int i = m.cache_levels; i < PROFILE_MAX_LEVELS; i++)
+		memset(&m.cache[i], 0, sizeof(m.cache[i]));
+
+	if (levels[plateaus - 1].capacity == 0) {
+		m.dram_latency_ns = levels[plateaus - 1].latency_ns;
+		printf("DRAM" "\t" "-" "\t" "-" "\t" "-" "\t" "%4.03lf" "\n", m.dram_latency_ns);
+	}
+
+	if (profile::save(&m, path) != 0) {
+		fprintf(stderr, "Cannot write profile %s\n", path);
+		return 1;
+	}
+	fprintf(stderr, "Profile written to %s\n", path);
+
+	free(bytes);
+	free(latency);
+	free(smooth);
+	return 0;
+}
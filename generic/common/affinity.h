@@ -0,0 +1,335 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Thread placement with sched_setaffinity, the portable replacement for
+	 KMP_AFFINITY.
+
+	 The topology comes from /sys/devices/system/cpu/cpuN/topology
+	 (physical_package_id, core_id) for the CPUs in the process mask; every
+	 function takes the sysfs root like cpufreq.h. A policy orders those CPUs
+	 and thread i runs on the i-th:
+		compact       fill a core's hardware threads, then the next core, then
+		              the next package (KMP_AFFINITY=compact)
+		scatter       round robin over the packages, one thread per core
+		              first, hardware threads last (KMP_AFFINITY=scatter)
+		one-per-core  one thread per core, packages in order; no siblings
+		smt-paired    two hardware threads of a core per pair of threads, the
+		              cores round robin over the packages; any further
+		              hardware threads last
+
+	 Benchmarks read their placement from the environment:
+		UBENCH_CPUS="3,7,1"       explicit CPUs, thread i on the i-th
+		UBENCH_AFFINITY=scatter   a policy; "none" leaves placement to OpenMP
+	 (see ../affinity-sweep).
+ */
+
+#ifndef UBENCH_AFFINITY_H
+#define UBENCH_AFFINITY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace affinity {
+
+	#define AFFINITY_MAX_CPUS 1024
+
+	enum policy_t {
+		POLICY_NONE = 0,
+		POLICY_COMPACT = 1,
+		POLICY_SCATTER = 2,
+		POLICY_CORE = 3,
+		POLICY_SMT_PAIRED = 4,
+		POLICY_COUNT = 5
+	};
+
+	struct cpu_t {
+		int cpu;
+		int package;
+		/* core_id as the kernel reports it; unique within a package only */
+		int core_id;
+		/* Index of the core within its package, from 0 */
+		int core;
+		/* Hardware thread within its core, from 0 */
+		int smt;
+	};
+
+	struct topology_t {
+		int count;
+		int packages;
+		int cores;
+		/* Most hardware threads of one core */
+		int smt;
+		cpu_t cpu[AFFINITY_MAX_CPUS];
+	};
+
+	inline static const char* policy_name(int policy) {
+		static const char* names[POLICY_COUNT] = { "none", "compact", "scatter", "one-per-core", "smt-paired" };
+		return policy >= 0 && policy < POLICY_COUNT ? names[policy] : "unknown";
+	}
+
+	/** \brief Policy by name, -1 if unknown. */
+	inline static int policy_from_name(const char* name) {
+		for (int p = 0; p < POLICY_COUNT; p++) {
+			if (strcmp(name, policy_name(p)) == 0)
+				return p;
+		}
+		return -1;
+	}
+
+	/* One integer attribute of cpuN/topology, -1 if unreadable */
+	inline static int read_topology_id(const char* root, int cpu, const char* name) {
+		char path[512];
+		snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d/topology/%s", root, cpu, name);
+		FILE* f = fopen(path, "r");
+		if (f == NULL)
+			return -1;
+		int value;
+		if (fscanf(f, "%d", &value) != 1)
+			value = -1;
+		fclose(f);
+		return value;
+	}
+
+	/* qsort order of (package, core_id, cpu) */
+	inline static int compare_ids(const void* a, const void* b) {
+		const cpu_t* x = (const cpu_t*) a;
+		const cpu_t* y = (const cpu_t*) b;
+		if (x->package != y->package)
+			return x->package < y->package ? -1 : 1;
+		if (x->core_id != y->core_id)
+			return x->core_id < y->core_id ? -1 : 1;
+		return x->cpu < y->cpu ? -1 : x->cpu > y->cpu;
+	}
+
+	/** \brief Read the topology of the CPUs this process may run on.
+	 * A CPU without topology files counts as a core of its own on package 0.
+	 * Returns the number of CPUs, 0 on failure.
+	 */
+	inline static int read(const char* root, topology_t* t) {
+		memset(t, 0, sizeof(*t));
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+			return 0;
+		for (int cpu = 0; cpu < AFFINITY_MAX_CPUS && cpu < CPU_SETSIZE; cpu++) {
+			if (!CPU_ISSET(cpu, &allowed))
+				continue;
+			cpu_t* c = &t->cpu[t->count++];
+			c->cpu = cpu;
+			c->package = read_topology_id(root, cpu, "physical_package_id");
+			c->core_id = read_topology_id(root, cpu, "core_id");
+			if (c->package < 0 || c->core_id < 0) {
+				c->package = 0;
+				c->core_id = cpu;
+			}
+		}
+		qsort(t->cpu, t->count, sizeof(cpu_t), compare_ids);
+
+		/* Number the cores of each package and the siblings of each core */
+		for (int i = 0; i < t->count; i++) {
+			cpu_t* c = &t->cpu[i];
+			const cpu_t* prev = i > 0 ? &t->cpu[i - 1] : NULL;
+			if (prev == NULL || c->package != prev->package) {
+				t->packages++;
+				t->cores++;
+				c->core = 0;
+				c->smt = 0;
+			} else if (c->core_id != prev->core_id) {
+				t->cores++;
+				c->core = prev->core + 1;
+				c->smt = 0;
+			} else {
+				c->core = prev->core;
+				c->smt = prev->smt + 1;
+			}
+			if (c->smt + 1 > t->smt)
+				t->smt = c->smt + 1;
+		}
+		return t->count;
+	}
+
+	/* Sort key of a CPU under a policy: four 16-bit fields, most significant
+		 first; -1 leaves the CPU out */
+	inline static int64_t policy_key(const cpu_t* c, int policy) {
+		#define AFFINITY_KEY(a, b, d, e) \
+			(((int64_t) (a) << 48) | ((int64_t) (b) << 32) | ((int64_t) (d) << 16) | (int64_t) (e))
+		switch (policy) {
+			case POLICY_COMPACT:
+				return AFFINITY_KEY(0, c->package, c->core, c->smt);
+			case POLICY_SCATTER:
+				return AFFINITY_KEY(0, c->smt, c->core, c->package);
+			case POLICY_CORE:
+				return c->smt == 0 ? AFFINITY_KEY(0, c->package, c->core, 0) : -1;
+			case POLICY_SMT_PAIRED:
+				return c->smt < 2 ? AFFINITY_KEY(0, c->core, c->package, c->smt) :
+					AFFINITY_KEY(1, c->package, c->core, c->smt);
+			default:
+				return -1;
+		}
+		#undef AFFINITY_KEY
+	}
+
+	inline static int compare_keys(const void* a, const void* b) {
+		const int64_t x = ((const int64_t*) a)[0];
+		const int64_t y = ((const int64_t*) b)[0];
+		return x < y ? -1 : x > y;
+	}
+
+	/** \brief CPUs of a policy in thread order.
+	 * Returns their number (at most max): every CPU of the topology, or one
+	 * per core for POLICY_CORE; 0 for POLICY_NONE.
+	 */
+	inline static int place(const topology_t* t, int policy, int* cpus, int max) {
+		/* (key, cpu) pairs */
+		int64_t* order = (int64_t*) malloc(2 * sizeof(int64_t) * (t->count + 1));
+		int count = 0;
+		for (int i = 0; i < t->count; i++) {
+			const int64_t key = policy_key(&t->cpu[i], policy);
+			if (key < 0)
+				continue;
+			order[2 * count] = key;
+			order[2 * count + 1] = t->cpu[i].cpu;
+			count++;
+		}
+		qsort(order, count, 2 * sizeof(int64_t), compare_keys);
+		if (count > max)
+			count = max;
+		for (int i = 0; i < count; i++)
+			cpus[i] = (int) order[2 * i + 1];
+		free(order);
+		return count;
+	}
+
+	/** \brief "0,2,4-7" -> CPUs in that order; returns their number. */
+	inline static int parse_list(const char* list, int* cpus, int max) {
+		int count = 0;
+		const char* p = list;
+		while (*p != '\0' && count < max) {
+			char* end;
+			const int first = (int) strtol(p, &end, 10);
+			int last = first;
+			if (end == p)
+				break;
+			if (*end == '-')
+				last = (int) strtol(end + 1, &end, 10);
+			for (int cpu = first; cpu <= last && count < max; cpu++)
+				cpus[count++] = cpu;
+			p = (*end == ',') ? end + 1 : end;
+		}
+		return count;
+	}
+
+	/** \brief Placement requested through the environment.
+	 * UBENCH_CPUS wins over UBENCH_AFFINITY, which wins over the caller's
+	 * default policy. Returns the number of CPUs, 0 to leave placement alone
+	 * and -1 for an unknown policy name; *how names the source.
+	 */
+	inline static int from_env(int default_policy, int* cpus, int max, const char** how) {
+		const char* list = getenv("UBENCH_CPUS");
+		if (list != NULL && *list != '\0') {
+			*how = "UBENCH_CPUS";
+			return parse_list(list, cpus, max);
+		}
+		const char* name = getenv("UBENCH_AFFINITY");
+		const int policy = name != NULL ? policy_from_name(name) : default_policy;
+		*how = policy_name(policy);
+		if (policy < 0)
+			return -1;
+		if (policy == POLICY_NONE)
+			return 0;
+		topology_t* t = (topology_t*) malloc(sizeof(topology_t));
+		const int count = read("/sys", t) > 0 ? place(t, policy, cpus, max) : 0;
+		free(t);
+		return count;
+	}
+
+	/** \brief Pin the calling thread to one CPU; 0 on success. */
+	inline static int bind(int cpu) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		return sched_setaffinity(0, sizeof(set), &set);
+	}
+
+	/** \brief Restrict the process (and the children it starts) to a set of
+	 * CPUs; 0 on success.
+	 */
+	inline static int restrict_to(const int* cpus, int count) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (int i = 0; i < count; i++)
+			CPU_SET(cpus[i], &set);
+		return sched_setaffinity(0, sizeof(set), &set);
+	}
+
+	/** \brief Print a placement on stderr. */
+	inline static void describe(const char* how, int threads, const int* cpus, int count) {
+		if (count <= 0) {
+			fprintf(stderr, "Affinity: %s, placement left to OpenMP\n", how);
+			return;
+		}
+		fprintf(stderr, "Affinity: %s, %d threads on CPUs", how, threads);
+		for (int i = 0; i < threads; i++)
+			fprintf(stderr, "%s%d", i == 0 ? " " : ",", cpus[i % count]);
+		fprintf(stderr, "%s\n", threads > count ? " (oversubscribed)" : "");
+	}
+
+	#ifdef _OPENMP
+	/** \brief Pin each thread of an OpenMP team of `threads` to cpus[tid %
+	 * count]. The runtime keeps the same threads for later teams of that
+	 * size. Returns the number of threads that could not be pinned.
+	 */
+	inline static int pin_team(int threads, const int* cpus, int count) {
+		int failed = 0;
+		#pragma omp parallel num_threads(threads) reduction(+:failed)
+		{
+			failed += bind(cpus[omp_get_thread_num() % count]) != 0;
+		}
+		return failed;
+	}
+
+	/** \brief Pin an OpenMP team of `threads` as the environment asks, or by
+	 * default_policy; warnings go to stderr and, when verbose, the placement.
+	 * Returns the number of CPUs used, 0 if the threads were left alone.
+	 */
+	inline static int pin_team_from_env(int threads, int default_policy, int verbose) {
+		int* cpus = (int*) malloc(AFFINITY_MAX_CPUS * sizeof(int));
+		const char* how;
+		int count = from_env(default_policy, cpus, AFFINITY_MAX_CPUS, &how);
+		if (count < 0) {
+			fprintf(stderr, "Warning: unknown UBENCH_AFFINITY %s; threads not pinned\n", getenv("UBENCH_AFFINITY"));
+			count = 0;
+		} else if (count > 0 && pin_team(threads, cpus, count) != 0) {
+			fprintf(stderr, "Warning: cannot pin all %d threads\n", threads);
+		}
+		if (verbose)
+			describe(how, threads, cpus, count);
+		free(cpus);
+		return count;
+	}
+	#endif
+}
+
+#endif
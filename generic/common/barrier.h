@@ -0,0 +1,421 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Spin barriers on C++11 atomics, portable to GCC and Clang on x86-64 and
+	 AArch64.
+
+	 simple_t, tree_t and user_t are ports of SIMPLE_BARRIER, TREE_BARRIER
+	 and USER_BARRIER in cpu/intel/xeon_phi/barriers.h, and TreeBarrier keeps
+	 that file's class interface. The KNC `delay` spin becomes cpu_relax()
+	 (pause / yield), the Intel __declspec(align(4096)) arrays become padded
+	 slots and the volatile flags become acquire/release atomics.
+	 sense_t, dissemination_t and tournament_t are the classic centralised
+	 sense-reversing, dissemination and static tournament barriers
+	 (Mellor-Crummey and Scott) for comparison.
+
+	 Every barrier is used as wait(id) with 0 <= id < the thread count given
+	 to init(); the objects are large and over-aligned, so give them static
+	 storage rather than allocating them with new.
+ */
+
+#ifndef UBENCH_BARRIER_H
+#define UBENCH_BARRIER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <atomic>
+
+namespace barrier {
+
+	#define BARRIER_MAX_THREADS 256
+	/* Levels of the 4-ary tree: 4^4 = BARRIER_MAX_THREADS */
+	#define BARRIER_TREE_LEVELS 4
+	#define BARRIER_TREE_GROUP 4
+	/* Dissemination rounds: 2^8 = BARRIER_MAX_THREADS */
+	#define BARRIER_MAX_ROUNDS 8
+	/* Two lines: adjacent-line prefetch would otherwise couple neighbours */
+	#define BARRIER_SLOT_BYTES 128
+	/* Spins before a waiter starts yielding its CPU: far beyond any
+		 barrier latency on dedicated cores, but it keeps oversubscribed runs
+		 from spinning out whole time slices */
+	#define BARRIER_SPINS_BEFORE_YIELD (1 << 14)
+
+	/** \brief Spin-wait hint, the portable stand-in for the KNC delay. */
+	inline static void cpu_relax() {
+		#if defined(__x86_64__) || defined(__i386__)
+			__builtin_ia32_pause();
+		#elif defined(__aarch64__) || defined(__arm__)
+			__asm__ __volatile__ ("yield" ::: "memory");
+		#endif
+	}
+
+	/* One flag per cache-line pair */
+	struct alignas(BARRIER_SLOT_BYTES) slot_t {
+		std::atomic<unsigned> value;
+		char padding[BARRIER_SLOT_BYTES - sizeof(std::atomic<unsigned>)];
+	};
+
+	inline static unsigned load(const slot_t& s) {
+		return s.value.load(std::memory_order_acquire);
+	}
+
+	inline static void store(slot_t& s, unsigned v) {
+		s.value.store(v, std::memory_order_release);
+	}
+
+	inline static void backoff(unsigned* spins) {
+		if (++*spins < BARRIER_SPINS_BEFORE_YIELD)
+			cpu_relax();
+		else
+			sched_yield();
+	}
+
+	inline static void spin_while_zero(const slot_t& s) {
+		unsigned spins = 0;
+		while (load(s) == 0)
+			backoff(&spins);
+	}
+
+	/* Episode counters may run ahead of a reader by one; compare modulo 2^32 */
+	inline static void spin_until(const slot_t& s, unsigned episode) {
+		unsigned spins = 0;
+		while (int(load(s) - episode) < 0)
+			backoff(&spins);
+	}
+
+	inline static void clear(slot_t* s, int count) {
+		for (int i = 0; i < count; i++)
+			s[i].value.store(0, std::memory_order_relaxed);
+	}
+
+	inline static int check_threads(int threads, int limit, const char* name) {
+		if (threads < 1 || threads > limit) {
+			fprintf(stderr, "%s barrier: %d threads (1 to %d supported)\n", name, threads, limit);
+			return -1;
+		}
+		return 0;
+	}
+
+	/* ----------------------------------------------------------------- */
+	/* SIMPLE_BARRIER: thread 0 collects a flag from every other thread and
+		 releases them with one shared flag. Alternate episodes use the
+		 second set of flags, so nothing needs resetting on the critical
+		 path. */
+	struct simple_t {
+		slot_t turn[BARRIER_MAX_THREADS];
+		slot_t flag[2];
+		slot_t count[2][BARRIER_MAX_THREADS];
+		int threads;
+
+		int init(int n) {
+			threads = n;
+			clear(turn, BARRIER_MAX_THREADS);
+			clear(flag, 2);
+			clear(count[0], BARRIER_MAX_THREADS);
+			clear(count[1], BARRIER_MAX_THREADS);
+			return check_threads(n, BARRIER_MAX_THREADS, "Simple");
+		}
+
+		void wait(int id) {
+			/* Which set of flags this episode uses */
+			const int t = int(turn[id].value.load(std::memory_order_relaxed));
+			turn[id].value.store(unsigned(1 - t), std::memory_order_relaxed);
+			if (id == 0) {
+				for (int i = 1; i < threads; i++) {
+					spin_while_zero(count[t][i]);
+					store(count[1 - t][i], 0);
+				}
+				store(flag[1 - t], 0);
+				store(flag[t], 1);
+			} else {
+				store(count[t][id], 1);
+				spin_while_zero(flag[t]);
+			}
+		}
+	};
+
+	/* ----------------------------------------------------------------- */
+	/* TREE_BARRIER: a 4-ary gather tree. At each level the first thread of
+		 a group of 4 (at the level's stride) waits for the other 3, then
+		 moves up; the root releases the tree level by level downwards. */
+	struct tree_t {
+		slot_t turn[BARRIER_MAX_THREADS];
+		slot_t flag[2][BARRIER_TREE_LEVELS][BARRIER_MAX_THREADS];
+		slot_t count[2][BARRIER_TREE_LEVELS][BARRIER_MAX_THREADS];
+		int threads;
+
+		int init(int n) {
+			threads = n;
+			clear(turn, BARRIER_MAX_THREADS);
+			for (int t = 0; t < 2; t++) {
+				for (int level = 0; level < BARRIER_TREE_LEVELS; level++) {
+					clear(flag[t][level], BARRIER_MAX_THREADS);
+					clear(count[t][level], BARRIER_MAX_THREADS);
+				}
+			}
+			return check_threads(n, BARRIER_MAX_THREADS, "Tree");
+		}
+
+		/* Release the levels below `level` that this thread is master of */
+		void release(int id, int t, int level) {
+			while (level > 0) {
+				level--;
+				store(flag[1 - t][level][id], 0);
+				store(flag[t][level][id], 1);
+			}
+		}
+
+		void wait(int id, int n) {
+			const int t = int(turn[id].value.load(std::memory_order_relaxed));
+			turn[id].value.store(unsigned(1 - t), std::memory_order_relaxed);
+			int level = 0;
+			int stride = 1;
+			int mask = BARRIER_TREE_GROUP - 1;
+			for (;;) {
+				if (id & mask) {
+					/* Waiter: report to the group master and wait for it */
+					store(count[t][level][id], 1);
+					spin_while_zero(flag[t][level][id & ~mask]);
+					release(id, t, level);
+					return;
+				}
+				int child = id + stride;
+				for (int set = 1; set < BARRIER_TREE_GROUP && child < n; set++) {
+					spin_while_zero(count[t][level][child]);
+					store(count[1 - t][level][child], 0);
+					child += stride;
+				}
+				level++;
+				stride *= BARRIER_TREE_GROUP;
+				mask *= BARRIER_TREE_GROUP;
+				if (stride >= n) {
+					release(id, t, level);
+					return;
+				}
+			}
+		}
+
+		void wait(int id) {
+			wait(id, threads);
+		}
+	};
+
+	/* ----------------------------------------------------------------- */
+	/* USER_BARRIER: a two-level tree shaped by the caller. The original
+		 hard-codes groups of 12 threads (one Xeon Phi tile set) and at most 24
+		 threads; here the group size is an argument and the second level
+		 gathers every group master, so any thread count works. */
+	struct user_t {
+		slot_t turn[BARRIER_MAX_THREADS];
+		slot_t flag[2][2][BARRIER_MAX_THREADS];
+		slot_t count[2][2][BARRIER_MAX_THREADS];
+		/* Per level and thread: its master, children and child stride */
+		int master[2][BARRIER_MAX_THREADS];
+		int set[2][BARRIER_MAX_THREADS];
+		int stride[2];
+		int levels;
+		int threads;
+
+		int init(int n, int group = 12) {
+			threads = n;
+			if (group < 1)
+				group = 1;
+			clear(turn, BARRIER_MAX_THREADS);
+			for (int t = 0; t < 2; t++) {
+				for (int level = 0; level < 2; level++) {
+					clear(flag[t][level], BARRIER_MAX_THREADS);
+					clear(count[t][level], BARRIER_MAX_THREADS);
+				}
+			}
+			for (int i = 0; i < BARRIER_MAX_THREADS; i++) {
+				master[0][i] = i - i % group;
+				master[1][i] = 0;
+				set[0][i] = group;
+				set[1][i] = (n + group - 1) / group;
+			}
+			stride[0] = 1;
+			stride[1] = group;
+			levels = n <= group ? 1 : 2;
+			return check_threads(n, BARRIER_MAX_THREADS, "User");
+		}
+
+		void release(int id, int t, int level) {
+			while (level > 0) {
+				level--;
+				store(flag[1 - t][level][id], 0);
+				store(flag[t][level][id], 1);
+			}
+		}
+
+		void wait(int id) {
+			const int t = int(turn[id].value.load(std::memory_order_relaxed));
+			turn[id].value.store(unsigned(1 - t), std::memory_order_relaxed);
+			for (int level = 0; ; ) {
+				const int m = master[level][id];
+				if (id != m) {
+					store(count[t][level][id], 1);
+					spin_while_zero(flag[t][level][m]);
+					release(id, t, level);
+					return;
+				}
+				int child = id + stride[level];
+				for (int s = 1; s < set[level][id] && child < threads; s++) {
+					spin_while_zero(count[t][level][child]);
+					store(count[1 - t][level][child], 0);
+					child += stride[level];
+				}
+				level++;
+				if (level == levels) {
+					release(id, t, level);
+					return;
+				}
+			}
+		}
+	};
+
+	/* ----------------------------------------------------------------- */
+	/* Centralised sense-reversing barrier: one atomic counter; the last
+		 arrival resets it and flips the shared sense everyone spins on. */
+	struct sense_t {
+		slot_t count;
+		slot_t sense;
+		slot_t local[BARRIER_MAX_THREADS];
+		int threads;
+
+		int init(int n) {
+			threads = n;
+			count.value.store(0, std::memory_order_relaxed);
+			sense.value.store(0, std::memory_order_relaxed);
+			clear(local, BARRIER_MAX_THREADS);
+			return check_threads(n, BARRIER_MAX_THREADS, "Sense-reversing");
+		}
+
+		void wait(int id) {
+			const unsigned s = 1 - local[id].value.load(std::memory_order_relaxed);
+			local[id].value.store(s, std::memory_order_relaxed);
+			if (count.value.fetch_add(1, std::memory_order_acq_rel) == unsigned(threads - 1)) {
+				count.value.store(0, std::memory_order_relaxed);
+				store(sense, s);
+			} else {
+				unsigned spins = 0;
+				while (load(sense) != s)
+					backoff(&spins);
+			}
+		}
+	};
+
+	/* ----------------------------------------------------------------- */
+	/* Dissemination barrier: in round k thread i signals thread
+		 (i + 2^k) mod n and waits for thread (i - 2^k) mod n; after
+		 ceil(log2 n) rounds everyone has heard from everyone. Flags hold the
+		 episode number, so they never need clearing. */
+	struct dissemination_t {
+		slot_t flag[BARRIER_MAX_THREADS][BARRIER_MAX_ROUNDS];
+		slot_t episode[BARRIER_MAX_THREADS];
+		int rounds;
+		int threads;
+
+		int init(int n) {
+			threads = n;
+			rounds = 0;
+			while ((1 << rounds) < n)
+				rounds++;
+			for (int i = 0; i < BARRIER_MAX_THREADS; i++)
+				clear(flag[i], BARRIER_MAX_ROUNDS);
+			clear(episode, BARRIER_MAX_THREADS);
+			return check_threads(n, BARRIER_MAX_THREADS, "Dissemination");
+		}
+
+		void wait(int id) {
+			const unsigned e = episode[id].value.load(std::memory_order_relaxed) + 1;
+			episode[id].value.store(e, std::memory_order_relaxed);
+			for (int k = 0; k < rounds; k++) {
+				store(flag[(id + (1 << k)) % threads][k], e);
+				spin_until(flag[id][k], e);
+			}
+		}
+	};
+
+	/* ----------------------------------------------------------------- */
+	/* Static tournament barrier: in round k thread i (a multiple of 2^(k+1))
+		 waits for the arrival of i + 2^k, which then waits to be woken; the
+		 champion (thread 0) wakes the threads it beat, and each woken thread
+		 wakes those it beat in earlier rounds. */
+	struct tournament_t {
+		slot_t arrive[BARRIER_MAX_THREADS];
+		slot_t wake[BARRIER_MAX_THREADS];
+		slot_t episode[BARRIER_MAX_THREADS];
+		int threads;
+
+		int init(int n) {
+			threads = n;
+			clear(arrive, BARRIER_MAX_THREADS);
+			clear(wake, BARRIER_MAX_THREADS);
+			clear(episode, BARRIER_MAX_THREADS);
+			return check_threads(n, BARRIER_MAX_THREADS, "Tournament");
+		}
+
+		void wait(int id) {
+			const unsigned e = episode[id].value.load(std::memory_order_relaxed) + 1;
+			episode[id].value.store(e, std::memory_order_relaxed);
+			int k = 0;
+			for (; (1 << k) < threads; k++) {
+				if (id & (1 << k)) {
+					/* Lost round k: report and wait for the winner */
+					store(arrive[id], e);
+					spin_until(wake[id], e);
+					break;
+				}
+				const int opponent = id + (1 << k);
+				if (opponent < threads)
+					spin_until(arrive[opponent], e);
+			}
+			/* Wake the threads beaten in rounds k-1 .. 0 */
+			while (k > 0) {
+				k--;
+				const int opponent = id + (1 << k);
+				if (opponent < threads)
+					store(wake[opponent], e);
+			}
+		}
+	};
+
+	/* ----------------------------------------------------------------- */
+	/* The TreeBarrier class of cpu/intel/xeon_phi/barriers.h */
+	class TreeBarrier {
+		tree_t tree_barrier;
+		int nthreads;
+
+	public:
+		TreeBarrier() : nthreads(0) { Init(); }
+		TreeBarrier(int nthreads) { Init(nthreads); }
+		void Init() { tree_barrier.init(nthreads > 0 ? nthreads : 1); }
+		void Init(int nthreads) {
+			this->nthreads = nthreads;
+			tree_barrier.init(nthreads);
+		}
+		void Wait(int tid) { tree_barrier.wait(tid, nthreads); }
+		void Wait(int tid, int nth) { tree_barrier.wait(tid, nth); }
+	};
+
+}
+
+#endif /* UBENCH_BARRIER_H */
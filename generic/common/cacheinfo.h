@@ -0,0 +1,195 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Cache topology as reported by the processor (CPUID leaf 4, or 0x8000001D
+	 on AMD) and by the kernel (/sys/devices/system/cpu/cpu0/cache). Both are
+	 used to cross-check the capacities measured from the latency staircase.
+ */
+
+#ifndef UBENCH_CACHEINFO_H
+#define UBENCH_CACHEINFO_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include "cpuid.h"
+
+namespace cacheinfo {
+
+	enum type_t {
+		TYPE_NULL = 0,
+		TYPE_DATA = 1,
+		TYPE_INSTRUCTION = 2,
+		TYPE_UNIFIED = 3
+	};
+
+	struct level_t {
+		int level;
+		int type;
+		size_t size;
+		size_t line;
+		int ways;
+		int sets;
+		/* Logical CPUs sharing this cache, 0 if unknown */
+		int shared_cpus;
+	};
+
+	#define CACHEINFO_MAX_LEVELS 8
+
+	struct hierarchy_t {
+		int count;
+		level_t cache[CACHEINFO_MAX_LEVELS];
+	};
+
+	/** \brief Read the deterministic cache parameters leaf.
+	 * Returns the number of caches found, 0 if the leaf is unavailable.
+	 */
+	inline static int from_cpuid(hierarchy_t* h) {
+		memset(h, 0, sizeof(*h));
+		#if defined(__x86_64__) || defined(__i386__)
+			uint32_t leaf = 4;
+			if (cpu::is_amd()) {
+				if (cpu::max_extended_leaf() < 0x8000001Du)
+					return 0;
+				leaf = 0x8000001Du;
+			} else if (cpu::max_leaf() < 4) {
+				return 0;
+			}
+			for (uint32_t index = 0; h->count < CACHEINFO_MAX_LEVELS; index++) {
+				uint32_t regs[4];
+				cpu::cpuid(leaf, index, regs);
+				const int type = regs[0] & 0x1F;
+				if (type == TYPE_NULL)
+					break;
+				level_t* c = &h->cache[h->count++];
+				c->type = type;
+				c->level = (regs[0] >> 5) & 0x7;
+				c->shared_cpus = ((regs[0] >> 14) & 0xFFF) + 1;
+				c->line = (regs[1] & 0xFFF) + 1;
+				c->ways = ((regs[1] >> 22) & 0x3FF) + 1;
+				c->sets = regs[2] + 1;
+				const size_t partitions = ((regs[1] >> 12) & 0x3FF) + 1;
+				c->size = size_t(c->ways) * partitions * c->line * size_t(c->sets);
+			}
+		#endif
+		return h->count;
+	}
+
+	/* Read one small sysfs attribute into buf, returning 0 on failure */
+	inline static int read_attribute(const char* dir, const char* name, char* buf, size_t len) {
+		char path[512];
+		snprintf(path, sizeof(path), "%s/%s", dir, name);
+		FILE* f = fopen(path, "r");
+		if (f == NULL)
+			return 0;
+		const int ok = fgets(buf, int(len), f) != NULL;
+		fclose(f);
+		if (ok)
+			buf[strcspn(buf, "\n")] = '\0';
+		return ok;
+	}
+
+	/* "32K", "1024K", "8M" -> bytes */
+	inline static size_t parse_size(const char* text) {
+		char* end;
+		size_t value = strtoul(text, &end, 10);
+		if (*end == 'K')
+			value <<= 10;
+		else if (*end == 'M')
+			value <<= 20;
+		else if (*end == 'G')
+			value <<= 30;
+		return value;
+	}
+
+	/* Count CPUs in a list such as "0-3,8-11" */
+	inline static int count_cpu_list(const char* text) {
+		int count = 0;
+		while (*text) {
+			char* end;
+			const long first = strtol(text, &end, 10);
+			long last = first;
+			if (end == text)
+				break;
+			if (*end == '-')
+				last = strtol(end + 1, &end, 10);
+			count += int(last - first + 1);
+			text = (*end == ',') ? end + 1 : end;
+		}
+		return count;
+	}
+
+	/** \brief Read the caches of one CPU from sysfs.
+	 * root is normally "/sys/devices/system/cpu/cpu0/cache".
+	 * Returns the number of caches found.
+	 */
+	inline static int from_sysfs(hierarchy_t* h, const char* root = "/sys/devices/system/cpu/cpu0/cache") {
+		memset(h, 0, sizeof(*h));
+		for (int index = 0; h->count < CACHEINFO_MAX_LEVELS; index++) {
+			char dir[256], buf[256];
+			snprintf(dir, sizeof(dir), "%s/index%d", root, index);
+			if (!read_attribute(dir, "type", buf, sizeof(buf)))
+				break;
+			level_t* c = &h->cache[h->count++];
+			if (strcmp(buf, "Data") == 0)
+				c->type = TYPE_DATA;
+			else if (strcmp(buf, "Instruction") == 0)
+				c->type = TYPE_INSTRUCTION;
+			else
+				c->type = TYPE_UNIFIED;
+			if (read_attribute(dir, "level", buf, sizeof(buf)))
+				c->level = atoi(buf);
+			if (read_attribute(dir, "size", buf, sizeof(buf)))
+				c->size = parse_size(buf);
+			if (read_attribute(dir, "coherency_line_size", buf, sizeof(buf)))
+				c->line = strtoul(buf, NULL, 10);
+			if (read_attribute(dir, "ways_of_associativity", buf, sizeof(buf)))
+				c->ways = atoi(buf);
+			if (read_attribute(dir, "number_of_sets", buf, sizeof(buf)))
+				c->sets = atoi(buf);
+			if (read_attribute(dir, "shared_cpu_list", buf, sizeof(buf)))
+				c->shared_cpus = count_cpu_list(buf);
+		}
+		return h->count;
+	}
+
+	/** \brief Data or unified cache at the given level, NULL if absent. */
+	inline static const level_t* find_data(const hierarchy_t* h, int level) {
+		for (int i = 0; i < h->count; i++) {
+			const level_t* c = &h->cache[i];
+			if (c->level == level && c->type != TYPE_INSTRUCTION)
+				return c;
+		}
+		return NULL;
+	}
+
+	/** \brief Highest cache level present, 0 if none. */
+	inline static int last_level(const hierarchy_t* h) {
+		int level = 0;
+		for (int i = 0; i < h->count; i++) {
+			if (h->cache[i].type != TYPE_INSTRUCTION && h->cache[i].level > level)
+				level = h->cache[i].level;
+		}
+		return level;
+	}
+
+}
+
+#endif /* UBENCH_CACHEINFO_H */
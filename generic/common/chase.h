@@ -0,0 +1,138 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Dependent-load (pointer-chasing) latency kernel.
+
+	 Unlike the 12-chaser throughput kernels in random-and-cache, this walks a
+	 single chain so that every load waits for the previous one and the time
+	 per step is the load-to-use latency of whichever level holds the chain.
+	 The chain visits one pointer per `stride` bytes in a random cyclic order
+	 (Sattolo's algorithm), which defeats stride prefetchers.
+ */
+
+#ifndef UBENCH_CHASE_H
+#define UBENCH_CHASE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "timer.h"
+
+namespace chase {
+
+	/* 64-bit xorshift, enough to shuffle the chain */
+	inline static uint64_t next_random(uint64_t* state) {
+		uint64_t x = *state;
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		*state = x;
+		return x;
+	}
+
+	/** \brief Map `bytes` of memory for a chain, backed by huge pages where
+	 * the kernel allows so that large chains measure DRAM rather than TLB
+	 * misses. Returns NULL on failure; release with release().
+	 */
+	inline static void* allocate(size_t bytes) {
+		void* memory = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+												MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (memory == MAP_FAILED)
+			return NULL;
+		#ifdef MADV_HUGEPAGE
+			madvise(memory, bytes, MADV_HUGEPAGE);
+		#endif
+		return memory;
+	}
+
+	inline static void release(void* memory, size_t bytes) {
+		if (memory != NULL)
+			munmap(memory, bytes);
+	}
+
+	/** \brief Link one pointer per `stride` bytes of the first `bytes` of
+	 * memory into a single random cycle. Returns the chain head, NULL when
+	 * fewer than `stride` bytes are given or out of memory.
+	 */
+	inline static void** build(void* memory, size_t bytes, size_t stride, uint64_t seed) {
+		const size_t count = stride != 0 ? bytes / stride : 0;
+		char* base = (char*) memory;
+		if (count == 0)
+			return NULL;
+		size_t* order = (size_t*) malloc(count * sizeof(size_t));
+		if (order == NULL)
+			return NULL;
+		for (size_t i = 0; i < count; i++)
+			order[i] = i;
+		/* Sattolo: a uniformly random permutation with a single cycle */
+		uint64_t state = seed | 1;
+		for (size_t i = count - 1; i > 0; i--) {
+			const size_t j = size_t(next_random(&state) % i);
+			const size_t tmp = order[i];
+			order[i] = order[j];
+			order[j] = tmp;
+		}
+		for (size_t i = 0; i < count; i++) {
+			void** slot = (void**) (base + order[i] * stride);
+			*slot = (void*) (base + order[(i + 1) % count] * stride);
+		}
+		void** head = (void**) (base + order[0] * stride);
+		free(order);
+		return head;
+	}
+
+	/** \brief Follow the chain for `steps` loads; returns where it stopped so
+	 * the walk cannot be optimised away.
+	 */
+	inline static void** walk(void** p, size_t steps) {
+		for (size_t i = steps / 8; i != 0; i--) {
+			p = (void**) *p; p = (void**) *p; p = (void**) *p; p = (void**) *p;
+			p = (void**) *p; p = (void**) *p; p = (void**) *p; p = (void**) *p;
+		}
+		for (size_t i = steps % 8; i != 0; i--)
+			p = (void**) *p;
+		return p;
+	}
+
+	/** \brief Nanoseconds per dependent load over a chain of `bytes`.
+	 * One full lap warms the caches, then the best of `trials` timed walks of
+	 * `steps` loads is reported. timer::init() must have been called.
+	 */
+	inline static double latency_ns(void** head, size_t bytes, size_t stride, size_t steps, int trials) {
+		void** volatile sink;
+		void** p = walk(head, bytes / stride);
+		double best = 0.0;
+		for (int t = 0; t < trials; t++) {
+			const uint64_t start = timer::get_ticks_acquire();
+			p = walk(p, steps);
+			const uint64_t end = timer::get_ticks_release();
+			const double ns = timer::ticks_to_secs(timer::elapsed_ticks(start, end)) * 1.0e+9 / double(steps);
+			if (t == 0 || ns < best)
+				best = ns;
+		}
+		sink = p;
+		(void) sink;
+		return best;
+	}
+
+}
+
+#endif /* UBENCH_CHASE_H */
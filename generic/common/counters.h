@@ -0,0 +1,147 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Minimal hardware event counters over Linux perf_event_open.
+
+	 Only the generic cache events are used so that the same code works on
+	 x86 and ARM kernels. Events the PMU (or a virtual machine) does not
+	 expose open as -1 and read back as -1; callers print "n/a" for them.
+ */
+
+#ifndef UBENCH_COUNTERS_H
+#define UBENCH_COUNTERS_H
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(__linux__)
+	#include <sys/ioctl.h>
+	#include <sys/syscall.h>
+	#include <linux/perf_event.h>
+#endif
+
+namespace counters {
+
+	enum event_t {
+		L1D_READ_MISS,
+		L1D_PREFETCH,
+		LL_PREFETCH,
+		EVENT_COUNT
+	};
+
+	inline static const char* event_name(int event) {
+		switch (event) {
+			case L1D_READ_MISS: return "L1D read misses";
+			case L1D_PREFETCH: return "L1D prefetches";
+			case LL_PREFETCH: return "LLC prefetches";
+			default: return "?";
+		}
+	}
+
+	struct group_t {
+		int fd[EVENT_COUNT];
+	};
+
+	/** \brief Open all events for the calling thread, disabled.
+	 * Returns the number of events that could be opened.
+	 */
+	inline static int open(group_t* g) {
+		int opened = 0;
+		for (int e = 0; e < EVENT_COUNT; e++) {
+			g->fd[e] = -1;
+		#if defined(__linux__)
+			uint64_t cache, op, result;
+			switch (e) {
+				case L1D_READ_MISS:
+					cache = PERF_COUNT_HW_CACHE_L1D;
+					op = PERF_COUNT_HW_CACHE_OP_READ;
+					result = PERF_COUNT_HW_CACHE_RESULT_MISS;
+					break;
+				case L1D_PREFETCH:
+					cache = PERF_COUNT_HW_CACHE_L1D;
+					op = PERF_COUNT_HW_CACHE_OP_PREFETCH;
+					result = PERF_COUNT_HW_CACHE_RESULT_ACCESS;
+					break;
+				default:
+					cache = PERF_COUNT_HW_CACHE_LL;
+					op = PERF_COUNT_HW_CACHE_OP_PREFETCH;
+					result = PERF_COUNT_HW_CACHE_RESULT_ACCESS;
+					break;
+			}
+			struct perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = cache | (op << 8) | (result << 16);
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			g->fd[e] = int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+			if (g->fd[e] >= 0)
+				opened++;
+			else
+				g->fd[e] = -1;
+		#endif
+		}
+		return opened;
+	}
+
+	/** \brief Reset and enable every opened event. */
+	inline static void start(group_t* g) {
+		#if defined(__linux__)
+			for (int e = 0; e < EVENT_COUNT; e++) {
+				if (g->fd[e] >= 0) {
+					ioctl(g->fd[e], PERF_EVENT_IOC_RESET, 0);
+					ioctl(g->fd[e], PERF_EVENT_IOC_ENABLE, 0);
+				}
+			}
+		#endif
+	}
+
+	/** \brief Disable every opened event. */
+	inline static void stop(group_t* g) {
+		#if defined(__linux__)
+			for (int e = 0; e < EVENT_COUNT; e++) {
+				if (g->fd[e] >= 0)
+					ioctl(g->fd[e], PERF_EVENT_IOC_DISABLE, 0);
+			}
+		#endif
+	}
+
+	/** \brief Count of an event since start(), -1 if it is not available. */
+	inline static int64_t value(const group_t* g, int event) {
+		int64_t count = -1;
+		if (g->fd[event] < 0)
+			return -1;
+		if (read(g->fd[event], &count, sizeof(count)) != sizeof(count))
+			return -1;
+		return count;
+	}
+
+	inline static void close(group_t* g) {
+		for (int e = 0; e < EVENT_COUNT; e++) {
+			if (g->fd[e] >= 0)
+				::close(g->fd[e]);
+			g->fd[e] = -1;
+		}
+	}
+
+}
+
+#endif /* UBENCH_COUNTERS_H */
@@ -0,0 +1,267 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Core and uncore frequency control through cpufreq sysfs.
+
+	 Every function takes the sysfs root ("/sys" on a real system) so that
+	 the same code can run against a copy of the tree, e.g. a directory of
+	 plain files laid out as devices/system/cpu/cpuN/cpufreq/... .
+	 Writing needs root privileges on a real system.
+ */
+
+#ifndef UBENCH_CPUFREQ_H
+#define UBENCH_CPUFREQ_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <dirent.h>
+
+namespace cpufreq {
+
+	#define CPUFREQ_MAX_FREQUENCIES 64
+	#define CPUFREQ_MAX_UNCORE 16
+
+	/* Settings of one CPU, saved before a sweep and written back after it */
+	struct policy_t {
+		int cpu;
+		char governor[32];
+		unsigned long min_khz;
+		unsigned long max_khz;
+	};
+
+	/* Uncore limits of one package/die (intel_uncore_frequency) */
+	struct uncore_t {
+		char name[NAME_MAX + 1];
+		unsigned long min_khz;
+		unsigned long max_khz;
+	};
+
+	inline static int read_file(const char* path, char* buf, size_t len) {
+		FILE* f = fopen(path, "r");
+		if (f == NULL)
+			return 0;
+		const int ok = fgets(buf, int(len), f) != NULL;
+		fclose(f);
+		if (ok)
+			buf[strcspn(buf, "\n")] = '\0';
+		return ok;
+	}
+
+	inline static int write_file(const char* path, const char* value) {
+		FILE* f = fopen(path, "w");
+		if (f == NULL)
+			return -1;
+		const int ok = fputs(value, f) >= 0;
+		return (fclose(f) == 0 && ok) ? 0 : -1;
+	}
+
+	inline static void cpu_path(char* path, size_t len, const char* root, int cpu, const char* name) {
+		snprintf(path, len, "%s/devices/system/cpu/cpu%d/cpufreq/%s", root, cpu, name);
+	}
+
+	inline static int read_cpu(const char* root, int cpu, const char* name, char* buf, size_t len) {
+		char path[512];
+		cpu_path(path, sizeof(path), root, cpu, name);
+		return read_file(path, buf, len);
+	}
+
+	inline static int write_cpu(const char* root, int cpu, const char* name, const char* value) {
+		char path[512];
+		cpu_path(path, sizeof(path), root, cpu, name);
+		return write_file(path, value);
+	}
+
+	inline static int write_khz(const char* root, int cpu, const char* name, unsigned long khz) {
+		char value[32];
+		snprintf(value, sizeof(value), "%lu", khz);
+		return write_cpu(root, cpu, name, value);
+	}
+
+	/** \brief Whether the CPU has a cpufreq directory under root. */
+	inline static int available(const char* root, int cpu) {
+		char buf[64];
+		return read_cpu(root, cpu, "scaling_governor", buf, sizeof(buf));
+	}
+
+	/** \brief Average scaling_cur_freq in kHz over the first `max_cpus`
+	 * CPUs that have cpufreq, 0 if none does.
+	 */
+	inline static unsigned long average_khz(const char* root, int max_cpus) {
+		unsigned long long sum = 0;
+		int count = 0;
+		char buf[64];
+		for (int cpu = 0; cpu < max_cpus; cpu++) {
+			if (!read_cpu(root, cpu, "scaling_cur_freq", buf, sizeof(buf)))
+				continue;
+			sum += strtoul(buf, NULL, 10);
+			count++;
+		}
+		return count > 0 ? (unsigned long) (sum / count) : 0;
+	}
+
+	/** \brief Read governor and limits of a CPU; returns -1 if missing. */
+	inline static int save(const char* root, int cpu, policy_t* p) {
+		char buf[64];
+		memset(p, 0, sizeof(*p));
+		p->cpu = cpu;
+		if (!read_cpu(root, cpu, "scaling_governor", p->governor, sizeof(p->governor)))
+			return -1;
+		if (!read_cpu(root, cpu, "scaling_min_freq", buf, sizeof(buf)))
+			return -1;
+		p->min_khz = strtoul(buf, NULL, 10);
+		if (!read_cpu(root, cpu, "scaling_max_freq", buf, sizeof(buf)))
+			return -1;
+		p->max_khz = strtoul(buf, NULL, 10);
+		return 0;
+	}
+
+	/* The kernel rejects min > max, so the limit that moves away from the
+		 other one is written first */
+	inline static int write_limits(const char* root, int cpu, unsigned long min_khz, unsigned long max_khz) {
+		char buf[64];
+		unsigned long current_max = 0;
+		if (read_cpu(root, cpu, "scaling_max_freq", buf, sizeof(buf)))
+			current_max = strtoul(buf, NULL, 10);
+		if (min_khz > current_max) {
+			if (write_khz(root, cpu, "scaling_max_freq", max_khz) != 0)
+				return -1;
+			return write_khz(root, cpu, "scaling_min_freq", min_khz);
+		}
+		if (write_khz(root, cpu, "scaling_min_freq", min_khz) != 0)
+			return -1;
+		return write_khz(root, cpu, "scaling_max_freq", max_khz);
+	}
+
+	/** \brief Write back settings from save(). */
+	inline static int restore(const char* root, const policy_t* p) {
+		const int governor = write_cpu(root, p->cpu, "scaling_governor", p->governor);
+		const int limits = write_limits(root, p->cpu, p->min_khz, p->max_khz);
+		return (governor == 0 && limits == 0) ? 0 : -1;
+	}
+
+	/** \brief Pin a CPU to one frequency: the "performance" governor (when
+	 * offered) with scaling_min_freq = scaling_max_freq = khz.
+	 */
+	inline static int pin(const char* root, int cpu, unsigned long khz) {
+		char governors[256];
+		if (read_cpu(root, cpu, "scaling_available_governors", governors, sizeof(governors)) &&
+				strstr(governors, "performance") != NULL)
+			write_cpu(root, cpu, "scaling_governor", "performance");
+		return write_limits(root, cpu, khz, khz);
+	}
+
+	/** \brief Frequencies the CPU offers, ascending. Uses
+	 * scaling_available_frequencies where the driver lists them, otherwise
+	 * `steps` evenly spaced points between cpuinfo_min_freq and
+	 * cpuinfo_max_freq. Returns the count.
+	 */
+	inline static int frequencies(const char* root, int cpu, unsigned long* khz, int max, int steps) {
+		char buf[1024];
+		int count = 0;
+		if (read_cpu(root, cpu, "scaling_available_frequencies", buf, sizeof(buf))) {
+			for (char* t = strtok(buf, " "); t != NULL && count < max; t = strtok(NULL, " ")) {
+				const unsigned long f = strtoul(t, NULL, 10);
+				if (f != 0)
+					khz[count++] = f;
+			}
+		}
+		if (count == 0) {
+			char low[32], high[32];
+			if (!read_cpu(root, cpu, "cpuinfo_min_freq", low, sizeof(low)) ||
+					!read_cpu(root, cpu, "cpuinfo_max_freq", high, sizeof(high)))
+				return 0;
+			const unsigned long lo = strtoul(low, NULL, 10);
+			const unsigned long hi = strtoul(high, NULL, 10);
+			if (steps < 2) steps = 2;
+			for (int i = 0; i < steps && count < max; i++)
+				khz[count++] = lo + (hi - lo) * (unsigned long) i / (unsigned long) (steps - 1);
+		}
+		/* Some drivers list frequencies in descending order */
+		for (int i = 1; i < count; i++) {
+			for (int j = i; j > 0 && khz[j - 1] > khz[j]; j--) {
+				const unsigned long t = khz[j]; khz[j] = khz[j - 1]; khz[j - 1] = t;
+			}
+		}
+		return count;
+	}
+
+	/* ----------------------------------------------------------------- */
+	/* Uncore: <root>/devices/system/cpu/intel_uncore_frequency/<domain>/ */
+
+	inline static void uncore_path(char* path, size_t len, const char* root, const char* domain, const char* name) {
+		snprintf(path, len, "%s/devices/system/cpu/intel_uncore_frequency/%s/%s", root, domain, name);
+	}
+
+	/** \brief Save the limits of every uncore domain; returns the count
+	 * (0 when the driver is not loaded).
+	 */
+	inline static int uncore_save(const char* root, uncore_t* u, int max) {
+		char dir[512];
+		snprintf(dir, sizeof(dir), "%s/devices/system/cpu/intel_uncore_frequency", root);
+		DIR* d = opendir(dir);
+		if (d == NULL)
+			return 0;
+		int count = 0;
+		struct dirent* e;
+		while ((e = readdir(d)) != NULL && count < max) {
+			if (e->d_name[0] == '.')
+				continue;
+			char path[512], buf[32];
+			uncore_t* entry = &u[count];
+			snprintf(entry->name, sizeof(entry->name), "%s", e->d_name);
+			uncore_path(path, sizeof(path), root, entry->name, "min_freq_khz");
+			if (!read_file(path, buf, sizeof(buf)))
+				continue;
+			entry->min_khz = strtoul(buf, NULL, 10);
+			uncore_path(path, sizeof(path), root, entry->name, "max_freq_khz");
+			if (!read_file(path, buf, sizeof(buf)))
+				continue;
+			entry->max_khz = strtoul(buf, NULL, 10);
+			count++;
+		}
+		closedir(d);
+		return count;
+	}
+
+	inline static int uncore_write(const char* root, const char* domain, unsigned long min_khz, unsigned long max_khz) {
+		char path[512], value[32];
+		/* Same ordering rule as the core limits */
+		uncore_path(path, sizeof(path), root, domain, "max_freq_khz");
+		char buf[32];
+		const unsigned long current_max = read_file(path, buf, sizeof(buf)) ? strtoul(buf, NULL, 10) : 0;
+		const char* first = min_khz > current_max ? "max_freq_khz" : "min_freq_khz";
+		const char* second = min_khz > current_max ? "min_freq_khz" : "max_freq_khz";
+		uncore_path(path, sizeof(path), root, domain, first);
+		snprintf(value, sizeof(value), "%lu", strcmp(first, "max_freq_khz") == 0 ? max_khz : min_khz);
+		if (write_file(path, value) != 0)
+			return -1;
+		uncore_path(path, sizeof(path), root, domain, second);
+		snprintf(value, sizeof(value), "%lu", strcmp(second, "max_freq_khz") == 0 ? max_khz : min_khz);
+		return write_file(path, value);
+	}
+
+	inline static int uncore_restore(const char* root, const uncore_t* u) {
+		return uncore_write(root, u->name, u->min_khz, u->max_khz);
+	}
+
+}
+
+#endif /* UBENCH_CPUFREQ_H */
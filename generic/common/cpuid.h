@@ -0,0 +1,146 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* CPUID access shared by the timer, the cache-topology readers and the
+	 kernels that pick an instruction set at runtime */
+
+#ifndef UBENCH_CPUID_H
+#define UBENCH_CPUID_H
+
+#include <stdint.h>
+#include <string.h>
+
+namespace cpu {
+
+#if defined(__x86_64__) || defined(__i386__)
+	inline static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) {
+		__asm__ __volatile__ (
+			"cpuid;"
+		: "=a"(regs[0]), "=b"(regs[1]), "=c"(regs[2]), "=d"(regs[3])
+		: "a"(leaf), "c"(subleaf)
+		);
+	}
+
+	inline static uint32_t max_leaf() {
+		uint32_t regs[4];
+		cpuid(0, 0, regs);
+		return regs[0];
+	}
+
+	inline static uint32_t max_extended_leaf() {
+		uint32_t regs[4];
+		cpuid(0x80000000u, 0, regs);
+		return regs[0];
+	}
+
+	/* 12-character vendor string, e.g. "GenuineIntel" */
+	inline static void vendor(char name[13]) {
+		uint32_t regs[4];
+		cpuid(0, 0, regs);
+		memcpy(name + 0, &regs[1], 4);
+		memcpy(name + 4, &regs[3], 4);
+		memcpy(name + 8, &regs[2], 4);
+		name[12] = '\0';
+	}
+
+	inline static int is_amd() {
+		char name[13];
+		vendor(name);
+		return strcmp(name, "AuthenticAMD") == 0 || strcmp(name, "HygonGenuine") == 0;
+	}
+
+	/* Register state the OS saves on context switch (XCR0) */
+	inline static uint64_t xgetbv() {
+		uint32_t eax, edx;
+		__asm__ __volatile__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (uint64_t(edx) << 32) | eax;
+	}
+
+	/* Leaf 1 ECX and leaf 7 EBX/ECX/EDX feature bits */
+	inline static int feature_leaf1_ecx(int bit) {
+		uint32_t regs[4];
+		cpuid(1, 0, regs);
+		return (regs[2] >> bit) & 1;
+	}
+
+	inline static int feature_leaf7(int reg, int bit) {
+		uint32_t regs[4];
+		if (max_leaf() < 7)
+			return 0;
+		cpuid(7, 0, regs);
+		return (regs[reg] >> bit) & 1;
+	}
+
+	/* Leaf 7 subleaf 1 (EAX holds AVX512_BF16 and AVX-VNNI) */
+	inline static int feature_leaf7_1(int reg, int bit) {
+		uint32_t regs[4];
+		if (max_leaf() < 7)
+			return 0;
+		cpuid(7, 0, regs);
+		if (regs[0] < 1)
+			return 0;
+		cpuid(7, 1, regs);
+		return (regs[reg] >> bit) & 1;
+	}
+
+	/** \brief AVX usable: CPU support plus OS-enabled YMM state. */
+	inline static int has_avx() {
+		if (!feature_leaf1_ecx(27) || !feature_leaf1_ecx(28))
+			return 0;
+		return (xgetbv() & 0x6) == 0x6;
+	}
+
+	inline static int has_fma() {
+		return has_avx() && feature_leaf1_ecx(12);
+	}
+
+	inline static int has_avx2() {
+		return has_avx() && feature_leaf7(1, 5);
+	}
+
+	/* Half-precision load/store conversions (VCVTPH2PS, VCVTPS2PH) */
+	inline static int has_f16c() {
+		return has_avx() && feature_leaf1_ecx(29);
+	}
+
+	/** \brief AVX-512 Foundation usable: CPU support plus OS-enabled
+	 * opmask and ZMM state. */
+	inline static int has_avx512f() {
+		if (!has_avx() || !feature_leaf7(1, 16))
+			return 0;
+		return (xgetbv() & 0xE6) == 0xE6;
+	}
+
+	/* AVX-512 extensions for reduced-precision and integer dot products */
+	inline static int has_avx512_fp16() {
+		return has_avx512f() && feature_leaf7(3, 23);
+	}
+
+	inline static int has_avx512_bf16() {
+		return has_avx512f() && feature_leaf7_1(0, 5);
+	}
+
+	inline static int has_avx512_vnni() {
+		return has_avx512f() && feature_leaf7(2, 11);
+	}
+#endif
+
+}
+
+#endif /* UBENCH_CPUID_H */
@@ -0,0 +1,269 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Hardware/software fingerprint of a host, used to key cached benchmark
+	 results: two hosts with the same fingerprint are expected to measure the
+	 same, and a host whose fingerprint changes (new microcode, kernel or
+	 memory population) is measured again.
+
+	 The fingerprint is a text of "key = value" lines, each read from CPUID,
+	 /proc or sysfs where readable, plus its 64-bit FNV-1a hash:
+		 cpu        vendor and family-model-stepping (MIDR on AArch64)
+		 microcode  /proc/cpuinfo or sysfs microcode revision
+		 cpus       configured logical CPUs
+		 cache      size of every data/unified level
+		 memory     DIMM sizes from EDAC or SMBIOS type 17 entries, or the
+		            total in GiB when neither is readable
+		 kernel     uname release
+ */
+
+#ifndef UBENCH_FINGERPRINT_H
+#define UBENCH_FINGERPRINT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/utsname.h>
+#include "cpuid.h"
+#include "cacheinfo.h"
+
+namespace fingerprint {
+
+	#define FINGERPRINT_MAX_TEXT 4096
+	#define FINGERPRINT_FNV_SEED 0xcbf29ce484222325ull
+
+	struct fingerprint_t {
+		char text[FINGERPRINT_MAX_TEXT];
+		uint64_t hash;
+	};
+
+	/** \brief 64-bit FNV-1a of `bytes` bytes, continuing from `hash`. */
+	inline static uint64_t fnv1a(const void* data, size_t bytes, uint64_t hash = FINGERPRINT_FNV_SEED) {
+		const uint8_t* p = (const uint8_t*) data;
+		for (size_t i = 0; i < bytes; i++) {
+			hash ^= p[i];
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	/** \brief FNV-1a of a file's contents; returns 0 on success, -1 if it
+	 * cannot be read.
+	 */
+	inline static int hash_file(const char* path, uint64_t* hash) {
+		FILE* f = fopen(path, "rb");
+		if (f == NULL)
+			return -1;
+		uint64_t h = FINGERPRINT_FNV_SEED;
+		char buf[1 << 16];
+		size_t n;
+		while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+			h = fnv1a(buf, n, h);
+		fclose(f);
+		*hash = h;
+		return 0;
+	}
+
+	/** \brief Resolve the program a shell command starts (its first word,
+	 * searched in $PATH when it has no '/'). Returns 0 on success.
+	 */
+	inline static int command_binary(const char* command, char* path, size_t len) {
+		while (*command == ' ' || *command == '\t')
+			command++;
+		char program[512];
+		const size_t n = strcspn(command, " \t");
+		if (n == 0 || n >= sizeof(program))
+			return -1;
+		memcpy(program, command, n);
+		program[n] = '\0';
+		if (strchr(program, '/') != NULL) {
+			snprintf(path, len, "%s", program);
+			return access(path, R_OK) == 0 ? 0 : -1;
+		}
+		const char* dirs = getenv("PATH");
+		while (dirs != NULL && *dirs != '\0') {
+			const size_t d = strcspn(dirs, ":");
+			snprintf(path, len, "%.*s/%s", int(d), dirs, program);
+			if (access(path, X_OK) == 0)
+				return 0;
+			dirs += d + (dirs[d] == ':');
+		}
+		return -1;
+	}
+
+	inline static void append(fingerprint_t* fp, const char* key, const char* value) {
+		const size_t used = strlen(fp->text);
+		snprintf(fp->text + used, sizeof(fp->text) - used, "%s = %s\n", key, value);
+	}
+
+	inline static int read_line(const char* path, char* buf, size_t len) {
+		FILE* f = fopen(path, "r");
+		if (f == NULL)
+			return 0;
+		const int ok = fgets(buf, int(len), f) != NULL;
+		fclose(f);
+		if (ok)
+			buf[strcspn(buf, "\n")] = '\0';
+		return ok;
+	}
+
+	/* Value of the first "key : value" line of /proc/cpuinfo */
+	inline static int cpuinfo_field(const char* key, char* buf, size_t len) {
+		FILE* f = fopen("/proc/cpuinfo", "r");
+		if (f == NULL)
+			return 0;
+		char line[512];
+		int found = 0;
+		while (!found && fgets(line, sizeof(line), f) != NULL) {
+			if (strncmp(line, key, strlen(key)) != 0)
+				continue;
+			const char* colon = strchr(line, ':');
+			if (colon == NULL)
+				continue;
+			colon++;
+			while (*colon == ' ' || *colon == '\t')
+				colon++;
+			snprintf(buf, len, "%s", colon);
+			buf[strcspn(buf, "\n")] = '\0';
+			found = 1;
+		}
+		fclose(f);
+		return found;
+	}
+
+	inline static void cpu_model(char* buf, size_t len) {
+		#if defined(__x86_64__) || defined(__i386__)
+			char name[13];
+			uint32_t regs[4];
+			cpu::vendor(name);
+			cpu::cpuid(1, 0, regs);
+			/* Display family and model, as in /proc/cpuinfo */
+			uint32_t family = (regs[0] >> 8) & 0xF;
+			uint32_t model = (regs[0] >> 4) & 0xF;
+			if (family == 0xF)
+				family += (regs[0] >> 20) & 0xFF;
+			if (family == 0x6 || family >= 0xF)
+				model |= ((regs[0] >> 16) & 0xF) << 4;
+			snprintf(buf, len, "%s %u-%u-%u", name, family, model, regs[0] & 0xF);
+		#else
+			if (!read_line("/sys/devices/system/cpu/cpu0/regs/identification/midr_el1", buf, len))
+				snprintf(buf, len, "unknown");
+		#endif
+	}
+
+	inline static void microcode(char* buf, size_t len) {
+		if (!cpuinfo_field("microcode", buf, len) &&
+				!read_line("/sys/devices/system/cpu/cpu0/microcode/version", buf, len))
+			snprintf(buf, len, "unknown");
+	}
+
+	inline static void caches(char* buf, size_t len) {
+		cacheinfo::hierarchy_t h;
+		if (cacheinfo::from_sysfs(&h) == 0)
+			cacheinfo::from_cpuid(&h);
+		buf[0] = '\0';
+		for (int level = 1; level <= cacheinfo::last_level(&h); level++) {
+			const cacheinfo::level_t* c = cacheinfo::find_data(&h, level);
+			if (c == NULL)
+				continue;
+			const size_t used = strlen(buf);
+			snprintf(buf + used, len - used, "%sL%d %zuK", used ? ", " : "", level, c->size >> 10);
+		}
+	}
+
+	/* DIMM population: EDAC dimmN/size (MB), else the size words of the
+		 SMBIOS memory device (type 17) entries, which usually need root */
+	inline static int dimms(char* buf, size_t len) {
+		buf[0] = '\0';
+		int count = 0;
+		char path[512], value[64];
+		for (int mc = 0; ; mc++) {
+			snprintf(path, sizeof(path), "/sys/devices/system/edac/mc/mc%d", mc);
+			if (access(path, F_OK) != 0)
+				break;
+			for (int d = 0; d < 64; d++) {
+				snprintf(path, sizeof(path), "/sys/devices/system/edac/mc/mc%d/dimm%d/size", mc, d);
+				if (!read_line(path, value, sizeof(value)))
+					continue;
+				const size_t used = strlen(buf);
+				snprintf(buf + used, len - used, "%s%sM", used ? " " : "", value);
+				count++;
+			}
+		}
+		if (count > 0)
+			return count;
+		for (int e = 0; e < 256; e++) {
+			snprintf(path, sizeof(path), "/sys/firmware/dmi/entries/17-%d/raw", e);
+			FILE* f = fopen(path, "rb");
+			if (f == NULL)
+				break;
+			uint8_t raw[0x20];
+			memset(raw, 0, sizeof(raw));
+			const size_t n = fread(raw, 1, sizeof(raw), f);
+			fclose(f);
+			if (n < 0x0E)
+				continue;
+			/* Size at 0x0C: MB (bit 15 clear) or KB; 0x7FFF means the
+				 extended size at 0x1C in MB; 0 is an empty slot */
+			uint32_t mb = raw[0x0C] | (raw[0x0D] << 8);
+			if (mb == 0x7FFF && n >= 0x20)
+				mb = raw[0x1C] | (raw[0x1D] << 8) | (raw[0x1E] << 16) | (uint32_t(raw[0x1F] & 0x7F) << 24);
+			else if (mb & 0x8000)
+				mb = (mb & 0x7FFF) >> 10;
+			if (mb == 0 || mb == 0xFFFF)
+				snprintf(value, sizeof(value), "empty");
+			else
+				snprintf(value, sizeof(value), "%uM", mb);
+			const size_t used = strlen(buf);
+			snprintf(buf + used, len - used, "%s%s", used ? " " : "", value);
+			count++;
+		}
+		return count;
+	}
+
+	/** \brief Fingerprint of the running host. */
+	inline static void build(fingerprint_t* fp) {
+		memset(fp, 0, sizeof(*fp));
+		char value[1024];
+		cpu_model(value, sizeof(value));
+		append(fp, "cpu", value);
+		microcode(value, sizeof(value));
+		append(fp, "microcode", value);
+		snprintf(value, sizeof(value), "%ld", sysconf(_SC_NPROCESSORS_CONF));
+		append(fp, "cpus", value);
+		caches(value, sizeof(value));
+		append(fp, "cache", value);
+		if (dimms(value, sizeof(value)) == 0) {
+			/* Total memory rounded to GiB: firmware reservations vary */
+			const double gib = double(sysconf(_SC_PHYS_PAGES)) * double(sysconf(_SC_PAGESIZE)) / double(1 << 30);
+			snprintf(value, sizeof(value), "%.0fG total", gib);
+		}
+		append(fp, "memory", value);
+		struct utsname u;
+		if (uname(&u) == 0)
+			append(fp, "kernel", u.release);
+		fp->hash = fnv1a(fp->text, strlen(fp->text));
+	}
+
+}
+
+#endif /* UBENCH_FINGERPRINT_H */
@@ -0,0 +1,117 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Package energy from the powercap (RAPL) sysfs interface.
+
+	 Sums energy_uj over the top-level zones <root>/class/powercap/intel-rapl:N
+	 (one per package; AMD exposes the same interface). Counters wrap at
+	 max_energy_range_uj, which joules() accounts for as long as fewer than
+	 one wrap happens between two readings. As in cpufreq.h the sysfs root
+	 is a parameter so that a fake tree can stand in for /sys.
+ */
+
+#ifndef UBENCH_POWERCAP_H
+#define UBENCH_POWERCAP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace powercap {
+
+	#define POWERCAP_MAX_ZONES 16
+
+	struct reading_t {
+		int zones;
+		uint64_t uj[POWERCAP_MAX_ZONES];
+		uint64_t range_uj[POWERCAP_MAX_ZONES];
+	};
+
+	inline static int read_u64(const char* path, uint64_t* value) {
+		FILE* f = fopen(path, "r");
+		if (f == NULL)
+			return 0;
+		unsigned long long v;
+		const int ok = fscanf(f, "%llu", &v) == 1;
+		fclose(f);
+		if (ok)
+			*value = v;
+		return ok;
+	}
+
+	/** \brief Read every package zone; returns the zone count (0 when
+	 * energy counters are not available or not readable).
+	 */
+	inline static int read(const char* root, reading_t* r) {
+		r->zones = 0;
+		for (int zone = 0; zone < POWERCAP_MAX_ZONES; zone++) {
+			char path[512];
+			snprintf(path, sizeof(path), "%s/class/powercap/intel-rapl:%d/energy_uj", root, zone);
+			if (!read_u64(path, &r->uj[r->zones]))
+				break;
+			snprintf(path, sizeof(path), "%s/class/powercap/intel-rapl:%d/max_energy_range_uj", root, zone);
+			if (!read_u64(path, &r->range_uj[r->zones]))
+				r->range_uj[r->zones] = 0;
+			r->zones++;
+		}
+		return r->zones;
+	}
+
+	/** \brief Longest power-limit time window of any package zone
+	 * (constraint_N_time_window_us, e.g. the PL1 window that bounds how
+	 * long PL2 turbo lasts), in seconds; 0 when none is readable.
+	 */
+	inline static double time_window_secs(const char* root) {
+		uint64_t longest = 0;
+		for (int zone = 0; zone < POWERCAP_MAX_ZONES; zone++) {
+			int found = 0;
+			for (int constraint = 0; constraint < 8; constraint++) {
+				char path[512];
+				uint64_t us;
+				snprintf(path, sizeof(path), "%s/class/powercap/intel-rapl:%d/constraint_%d_time_window_us",
+								 root, zone, constraint);
+				if (!read_u64(path, &us))
+					break;
+				found = 1;
+				if (us > longest)
+					longest = us;
+			}
+			if (!found)
+				break;
+		}
+		return double(longest) * 1.0e-6;
+	}
+
+	/** \brief Joules consumed between two readings of the same zones. */
+	inline static double joules(const reading_t* start, const reading_t* end) {
+		double total = 0.0;
+		const int zones = start->zones < end->zones ? start->zones : end->zones;
+		for (int i = 0; i < zones; i++) {
+			uint64_t delta = end->uj[i] - start->uj[i];
+			if (end->uj[i] < start->uj[i])
+				delta = end->range_uj[i] - start->uj[i] + end->uj[i];
+			total += double(delta) * 1.0e-6;
+		}
+		return total;
+	}
+
+}
+
+#endif /* UBENCH_POWERCAP_H */
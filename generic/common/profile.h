@@ -0,0 +1,240 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Machine profile: the measured characteristics of one host, written by the
+	 characterisation tools and read back by benchmarks that size their
+	 buffers or predict performance from it.
+
+	 The on-disk format is one "key = value" pair per line; '#' starts a
+	 comment and unknown keys are ignored, so older readers accept newer
+	 profiles. The file is located with $UBENCH_PROFILE, or machine.profile
+	 in the working directory.
+ */
+
+#ifndef UBENCH_PROFILE_H
+#define UBENCH_PROFILE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include "cacheinfo.h"
+
+namespace profile {
+
+	#define PROFILE_MAX_LEVELS 4
+
+	struct cache_t {
+		size_t size;
+		size_t line;
+		int ways;
+		/* Logical CPUs sharing the cache */
+		int shared;
+		/* Load-to-use latency of a dependent load hitting this level */
+		double latency_ns;
+	};
+
+	/* Fitted roofline and energy-roofline parameters (see roofline-fit):
+		 time = max(flops / peak flop rate, bytes / peak bandwidth)
+		 energy = flops * flop_pj + bytes * byte_pj + constant_w * time */
+	struct roofline_t {
+		double peak_gflops;
+		double peak_gbps;
+		double flop_pj;
+		double byte_pj;
+		double constant_w;
+		/* Goodness of fit (R^2) of the time and energy models */
+		double time_r2;
+		double energy_r2;
+		/* Threads the sweep ran with */
+		int threads;
+		/* Bandwidth from a working set resident in each cache level, 0 when
+			 not measured (peak_gbps is the DRAM bandwidth) */
+		double level_gbps[PROFILE_MAX_LEVELS];
+		/* Energy per byte moved from each cache level, 0 when not measured
+			 (byte_pj is the DRAM figure) */
+		double level_byte_pj[PROFILE_MAX_LEVELS];
+	};
+
+	struct machine_t {
+		char name[128];
+		int cache_levels;
+		cache_t cache[PROFILE_MAX_LEVELS];
+		double dram_latency_ns;
+		roofline_t roofline;
+	};
+
+	inline static void init(machine_t* m) {
+		memset(m, 0, sizeof(*m));
+	}
+
+	/* Calls v(key, field) for every persisted field. Adding a field to the
+		 profile means adding one line here. */
+	template <class Visitor>
+	inline void visit(machine_t* m, Visitor& v) {
+		v("cache_levels", m->cache_levels);
+		for (int i = 0; i < PROFILE_MAX_LEVELS; i++) {
+			char key[64];
+			snprintf(key, sizeof(key), "l%d.size", i + 1);
+			v(key, m->cache[i].size);
+			snprintf(key, sizeof(key), "l%d.line", i + 1);
+			v(key, m->cache[i].line);
+			snprintf(key, sizeof(key), "l%d.ways", i + 1);
+			v(key, m->cache[i].ways);
+			snprintf(key, sizeof(key), "l%d.shared", i + 1);
+			v(key, m->cache[i].shared);
+			snprintf(key, sizeof(key), "l%d.latency_ns", i + 1);
+			v(key, m->cache[i].latency_ns);
+		}
+		v("dram.latency_ns", m->dram_latency_ns);
+		v("roofline.peak_gflops", m->roofline.peak_gflops);
+		v("roofline.peak_gbps", m->roofline.peak_gbps);
+		v("roofline.flop_pj", m->roofline.flop_pj);
+		v("roofline.byte_pj", m->roofline.byte_pj);
+		v("roofline.constant_w", m->roofline.constant_w);
+		v("roofline.time_r2", m->roofline.time_r2);
+		v("roofline.energy_r2", m->roofline.energy_r2);
+		v("roofline.threads", m->roofline.threads);
+		for (int i = 0; i < PROFILE_MAX_LEVELS; i++) {
+			char key[64];
+			snprintf(key, sizeof(key), "roofline.l%d.gbps", i + 1);
+			v(key, m->roofline.level_gbps[i]);
+			snprintf(key, sizeof(key), "roofline.l%d.byte_pj", i + 1);
+			v(key, m->roofline.level_byte_pj[i]);
+		}
+	}
+
+	struct writer_t {
+		FILE* f;
+		void operator()(const char* key, int& value) { if (value) fprintf(f, "%s = %d\n", key, value); }
+		void operator()(const char* key, size_t& value) { if (value) fprintf(f, "%s = %zu\n", key, value); }
+		void operator()(const char* key, double& value) { if (value != 0.0) fprintf(f, "%s = %.6g\n", key, value); }
+	};
+
+	struct reader_t {
+		const char* key;
+		const char* value;
+		int matched;
+		void operator()(const char* k, int& field) { if (strcmp(k, key) == 0) { field = atoi(value); matched = 1; } }
+		void operator()(const char* k, size_t& field) { if (strcmp(k, key) == 0) { field = strtoull(value, NULL, 10); matched = 1; } }
+		void operator()(const char* k, double& field) { if (strcmp(k, key) == 0) { field = atof(value); matched = 1; } }
+	};
+
+	/** \brief Path of the profile: $UBENCH_PROFILE or "machine.profile". */
+	inline static const char* default_path() {
+		const char* path = getenv("UBENCH_PROFILE");
+		return (path != NULL && path[0] != '\0') ? path : "machine.profile";
+	}
+
+	/** \brief Write the profile; returns 0 on success, -1 on I/O error. */
+	inline static int save(const machine_t* m, const char* path) {
+		FILE* f = fopen(path, "w");
+		if (f == NULL)
+			return -1;
+		fprintf(f, "# ubench machine profile\n");
+		if (m->name[0] != '\0')
+			fprintf(f, "name = %s\n", m->name);
+		writer_t w = { f };
+		visit(const_cast<machine_t*>(m), w);
+		return fclose(f) == 0 ? 0 : -1;
+	}
+
+	/** \brief Read a profile written by save(); returns 0 on success, -1 if
+	 * the file cannot be opened. Missing keys keep their value in *m.
+	 */
+	inline static int load(machine_t* m, const char* path) {
+		FILE* f = fopen(path, "r");
+		if (f == NULL)
+			return -1;
+		char line[512];
+		while (fgets(line, sizeof(line), f) != NULL) {
+			line[strcspn(line, "#\n")] = '\0';
+			char* eq = strchr(line, '=');
+			if (eq == NULL)
+				continue;
+			*eq = '\0';
+			char* key = line;
+			char* value = eq + 1;
+			while (*key == ' ' || *key == '\t') key++;
+			for (char* end = eq - 1; end >= key && (*end == ' ' || *end == '\t'); end--) *end = '\0';
+			while (*value == ' ' || *value == '\t') value++;
+			if (strcmp(key, "name") == 0) {
+				snprintf(m->name, sizeof(m->name), "%s", value);
+				continue;
+			}
+			reader_t r = { key, value, 0 };
+			visit(m, r);
+		}
+		fclose(f);
+		return 0;
+	}
+
+	/** \brief Cache sizes as reported by the kernel (or CPUID) when the
+	 * profile has none, i.e. ../cache-hierarchy has not been run.
+	 */
+	inline static void fill_caches(machine_t* m) {
+		if (m->cache_levels > 0)
+			return;
+		cacheinfo::hierarchy_t h;
+		if (cacheinfo::from_sysfs(&h) == 0)
+			cacheinfo::from_cpuid(&h);
+		const int last = cacheinfo::last_level(&h);
+		for (int level = 1; level <= last && level <= PROFILE_MAX_LEVELS; level++) {
+			const cacheinfo::level_t* c = cacheinfo::find_data(&h, level);
+			if (c == NULL)
+				break;
+			m->cache[level - 1].size = c->size;
+			m->cache[level - 1].line = c->line;
+			m->cache[level - 1].ways = c->ways;
+			m->cache[level - 1].shared = c->shared_cpus;
+			m->cache_levels = level;
+		}
+	}
+
+	/** \brief Capacity of a cache level (1-based), 0 if unknown. */
+	inline static size_t cache_bytes(const machine_t* m, int level) {
+		if (level < 1 || level > m->cache_levels)
+			return 0;
+		return m->cache[level - 1].size;
+	}
+
+	/** \brief Per-thread buffer size that stays resident in the given cache
+	 * level when `threads` threads run concurrently. Levels beyond the last
+	 * cache mean DRAM: the buffer is then large enough to overflow the LLC.
+	 * Falls back to `fallback` when the profile does not know the level.
+	 */
+	inline static size_t resident_bytes(const machine_t* m, int level, int threads, size_t fallback) {
+		if (threads < 1)
+			threads = 1;
+		if (level > m->cache_levels) {
+			const size_t llc = cache_bytes(m, m->cache_levels);
+			return llc != 0 ? 8 * llc / size_t(threads) : fallback;
+		}
+		const cache_t* c = (level >= 1) ? &m->cache[level - 1] : NULL;
+		if (c == NULL || c->size == 0)
+			return fallback;
+		/* Threads on CPUs sharing the cache split it; half of the share
+			 leaves room for code, stack and the other data in flight */
+		const int sharers = (c->shared > 1) ? (threads < c->shared ? threads : c->shared) : 1;
+		return c->size / size_t(sharers) / 2;
+	}
+
+}
+
+#endif /* UBENCH_PROFILE_H */
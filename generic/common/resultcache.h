@@ -0,0 +1,199 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* On-disk store of benchmark results keyed by the host fingerprint, so
+	 that a characterisation already run on an identical host (same
+	 fingerprint, same benchmark binary, same configuration) is reused
+	 instead of repeated.
+
+	 Layout under the cache directory ($UBENCH_CACHE):
+		 <fingerprint hash>/fingerprint       the fingerprint text
+		 <fingerprint hash>/<config hash>.txt one result
+
+	 A result file starts with "key = value" lines (config, binary hash,
+	 secs, joules, status), then a "%%" line, then the captured output. A
+	 host whose fingerprint changes hashes to another directory and so never
+	 sees the old results; an entry whose binary hash or configuration text
+	 does not match is stale (the benchmark was rebuilt) and is removed on
+	 lookup. Entries are written to a temporary file and renamed, so hosts
+	 sharing the directory over NFS never read a partial result.
+ */
+
+#ifndef UBENCH_RESULTCACHE_H
+#define UBENCH_RESULTCACHE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "fingerprint.h"
+
+namespace resultcache {
+
+	/* Measurements kept with the output of one run */
+	struct record_t {
+		double secs;
+		/* Negative when energy was not measured */
+		double joules;
+		int status;
+	};
+
+	/** \brief Cache directory: $UBENCH_CACHE, NULL (caching off) if unset. */
+	inline static const char* default_dir() {
+		const char* dir = getenv("UBENCH_CACHE");
+		return (dir != NULL && dir[0] != '\0') ? dir : NULL;
+	}
+
+	inline static void machine_dir(const char* dir, const fingerprint::fingerprint_t* fp, char* path, size_t len) {
+		snprintf(path, len, "%s/%016llx", dir, (unsigned long long) fp->hash);
+	}
+
+	inline static void entry_path(const char* dir, const fingerprint::fingerprint_t* fp, const char* config,
+																char* path, size_t len) {
+		const uint64_t key = fingerprint::fnv1a(config, strlen(config));
+		snprintf(path, len, "%s/%016llx/%016llx.txt", dir, (unsigned long long) fp->hash,
+						 (unsigned long long) key);
+	}
+
+	/* Copy the rest of `from` into a new file at `path` */
+	inline static int copy_rest(FILE* from, const char* path) {
+		FILE* to = fopen(path, "w");
+		if (to == NULL)
+			return -1;
+		char buf[1 << 16];
+		size_t n;
+		int ok = 1;
+		while ((n = fread(buf, 1, sizeof(buf), from)) > 0)
+			ok &= fwrite(buf, 1, n, to) == n;
+		return (fclose(to) == 0 && ok) ? 0 : -1;
+	}
+
+	/** \brief Create the directory of this fingerprint and record its text.
+	 * Returns 0 on success, -1 if the directory cannot be created or already
+	 * holds another fingerprint (a hash collision).
+	 */
+	inline static int prepare(const char* dir, const fingerprint::fingerprint_t* fp) {
+		char path[1024];
+		mkdir(dir, 0755);
+		machine_dir(dir, fp, path, sizeof(path));
+		mkdir(path, 0755);
+		strncat(path, "/fingerprint", sizeof(path) - strlen(path) - 1);
+		FILE* f = fopen(path, "r");
+		if (f != NULL) {
+			char text[FINGERPRINT_MAX_TEXT];
+			const size_t n = fread(text, 1, sizeof(text) - 1, f);
+			text[n] = '\0';
+			fclose(f);
+			return strcmp(text, fp->text) == 0 ? 0 : -1;
+		}
+		f = fopen(path, "w");
+		if (f == NULL)
+			return -1;
+		fputs(fp->text, f);
+		return fclose(f) == 0 ? 0 : -1;
+	}
+
+	/** \brief Look up a result. On a valid hit the captured output is copied
+	 * to `output` and *r is filled in; returns 1. Returns 0 on a miss,
+	 * including a stale entry, which is removed.
+	 */
+	inline static int lookup(const char* dir, const fingerprint::fingerprint_t* fp, const char* config,
+													 uint64_t binary, record_t* r, const char* output) {
+		char path[1024];
+		entry_path(dir, fp, config, path, sizeof(path));
+		FILE* f = fopen(path, "r");
+		if (f == NULL)
+			return 0;
+		char line[4096];
+		int config_ok = 0, binary_ok = 0, body = 0;
+		r->secs = 0.0;
+		r->joules = -1.0;
+		r->status = -1;
+		while (fgets(line, sizeof(line), f) != NULL) {
+			line[strcspn(line, "\n")] = '\0';
+			if (strcmp(line, "%%") == 0) {
+				body = 1;
+				break;
+			}
+			char* eq = strstr(line, " = ");
+			if (eq == NULL)
+				continue;
+			*eq = '\0';
+			const char* value = eq + 3;
+			if (strcmp(line, "config") == 0)
+				config_ok = strcmp(value, config) == 0;
+			else if (strcmp(line, "binary") == 0)
+				binary_ok = strtoull(value, NULL, 16) == binary;
+			else if (strcmp(line, "secs") == 0)
+				r->secs = atof(value);
+			else if (strcmp(line, "joules") == 0)
+				r->joules = atof(value);
+			else if (strcmp(line, "status") == 0)
+				r->status = atoi(value);
+		}
+		if (!body || !config_ok || !binary_ok) {
+			fclose(f);
+			unlink(path);
+			return 0;
+		}
+		const int copied = copy_rest(f, output) == 0;
+		fclose(f);
+		return copied;
+	}
+
+	/** \brief Store the result of a run whose output is in the file
+	 * `output`. Returns 0 on success.
+	 */
+	inline static int store(const char* dir, const fingerprint::fingerprint_t* fp, const char* config,
+													uint64_t binary, const record_t* r, const char* output) {
+		char path[1024], temporary[1100];
+		entry_path(dir, fp, config, path, sizeof(path));
+		snprintf(temporary, sizeof(temporary), "%s.%d.tmp", path, int(getpid()));
+		FILE* from = fopen(output, "r");
+		if (from == NULL)
+			return -1;
+		FILE* to = fopen(temporary, "w");
+		if (to == NULL) {
+			fclose(from);
+			return -1;
+		}
+		fprintf(to, "config = %s\n", config);
+		fprintf(to, "binary = %016llx\n", (unsigned long long) binary);
+		fprintf(to, "secs = %.9g\n", r->secs);
+		fprintf(to, "joules = %.9g\n", r->joules);
+		fprintf(to, "status = %d\n", r->status);
+		fprintf(to, "%%%%\n");
+		char buf[1 << 16];
+		size_t n;
+		int ok = 1;
+		while ((n = fread(buf, 1, sizeof(buf), from)) > 0)
+			ok &= fwrite(buf, 1, n, to) == n;
+		fclose(from);
+		if (fclose(to) != 0 || !ok || rename(temporary, path) != 0) {
+			unlink(temporary);
+			return -1;
+		}
+		return 0;
+	}
+
+}
+
+#endif /* UBENCH_RESULTCACHE_H */
@@ -0,0 +1,245 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Convergence-driven measurement: instead of a fixed number of runs, a
+	 kernel is repeated in short samples until a sliding window of its rate
+	 (and package power, when readable) is stable, or until a time cap.
+
+	 On turbo-enabled parts the first seconds run above the sustainable
+	 frequency and power, and a turbo plateau can be as flat as the
+	 sustained one (PL2 lasts about the PL1 time window, 28 s by default on
+	 Intel). So the run lasts at least a minimum time that covers the
+	 power-limit time window, the sustained phase is the stable run of
+	 windows at the end, and the turbo figures are the first stable
+	 plateau before it. Only step() is timed: power readings and the
+	 convergence test run between samples.
+
+	 A window of W samples is stable when both
+		 spread   (max - min) / mean  <= tolerance
+		 drift    |mean - mean of the previous W samples| / mean <= tolerance
+	 hold for the rate and for the power; the drift test keeps a slow
+	 thermal decline from passing as stable.
+ */
+
+#ifndef UBENCH_STEADY_H
+#define UBENCH_STEADY_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <math.h>
+#include "timer.h"
+#include "powercap.h"
+
+namespace steady {
+
+	#define STEADY_MAX_SAMPLES 65536
+
+	struct options_t {
+		/* Relative tolerance of the spread and drift tests */
+		double tolerance;
+		/* Samples per window */
+		int window;
+		/* Seconds per sample, minimum and cap on the whole run; a
+			 negative minimum is resolved by min_secs() */
+		double sample_secs;
+		double min_secs;
+		double cap_secs;
+	};
+
+	struct sample_t {
+		/* End of the sample, seconds since the start of the run */
+		double end;
+		double rate;
+		/* Package power, negative when RAPL is not readable */
+		double watts;
+	};
+
+	struct result_t {
+		int converged;
+		int samples;
+		/* First sample of the sustained phase, and its start time */
+		int steady_index;
+		double steady_secs;
+		/* Mean over the first stable plateau before the sustained phase
+			 (all samples before it when none is stable; the sustained
+			 figures when there are none) and over the sustained phase */
+		double turbo_rate;
+		double sustained_rate;
+		double turbo_watts;
+		double sustained_watts;
+	};
+
+	inline static void default_options(options_t* o) {
+		o->tolerance = 0.02;
+		o->window = 8;
+		o->sample_secs = 0.25;
+		o->min_secs = -1.0;
+		o->cap_secs = 120.0;
+	}
+
+	/** \brief Minimum run time: o->min_secs, or when negative twice the
+	 * longest RAPL time window (60 s when there is none to read), so that
+	 * a turbo plateau has ended before the run may stop.
+	 */
+	inline static double min_secs(const options_t* o, const char* root = "/sys") {
+		if (o->min_secs >= 0.0)
+			return o->min_secs;
+		const double window = powercap::time_window_secs(root);
+		return window > 0.0 ? 2.0 * window : 60.0;
+	}
+
+	/* Mean of rate (or watts) over samples [first, last) */
+	inline static double mean(const sample_t* s, int first, int last, int watts) {
+		double sum = 0.0;
+		for (int i = first; i < last; i++)
+			sum += watts ? s[i].watts : s[i].rate;
+		return last > first ? sum / double(last - first) : 0.0;
+	}
+
+	inline static int window_stable(const sample_t* s, int first, int window, double tolerance, int watts) {
+		double lo = 0.0, hi = 0.0;
+		for (int i = first; i < first + window; i++) {
+			const double v = watts ? s[i].watts : s[i].rate;
+			if (i == first || v < lo) lo = v;
+			if (i == first || v > hi) hi = v;
+		}
+		const double m = mean(s, first, first + window, watts);
+		if (m <= 0.0)
+			return 0;
+		if ((hi - lo) / m > tolerance)
+			return 0;
+		const double previous = mean(s, first - window, first, watts);
+		return fabs(m - previous) / m <= tolerance;
+	}
+
+	inline static int stable(const sample_t* s, int first, int window, double tolerance) {
+		const int have_watts = s[0].watts >= 0.0;
+		return window_stable(s, first, window, tolerance, 0) &&
+			(!have_watts || window_stable(s, first, window, tolerance, 1));
+	}
+
+	/** \brief Index of the first sample of the stable run that ends the
+	 * samples: every window from it to the last one is stable. -1 if the
+	 * last window is not. Needs two windows of samples.
+	 */
+	inline static int find_steady(const sample_t* s, int count, int window, double tolerance) {
+		int first = count - window;
+		if (first < window || !stable(s, first, window, tolerance))
+			return -1;
+		while (first > window && stable(s, first - 1, window, tolerance))
+			first--;
+		return first;
+	}
+
+	/** \brief First stable plateau among samples [0, end): sets [*first,
+	 * *last) to its samples and returns 1, or returns 0 when none is stable.
+	 */
+	inline static int find_plateau(const sample_t* s, int end, int window, double tolerance,
+																 int* first, int* last) {
+		for (int f = window; f + window <= end; f++) {
+			if (!stable(s, f, window, tolerance))
+				continue;
+			int l = f + window;
+			while (l < end && stable(s, l + 1 - window, window, tolerance))
+				l++;
+			*first = f;
+			*last = l;
+			return 1;
+		}
+		return 0;
+	}
+
+	/** \brief Turbo and sustained figures of a run. Without convergence the
+	 * last window stands in for the sustained figures.
+	 */
+	inline static void analyse(const sample_t* s, int count, const options_t* o, result_t* r) {
+		const int window = count < o->window ? count : o->window;
+		int first = find_steady(s, count, o->window, o->tolerance);
+		r->converged = first >= 0;
+		r->samples = count;
+		if (first < 0)
+			first = count - window;
+		r->steady_index = first;
+		r->steady_secs = first > 0 ? s[first - 1].end : 0.0;
+		int turbo_first = 0, turbo_end = first > 0 ? first : count;
+		if (first > 0)
+			find_plateau(s, first, o->window, o->tolerance, &turbo_first, &turbo_end);
+		r->turbo_rate = mean(s, turbo_first, turbo_end, 0);
+		r->sustained_rate = mean(s, first, count, 0);
+		r->turbo_watts = (count > 0 && s[0].watts >= 0.0) ? mean(s, turbo_first, turbo_end, 1) : -1.0;
+		r->sustained_watts = (count > 0 && s[0].watts >= 0.0) ? mean(s, first, count, 1) : -1.0;
+	}
+
+	/** \brief Repeat `step` until steady or the cap. step() runs the
+	 * kernel for about o->sample_secs and returns the work it did (bytes,
+	 * flops, ...); the rate is work per second. after(i) is called once
+	 * sample i is recorded, outside the timed interval, for readings that
+	 * must not slow the sample down (e.g., the CPU frequency). The run
+	 * stops once min_secs() have passed and the stable run at the end spans
+	 * two windows, so the sustained figure does not rest on the samples that
+	 * decided convergence alone. Returns the sample count. timer::init()
+	 * must have been called.
+	 */
+	template <class Step, class After>
+	inline int run(Step& step, After& after, const options_t* o, sample_t* s, int max_samples,
+								 const char* root = "/sys") {
+		powercap::reading_t before, end;
+		const int have_watts = powercap::read(root, &before) > 0;
+		const double least = min_secs(o, root);
+		const uint64_t start = timer::get_ticks_acquire();
+		int count = 0;
+		while (count < max_samples) {
+			if (have_watts)
+				powercap::read(root, &before);
+			const uint64_t begin = timer::get_ticks_acquire();
+			const double work = step();
+			const uint64_t now = timer::get_ticks_release();
+			const double secs = timer::ticks_to_secs(timer::elapsed_ticks(begin, now));
+			sample_t* x = &s[count++];
+			x->end = timer::ticks_to_secs(timer::elapsed_ticks(start, now));
+			x->rate = work / secs;
+			x->watts = -1.0;
+			if (have_watts && powercap::read(root, &end) > 0)
+				x->watts = powercap::joules(&before, &end) / secs;
+			after(count - 1);
+			if (x->end >= o->cap_secs)
+				break;
+			if (x->end >= least) {
+				const int first = find_steady(s, count, o->window, o->tolerance);
+				if (first >= 0 && count - first >= 2 * o->window)
+					break;
+			}
+		}
+		return count;
+	}
+
+	struct no_after_t {
+		void operator()(int) {}
+	};
+
+	/** \brief run() without a hook between samples. */
+	template <class Step>
+	inline int run(Step& step, const options_t* o, sample_t* s, int max_samples, const char* root = "/sys") {
+		no_after_t after;
+		return run(step, after, o, s, max_samples, root);
+	}
+
+}
+
+#endif /* UBENCH_STEADY_H */
@@ -0,0 +1,276 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Dynamic task scheduling on C++11 atomics: per-thread Chase-Lev
+	 work-stealing deques and, as the baseline, one shared queue.
+
+	 Tasks are non-negative 64-bit ids whose meaning is up to the caller (a
+	 row block, an array chunk). A deque_t is pushed and popped at the bottom
+	 by its owner only; any other thread steals from the top. The
+	 implementation is the weak-memory-model Chase-Lev deque of Le, Pop, Cohen
+	 and Zappa Nardelli (PPoPP 2013) with a fixed power-of-two capacity:
+	 callers size it for the most tasks a thread holds at once.
+
+	 Usage:
+		tasks::init(&pool, threads, capacity);
+		// per epoch, with no thread inside one:
+		tasks::reset(&pool, producers);
+		// each owner pushes its own tasks:
+		tasks::push(&pool.deques[tid], task);
+		// producers that push during the epoch call, after draining their
+		// own deque for the last time:
+		tasks::done_producing(&pool);
+		// every thread:
+		int64_t task;
+		while ((task = tasks::next(&pool, tid, &stats[tid])) != TASKS_EMPTY)
+			run(task);
+
+	 With all tasks pushed before the epoch starts (behind a barrier),
+	 producers is 0.
+
+	 next() pops the owner's deque and, once it is empty, steals from random
+	 victims; it returns TASKS_EMPTY only when no thread can still push and
+	 a sweep over every deque found nothing to steal.
+ */
+
+#ifndef UBENCH_TASKS_H
+#define UBENCH_TASKS_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+#include "barrier.h"
+
+namespace tasks {
+
+	#define TASKS_EMPTY (-1)
+	/* A steal that lost the race for the top task */
+	#define TASKS_ABORT (-2)
+	#define TASKS_LINE_BYTES 128
+
+	struct alignas(TASKS_LINE_BYTES) deque_t {
+		std::atomic<int64_t> top;
+		char top_padding[TASKS_LINE_BYTES - sizeof(std::atomic<int64_t>)];
+		std::atomic<int64_t> bottom;
+		char bottom_padding[TASKS_LINE_BYTES - sizeof(std::atomic<int64_t>)];
+		std::atomic<int64_t>* buffer;
+		int64_t mask;
+	};
+
+	/* Counters of one thread, on its own lines */
+	struct alignas(TASKS_LINE_BYTES) stats_t {
+		int64_t tasks;
+		int64_t steals;
+		/* Steal attempts that found the victim empty or lost the race */
+		int64_t failed;
+		/* Time spent getting tasks, filled in by callers that measure it */
+		uint64_t ticks;
+	};
+
+	/** \brief Allocate a deque holding up to `capacity` tasks (rounded up
+	 * to a power of two). Returns 0, or -1 when out of memory. */
+	inline static int init(deque_t* d, int64_t capacity) {
+		int64_t size = 1;
+		while (size < capacity)
+			size <<= 1;
+		d->buffer = new (std::nothrow) std::atomic<int64_t>[size];
+		if (d->buffer == NULL)
+			return -1;
+		d->mask = size - 1;
+		d->top.store(0, std::memory_order_relaxed);
+		d->bottom.store(0, std::memory_order_relaxed);
+		return 0;
+	}
+
+	inline static void destroy(deque_t* d) {
+		delete[] d->buffer;
+		d->buffer = NULL;
+	}
+
+	/** \brief Owner only: add a task at the bottom; 0 if the deque is full. */
+	inline static int push(deque_t* d, int64_t task) {
+		const int64_t b = d->bottom.load(std::memory_order_relaxed);
+		const int64_t t = d->top.load(std::memory_order_acquire);
+		if (b - t > d->mask)
+			return 0;
+		d->buffer[b & d->mask].store(task, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		d->bottom.store(b + 1, std::memory_order_relaxed);
+		return 1;
+	}
+
+	/** \brief Owner only: take the most recently pushed task, or
+	 * TASKS_EMPTY. */
+	inline static int64_t pop(deque_t* d) {
+		const int64_t b = d->bottom.load(std::memory_order_relaxed) - 1;
+		d->bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = d->top.load(std::memory_order_relaxed);
+		int64_t task = TASKS_EMPTY;
+		if (t <= b) {
+			task = d->buffer[b & d->mask].load(std::memory_order_relaxed);
+			if (t == b) {
+				/* Last task: race the thieves for it */
+				if (!d->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+																						std::memory_order_relaxed))
+					task = TASKS_EMPTY;
+				d->bottom.store(b + 1, std::memory_order_relaxed);
+			}
+		} else {
+			d->bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return task;
+	}
+
+	/** \brief Any thread: take the oldest task; TASKS_EMPTY or TASKS_ABORT. */
+	inline static int64_t steal(deque_t* d) {
+		int64_t t = d->top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64_t b = d->bottom.load(std::memory_order_acquire);
+		if (t >= b)
+			return TASKS_EMPTY;
+		const int64_t task = d->buffer[t & d->mask].load(std::memory_order_relaxed);
+		if (!d->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+																				std::memory_order_relaxed))
+			return TASKS_ABORT;
+		return task;
+	}
+
+	/* ------------------------------------------------------------------- */
+
+	struct pool_t {
+		int threads;
+		deque_t* deques;
+		/* Threads that may still push; thieves give up only at zero */
+		std::atomic<int> producing;
+	};
+
+	/** \brief One deque of `capacity` tasks per thread; `producing` starts
+	 * at `threads`. Returns 0, or -1 when out of memory. */
+	inline static int init(pool_t* p, int threads, int64_t capacity) {
+		p->threads = threads;
+		p->deques = (deque_t*) aligned_alloc(TASKS_LINE_BYTES, threads * sizeof(deque_t));
+		if (p->deques == NULL)
+			return -1;
+		for (int t = 0; t < threads; t++) {
+			new (&p->deques[t].top) std::atomic<int64_t>(0);
+			new (&p->deques[t].bottom) std::atomic<int64_t>(0);
+			if (init(&p->deques[t], capacity) != 0)
+				return -1;
+		}
+		p->producing.store(threads, std::memory_order_relaxed);
+		return 0;
+	}
+
+	inline static void destroy(pool_t* p) {
+		for (int t = 0; t < p->threads; t++)
+			destroy(&p->deques[t]);
+		free(p->deques);
+		p->deques = NULL;
+	}
+
+	/** \brief Before an epoch, with no thread inside one: empty every deque
+	 * and expect `producing` threads to push. */
+	inline static void reset(pool_t* p, int producing) {
+		for (int t = 0; t < p->threads; t++) {
+			p->deques[t].top.store(0, std::memory_order_relaxed);
+			p->deques[t].bottom.store(0, std::memory_order_relaxed);
+		}
+		p->producing.store(producing, std::memory_order_release);
+	}
+
+	/** \brief Called once by a thread that will push no more tasks. */
+	inline static void done_producing(pool_t* p) {
+		p->producing.fetch_sub(1, std::memory_order_acq_rel);
+	}
+
+	/* xorshift64 victim selection, seeded per thread */
+	inline static uint64_t random_next(uint64_t* state) {
+		uint64_t x = *state;
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		return *state = x;
+	}
+
+	/** \brief The next task for thread `tid`: its own deque first, then
+	 * steals; TASKS_EMPTY once all work is done. */
+	inline static int64_t next(pool_t* p, int tid, stats_t* s) {
+		int64_t task = pop(&p->deques[tid]);
+		if (task != TASKS_EMPTY) {
+			s->tasks++;
+			return task;
+		}
+		uint64_t seed = 0x9E3779B97F4A7C15ull * uint64_t(tid + 1) + uint64_t(s->tasks);
+		unsigned spins = 0;
+		for (;;) {
+			/* One sweep from a random victim; a lost race means there was
+				 work, so it does not count towards termination */
+			int contended = 0;
+			const int first = int(random_next(&seed) % uint64_t(p->threads));
+			for (int k = 0; k < p->threads; k++) {
+				const int victim = (first + k) % p->threads;
+				if (victim == tid)
+					continue;
+				task = steal(&p->deques[victim]);
+				if (task >= 0) {
+					s->tasks++;
+					s->steals++;
+					return task;
+				}
+				s->failed++;
+				contended |= task == TASKS_ABORT;
+			}
+			/* Producers drain their own deque before they stop, so once none
+				 is left a clean sweep cannot have missed work */
+			if (!contended && p->producing.load(std::memory_order_acquire) == 0)
+				return TASKS_EMPTY;
+			barrier::backoff(&spins);
+		}
+	}
+
+	/* ------------------------------------------------------------------- */
+
+	/* Baseline: every thread takes the next id from one counter */
+	struct alignas(TASKS_LINE_BYTES) shared_t {
+		std::atomic<int64_t> next;
+		int64_t count;
+	};
+
+	inline static void reset(shared_t* q, int64_t count) {
+		q->next.store(0, std::memory_order_relaxed);
+		q->count = count;
+	}
+
+	/** \brief Tasks 0 .. count-1 in order, then TASKS_EMPTY. */
+	inline static int64_t take(shared_t* q, stats_t* s) {
+		if (q->next.load(std::memory_order_relaxed) >= q->count)
+			return TASKS_EMPTY;
+		const int64_t task = q->next.fetch_add(1, std::memory_order_relaxed);
+		if (task >= q->count)
+			return TASKS_EMPTY;
+		s->tasks++;
+		return task;
+	}
+
+}
+
+#endif /* UBENCH_TASKS_H */
@@ -0,0 +1,173 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Per-thread timelines of barrier-timed runs.
+
+	 Each thread stamps four TSC readings per run into its own 64-byte line
+	 of a buffer (TIMELINE_STRIDE slots per thread, as mytime[] in the Xeon
+	 Phi common.h), so recording never shares a line between threads:
+		TIMELINE_START         before the start barrier
+		TIMELINE_BARRIER_EXIT  leaving the start barrier: the work begins
+		TIMELINE_WORK_END      the work is done: entering the end barrier
+		TIMELINE_END           leaving the end barrier
+	 The runs can be written as a Chrome trace (chrome://tracing, Perfetto)
+	 and summarised as straggler statistics: how the threads' work times
+	 spread and which share of thread time went to waiting in barriers.
+	 The TSC must be synchronised across cores (invariant TSC; see timer.h).
+ */
+
+#ifndef UBENCH_TIMELINE_H
+#define UBENCH_TIMELINE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "timer.h"
+
+namespace timeline {
+
+	#define TIMELINE_STRIDE 8
+	#define TIMELINE_START 0
+	#define TIMELINE_BARRIER_EXIT 1
+	#define TIMELINE_WORK_END 2
+	#define TIMELINE_END 3
+
+	/* Slot of one stamp of thread tid in a run's buffer */
+	#define TIMELINE_SLOT(tid, event) ((tid) * TIMELINE_STRIDE + (event))
+
+	struct stats_t {
+		/* Work time (barrier exit to work end) over the threads, seconds */
+		double max_secs;
+		double median_secs;
+		double min_secs;
+		double mean_secs;
+		int slowest;
+		/* Barrier waits over all thread time from start to end */
+		double wait_share;
+		/* Spread of the threads' start-barrier exits, seconds */
+		double exit_skew_secs;
+	};
+
+	/** \brief Allocate cache-line-aligned, zeroed room for `runs` runs of
+	 * `threads` threads; NULL on failure. Release with free().
+	 */
+	inline static uint64_t* allocate(int runs, int threads) {
+		void* p = NULL;
+		const size_t bytes = sizeof(uint64_t) * TIMELINE_STRIDE * size_t(threads) * size_t(runs);
+		if (posix_memalign(&p, 64, bytes) != 0)
+			return NULL;
+		memset(p, 0, bytes);
+		return (uint64_t*) p;
+	}
+
+	/** \brief The buffer of one run within a buffer of several. */
+	inline static uint64_t* run(uint64_t* buffer, int threads, int index) {
+		return buffer + size_t(index) * TIMELINE_STRIDE * size_t(threads);
+	}
+
+	inline static int compare_doubles(const void* a, const void* b) {
+		const double x = *(const double*) a;
+		const double y = *(const double*) b;
+		return x < y ? -1 : x > y;
+	}
+
+	/** \brief Straggler statistics of one run. */
+	inline static void analyse(const uint64_t* stamps, int threads, stats_t* s) {
+		double* work = (double*) malloc(threads * sizeof(double));
+		double waits = 0.0, total = 0.0, sum = 0.0;
+		uint64_t first_exit = 0, last_exit = 0;
+		s->slowest = 0;
+		for (int t = 0; t < threads; t++) {
+			const uint64_t* p = stamps + TIMELINE_SLOT(t, 0);
+			work[t] = timer::ticks_to_secs(timer::elapsed_ticks(p[TIMELINE_BARRIER_EXIT], p[TIMELINE_WORK_END]));
+			waits += timer::ticks_to_secs(timer::elapsed_ticks(p[TIMELINE_START], p[TIMELINE_BARRIER_EXIT])) +
+				timer::ticks_to_secs(timer::elapsed_ticks(p[TIMELINE_WORK_END], p[TIMELINE_END]));
+			total += timer::ticks_to_secs(timer::elapsed_ticks(p[TIMELINE_START], p[TIMELINE_END]));
+			sum += work[t];
+			if (work[t] > work[s->slowest])
+				s->slowest = t;
+			if (t == 0 || p[TIMELINE_BARRIER_EXIT] < first_exit)
+				first_exit = p[TIMELINE_BARRIER_EXIT];
+			if (t == 0 || p[TIMELINE_BARRIER_EXIT] > last_exit)
+				last_exit = p[TIMELINE_BARRIER_EXIT];
+		}
+		s->max_secs = work[s->slowest];
+		s->mean_secs = sum / threads;
+		qsort(work, threads, sizeof(double), compare_doubles);
+		s->min_secs = work[0];
+		s->median_secs = threads % 2 == 1 ? work[threads / 2] : 0.5 * (work[threads / 2 - 1] + work[threads / 2]);
+		s->wait_share = total > 0.0 ? waits / total : 0.0;
+		s->exit_skew_secs = timer::ticks_to_secs(last_exit - first_exit);
+		free(work);
+	}
+
+	/** \brief Print the statistics of one run on one line of stderr. */
+	inline static void report(const char* label, const stats_t* s) {
+		fprintf(stderr, "Stragglers (%s): work max %.3lf ms (thread %d), median %.3lf ms, min %.3lf ms, "
+						"max/median %.3lf; barrier wait %.1lf%% of thread time; start skew %.1lf us\n",
+						label, s->max_secs * 1.0e+3, s->slowest, s->median_secs * 1.0e+3, s->min_secs * 1.0e+3,
+						s->median_secs > 0.0 ? s->max_secs / s->median_secs : 0.0, 100.0 * s->wait_share,
+						s->exit_skew_secs * 1.0e+6);
+	}
+
+	/* One complete ("X") event, microseconds from the origin */
+	inline static void write_event(FILE* f, int* first, const char* name, int tid, int index,
+																 uint64_t origin, uint64_t begin, uint64_t end) {
+		fprintf(f, "%s\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %d, \"ts\": %.3lf, "
+						"\"dur\": %.3lf, \"args\": {\"run\": %d}}",
+						*first ? "" : ",", name, tid, timer::ticks_to_secs(begin - origin) * 1.0e+6,
+						timer::ticks_to_secs(timer::elapsed_ticks(begin, end)) * 1.0e+6, index);
+		*first = 0;
+	}
+
+	/** \brief Write `runs` runs as a Chrome trace: per thread, a start
+	 * barrier, a work and an end barrier event for every run. Returns 0 on
+	 * success.
+	 */
+	inline static int write_chrome(const char* path, const char* name, const uint64_t* stamps,
+																 int runs, int threads) {
+		FILE* f = fopen(path, "w");
+		if (f == NULL)
+			return -1;
+		uint64_t origin = stamps[TIMELINE_SLOT(0, TIMELINE_START)];
+		for (int r = 0; r < runs; r++) {
+			for (int t = 0; t < threads; t++) {
+				const uint64_t start = stamps[size_t(r) * TIMELINE_STRIDE * threads + TIMELINE_SLOT(t, TIMELINE_START)];
+				if (start < origin)
+					origin = start;
+			}
+		}
+		fprintf(f, "{\"displayTimeUnit\": \"ns\", \"otherData\": {\"benchmark\": \"%s\", \"threads\": %d, \"runs\": %d},\n"
+						"\"traceEvents\": [", name, threads, runs);
+		int first = 1;
+		for (int r = 0; r < runs; r++) {
+			for (int t = 0; t < threads; t++) {
+				const uint64_t* p = stamps + size_t(r) * TIMELINE_STRIDE * threads + TIMELINE_SLOT(t, 0);
+				write_event(f, &first, "start barrier", t, r, origin, p[TIMELINE_START], p[TIMELINE_BARRIER_EXIT]);
+				write_event(f, &first, "work", t, r, origin, p[TIMELINE_BARRIER_EXIT], p[TIMELINE_WORK_END]);
+				write_event(f, &first, "end barrier", t, r, origin, p[TIMELINE_WORK_END], p[TIMELINE_END]);
+			}
+		}
+		fprintf(f, "\n]}\n");
+		return fclose(f) == 0 ? 0 : -1;
+	}
+}
+
+#endif
@@ -0,0 +1,366 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Header-only timing library shared by all CPU and OpenCL benchmarks.
+
+	 On x86-64 the time base is the TSC, read with fenced rdtsc/rdtscp so that
+	 the kernel under test can neither start before the first read nor retire
+	 after the second. The TSC frequency is calibrated against
+	 CLOCK_MONOTONIC_RAW in timer::init(), and the TSC is only used when the
+	 processor reports it as invariant (CPUID 0x80000007 EDX[8]); otherwise,
+	 and on platforms without a user-readable counter, ticks are nanoseconds
+	 from clock_gettime(CLOCK_MONOTONIC_RAW). On AArch64 the generic timer
+	 (CNTVCT_EL0) is used with its architected frequency.
+
+	 Usage:
+		timer::init ();
+		const uint64_t start = timer::get_ticks_acquire ();
+		kernel (...);
+		const uint64_t end = timer::get_ticks_release ();
+		const uint64_t ticks = timer::elapsed_ticks (start, end);
+		timer::report (stderr, "Execution time", ticks);
+
+	 elapsed_ticks() subtracts the measured cost of one acquire/release pair,
+	 so very short regions are not biased by the timer itself.
+ */
+
+#ifndef UBENCH_TIMER_H
+#define UBENCH_TIMER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include "cpuid.h"
+
+#ifndef CLOCK_MONOTONIC_RAW
+	#define CLOCK_MONOTONIC_RAW CLOCK_MONOTONIC
+#endif
+
+namespace timer {
+
+	enum source_t {
+		SOURCE_CLOCK = 0,  /* clock_gettime(CLOCK_MONOTONIC_RAW), 1 tick = 1 ns */
+		SOURCE_TSC,        /* invariant x86 time-stamp counter */
+		SOURCE_CNTVCT      /* ARMv8 generic timer */
+	};
+
+	struct state_t {
+		int initialized;
+		source_t source;
+		double ticks_per_sec;
+		/* Ticks consumed by a back-to-back acquire/release pair */
+		uint64_t overhead;
+	};
+
+	inline state_t& state() {
+		static state_t s = { 0, SOURCE_CLOCK, 1.0e+9, 0 };
+		return s;
+	}
+
+	inline static uint64_t get_nsecs() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+		return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+	}
+
+#if defined(__x86_64__) || defined(__i386__)
+	/* Invariant TSC: runs at a constant rate in all P-, C- and T-states */
+	inline static int has_invariant_tsc() {
+		uint32_t regs[4];
+		if (cpu::max_extended_leaf() < 0x80000007u)
+			return 0;
+		cpu::cpuid(0x80000007u, 0, regs);
+		return (regs[3] >> 8) & 1;
+	}
+
+	#if defined(__MIC__)
+	/* KNC has neither lfence nor rdtscp, so fall back to cpuid serialisation */
+	inline static uint64_t read_tsc_acquire() {
+		uint32_t low, high;
+		__asm__ __volatile__ (
+			"xor %%eax, %%eax;"
+			"cpuid;"
+			"rdtsc;"
+		: "=a"(low), "=d"(high)
+		:
+		: "%rbx", "%rcx"
+		);
+		return (uint64_t(high) << 32) | uint64_t(low);
+	}
+
+	inline static uint64_t read_tsc_release() {
+		return read_tsc_acquire();
+	}
+	#else
+	/* lfence before rdtsc waits for earlier instructions to complete, the one
+		 after keeps the timed code from starting before the read */
+	inline static uint64_t read_tsc_acquire() {
+		uint32_t low, high;
+		__asm__ __volatile__ (
+			"lfence;"
+			"rdtsc;"
+			"lfence;"
+		: "=a"(low), "=d"(high)
+		:
+		: "memory"
+		);
+		return (uint64_t(high) << 32) | uint64_t(low);
+	}
+
+	/* rdtscp waits for the timed code to retire, lfence keeps later code
+		 from being hoisted above the read */
+	inline static uint64_t read_tsc_release() {
+		uint32_t low, high;
+		__asm__ __volatile__ (
+			"rdtscp;"
+			"lfence;"
+		: "=a"(low), "=d"(high)
+		:
+		: "%rcx", "memory"
+		);
+		return (uint64_t(high) << 32) | uint64_t(low);
+	}
+	#endif
+#endif
+
+#if defined(__aarch64__)
+	inline static uint64_t read_cntvct() {
+		uint64_t ticks;
+		__asm__ __volatile__ (
+			"isb;"
+			"mrs %0, cntvct_el0;"
+		: "=r"(ticks)
+		:
+		: "memory"
+		);
+		return ticks;
+	}
+
+	inline static uint64_t read_cntfrq() {
+		uint64_t freq;
+		__asm__ __volatile__ ("mrs %0, cntfrq_el0;" : "=r"(freq));
+		return freq;
+	}
+#endif
+
+	/** \brief Read the time base at the start of a timed region. */
+	inline static uint64_t get_ticks_acquire() {
+		#if defined(__x86_64__) || defined(__i386__)
+			if (state().source == SOURCE_TSC)
+				return read_tsc_acquire();
+		#elif defined(__aarch64__)
+			if (state().source == SOURCE_CNTVCT)
+				return read_cntvct();
+		#endif
+		return get_nsecs();
+	}
+
+	/** \brief Read the time base at the end of a timed region. */
+	inline static uint64_t get_ticks_release() {
+		#if defined(__x86_64__) || defined(__i386__)
+			if (state().source == SOURCE_TSC)
+				return read_tsc_release();
+		#elif defined(__aarch64__)
+			if (state().source == SOURCE_CNTVCT)
+				return read_cntvct();
+		#endif
+		return get_nsecs();
+	}
+
+	/* Minimum cost of an acquire/release pair over many trials */
+	inline static uint64_t measure_overhead() {
+		uint64_t best = ~0ull;
+		for (int i = 0; i < 1000; i++) {
+			const uint64_t start = get_ticks_acquire();
+			const uint64_t end = get_ticks_release();
+			if (end - start < best)
+				best = end - start;
+		}
+		return best;
+	}
+
+	/* Count TSC ticks across a busy-waited CLOCK_MONOTONIC_RAW interval; the
+		 median of several short windows filters out preemption */
+	inline static double calibrate_tsc() {
+		#if defined(__x86_64__) || defined(__i386__)
+			double rate[5];
+			for (int i = 0; i < 5; i++) {
+				const uint64_t ns_start = get_nsecs();
+				const uint64_t tsc_start = read_tsc_acquire();
+				uint64_t ns_end;
+				do {
+					ns_end = get_nsecs();
+				} while (ns_end - ns_start < 20000000ull);
+				const uint64_t tsc_end = read_tsc_release();
+				rate[i] = double(tsc_end - tsc_start) * 1.0e+9 / double(ns_end - ns_start);
+			}
+			for (int i = 1; i < 5; i++) {
+				for (int j = i; j > 0 && rate[j] < rate[j - 1]; j--) {
+					const double tmp = rate[j];
+					rate[j] = rate[j - 1];
+					rate[j - 1] = tmp;
+				}
+			}
+			return rate[2];
+		#else
+			return 1.0e+9;
+		#endif
+	}
+
+	/** \brief Select the time base, calibrate it and measure read overhead.
+	 * Call ONCE per application run, before any timed region.
+	 * Setting UBENCH_TIMER=clock in the environment forces the
+	 * clock_gettime fallback.
+	 */
+	inline void init(int verbose = 1) {
+		state_t& s = state();
+		if (s.initialized)
+			return;
+		const char* forced = getenv("UBENCH_TIMER");
+		const int force_clock = (forced != NULL) && (strcmp(forced, "clock") == 0);
+
+		s.source = SOURCE_CLOCK;
+		s.ticks_per_sec = 1.0e+9;
+		#if defined(__x86_64__) || defined(__i386__)
+			if (!force_clock && has_invariant_tsc()) {
+				s.source = SOURCE_TSC;
+				s.ticks_per_sec = calibrate_tsc();
+			}
+		#elif defined(__aarch64__)
+			if (!force_clock) {
+				s.source = SOURCE_CNTVCT;
+				s.ticks_per_sec = double(read_cntfrq());
+			}
+		#endif
+		s.overhead = measure_overhead();
+		s.initialized = 1;
+
+		if (verbose) {
+			static const char* names[] = {
+				"clock_gettime(CLOCK_MONOTONIC_RAW)", "invariant TSC", "CNTVCT_EL0"
+			};
+			fprintf(stderr, "Timer: %s, %.6lf GHz, overhead %llu ticks\n",
+							names[s.source], s.ticks_per_sec / 1.0e+9,
+							(unsigned long long) s.overhead);
+			#if defined(__x86_64__) || defined(__i386__)
+				if (s.source == SOURCE_CLOCK && !force_clock)
+					fprintf(stderr, "Timer: TSC is not invariant, using clock_gettime\n");
+			#endif
+		}
+	}
+
+	/** \brief Ticks per second of the selected time base. */
+	inline static double ticks_per_sec() {
+		assert(state().initialized);
+		return state().ticks_per_sec;
+	}
+
+	/** \brief Ticks between two reads, less the cost of the reads. */
+	inline static uint64_t elapsed_ticks(uint64_t start, uint64_t end) {
+		const uint64_t ticks = end - start;
+		const uint64_t overhead = state().overhead;
+		return ticks > overhead ? ticks - overhead : 0;
+	}
+
+	/** \brief Convert a tick count to seconds. */
+	inline static double ticks_to_secs(uint64_t ticks) {
+		return double(ticks) / ticks_per_sec();
+	}
+
+	/** \brief Print "<label>: <secs> secs (<ticks> cycles)". Cycles are
+	 * reference (time-base) cycles, not core clock cycles.
+	 */
+	inline static void report(FILE* stream, const char* label, uint64_t ticks) {
+		fprintf(stream, "%s: %.9lf secs (%llu cycles)\n", label,
+						ticks_to_secs(ticks), (unsigned long long) ticks);
+	}
+
+}
+
+/* ======================================================== */
+/* Stopwatch interface, kept for the OpenCL drivers */
+
+struct stopwatch_t
+{
+	uint64_t t_start_;
+	uint64_t t_stop_;
+	int is_running_;
+};
+
+/** \brief Initialize timing library. Call ONCE per application run. */
+inline static void stopwatch_init (void)
+{
+	timer::init ();
+	fprintf (stderr, "Timer resolution: %Lg\n",
+					 (long double) 1.0 / timer::ticks_per_sec ());
+	fflush (stderr);
+}
+
+/** \brief Creates a 'stopwatch'. */
+inline static struct stopwatch_t* stopwatch_create (void)
+{
+	struct stopwatch_t* new_timer =
+		(struct stopwatch_t *) malloc (sizeof (struct stopwatch_t));
+	if (new_timer)
+		memset (new_timer, 0, sizeof (struct stopwatch_t));
+	return new_timer;
+}
+
+/** \brief Turn stopwatch on. */
+inline static void stopwatch_start (struct stopwatch_t* T)
+{
+	assert (T);
+	T->is_running_ = 1;
+	T->t_start_ = timer::get_ticks_acquire ();
+}
+
+/** \brief If on, return elapsed time since last call to stopwatch_start();
+ * otherwise, return elapsed time at last call to stopwatch_stop().
+ */
+inline static long double stopwatch_elapsed (struct stopwatch_t* T)
+{
+	if (!T)
+		return 0;
+	const uint64_t t_end = T->is_running_ ? timer::get_ticks_release () : T->t_stop_;
+	return timer::ticks_to_secs (timer::elapsed_ticks (T->t_start_, t_end));
+}
+
+/** \brief Turn stopwatch off and return elapsed time, in seconds. */
+inline static long double stopwatch_stop (struct stopwatch_t* T)
+{
+	if (T && T->is_running_) {
+		T->t_stop_ = timer::get_ticks_release ();
+		T->is_running_ = 0;
+	}
+	return stopwatch_elapsed (T);
+}
+
+/** \brief Destroy a 'stopwatch'. */
+inline static void stopwatch_destroy (struct stopwatch_t* T)
+{
+	if (T) {
+		stopwatch_stop (T);
+		free (T);
+	}
+}
+
+#endif /* UBENCH_TIMER_H */
@@ -0,0 +1,69 @@
+#!/bin/sh
+# Runs dvfs-sweep against a fake sysfs tree (no root needed) and checks that
+# every CPU's governor and limits are written back after a complete sweep
+# and after SIGINT in the middle of one. Usage: ./fake-sysfs-test.sh
+# (after make), or make check.
+
+SWEEP=${SWEEP:-./dvfs-sweep}
+ROOT=$(mktemp -d)
+trap 'rm -rf "$ROOT"' EXIT
+unset UBENCH_CACHE
+failures=0
+
+# Two CPUs on the powersave governor, 0.8-3.0 GHz, and one RAPL zone
+make_tree() {
+	for cpu in 0 1; do
+		dir="$ROOT/devices/system/cpu/cpu$cpu/cpufreq"
+		mkdir -p "$dir"
+		echo powersave > "$dir/scaling_governor"
+		echo "performance powersave" > "$dir/scaling_available_governors"
+		echo 800000 > "$dir/scaling_min_freq"
+		echo 3000000 > "$dir/scaling_max_freq"
+		echo 1000000 > "$dir/cpuinfo_min_freq"
+		echo 3000000 > "$dir/cpuinfo_max_freq"
+	done
+	mkdir -p "$ROOT/class/powercap/intel-rapl:0"
+	echo 0 > "$ROOT/class/powercap/intel-rapl:0/energy_uj"
+	echo 262143328850 > "$ROOT/class/powercap/intel-rapl:0/max_energy_range_uj"
+}
+
+check() {
+	if [ "$2" = "$3" ]; then
+		echo "ok: $1"
+	else
+		echo "FAILED: $1: expected '$3', got '$2'"
+		failures=$((failures + 1))
+	fi
+}
+
+check_restored() {
+	for cpu in 0 1; do
+		dir="$ROOT/devices/system/cpu/cpu$cpu/cpufreq"
+		check "$1: cpu$cpu governor" "$(cat "$dir/scaling_governor")" powersave
+		check "$1: cpu$cpu min" "$(cat "$dir/scaling_min_freq")" 800000
+		check "$1: cpu$cpu max" "$(cat "$dir/scaling_max_freq")" 3000000
+	done
+}
+
+# A complete sweep of three frequencies
+make_tree
+"$SWEEP" -r "$ROOT" -n 3 -o "$ROOT/out" true > "$ROOT/complete.txt"
+check "complete sweep: rows" "$(grep -c ok "$ROOT/complete.txt")" 3
+check_restored "complete sweep"
+
+# SIGINT to the whole process group, as Ctrl-C sends it, during the first point
+make_tree
+setsid "$SWEEP" -r "$ROOT" -n 3 -o "$ROOT/out" "sleep 2" > "$ROOT/interrupted.txt" &
+pid=$!
+sleep 1
+check "during the sweep: cpu0 governor" \
+	"$(cat "$ROOT/devices/system/cpu/cpu0/cpufreq/scaling_governor")" performance
+kill -INT -- -"$pid" 2> /dev/null || kill -INT "$pid"
+wait "$pid"
+status=$?
+check "interrupted sweep: killed by SIGINT" "$status" 130
+check "interrupted sweep: rows" "$(grep -c -E 'ok|interrupted|FAILED' "$ROOT/interrupted.txt")" 1
+check_restored "interrupted sweep"
+
+[ "$failures" -eq 0 ] && echo "All checks passed" || echo "$failures checks FAILED"
+exit "$failures"
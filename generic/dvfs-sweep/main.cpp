@@ -0,0 +1,387 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "timer.h"
+#include "cpufreq.h"
+#include "powercap.h"
+#include "fingerprint.h"
+#include "resultcache.h"
+
+#define MAX_CPUS 1024
+#define MAX_COMMANDS 16
+
+/* Benchmarks run at every operating point when none are given */
+static const char* default_commands[] = {
+	"../intensity/intensity double",
+	"../random-and-cache/ubench-x64-sequential"
+};
+
+/* Settings restored on exit, including exit by signal */
+static const char* g_root = "/sys";
+static cpufreq::policy_t g_saved[MAX_CPUS];
+static int g_saved_count = 0;
+static cpufreq::uncore_t g_uncore[CPUFREQ_MAX_UNCORE];
+static int g_uncore_count = 0;
+/* SIGINT or SIGTERM received; the main loop restores and exits */
+static volatile sig_atomic_t g_signal = 0;
+
+struct options_t {
+	const char* root;
+	const char* cpu_list;
+	const char* output;
+	unsigned long core_khz[CPUFREQ_MAX_FREQUENCIES];
+	int core_count;
+	unsigned long uncore_khz[CPUFREQ_MAX_FREQUENCIES];
+	int uncore_count;
+	int steps;
+	const char* commands[MAX_COMMANDS];
+	int command_count;
+	/* Result cache (NULL: off) and the hash of each command's binary */
+	const char* cache;
+	int print_fingerprint;
+	fingerprint::fingerprint_t fp;
+	uint64_t binary[MAX_COMMANDS];
+	int cacheable[MAX_COMMANDS];
+};
+
+/* =================================================================== */
+/* Parse program input */
+int parse_khz_list(const char* text, unsigned long* khz, int max)
+{
+	int count = 0;
+	char* copy = strdup(text);
+	for (char* t = strtok(copy, ","); t != NULL && count < max; t = strtok(NULL, ","))
+		khz[count++] = strtoul(t, NULL, 10);
+	free(copy);
+	return count;
+}
+
+void usage(int argc, char** argv, options_t* o)
+{
+	memset(o, 0, sizeof(*o));
+	o->root = "/sys";
+	o->output = "dvfs-results";
+	o->steps = 5;
+	o->cache = resultcache::default_dir();
+	int c;
+	while ((c = getopt(argc, argv, "r:c:f:u:n:o:C:Fh")) != -1) {
+		switch (c) {
+			case 'r': o->root = optarg; break;
+			case 'c': o->cpu_list = optarg; break;
+			case 'f': o->core_count = parse_khz_list(optarg, o->core_khz, CPUFREQ_MAX_FREQUENCIES); break;
+			case 'u': o->uncore_count = parse_khz_list(optarg, o->uncore_khz, CPUFREQ_MAX_FREQUENCIES); break;
+			case 'n': o->steps = atoi(optarg); break;
+			case 'o': o->output = optarg; break;
+			case 'C': o->cache = optarg; break;
+			case 'F': o->print_fingerprint = 1; break;
+			default:
+				fprintf(stderr,
+								"usage: %s [-r sysfs root] [-c cpu list] [-f kHz,kHz,...] [-n steps]\n"
+								"          [-u uncore kHz,kHz,...] [-o output dir] [-C cache dir] [-F]\n"
+								"          [\"command\" ...]\n", argv[0]);
+				exit(c != 'h');
+		}
+	}
+	for (int i = optind; i < argc && o->command_count < MAX_COMMANDS; i++)
+		o->commands[o->command_count++] = argv[i];
+	if (o->command_count == 0) {
+		for (size_t i = 0; i < sizeof(default_commands) / sizeof(default_commands[0]); i++)
+			o->commands[o->command_count++] = default_commands[i];
+	}
+}
+
+/* "0,2,4-7" -> cpus; without a list, every CPU that has cpufreq */
+int select_cpus(const char* root, const char* list, int* cpus, int max)
+{
+	int count = 0;
+	if (list == NULL) {
+		for (int cpu = 0; cpu < MAX_CPUS && count < max; cpu++) {
+			if (cpufreq::available(root, cpu))
+				cpus[count++] = cpu;
+		}
+		return count;
+	}
+	const char* p = list;
+	while (*p != '\0' && count < max) {
+		char* end;
+		const int first = (int) strtol(p, &end, 10);
+		int last = first;
+		if (end == p) break;
+		if (*end == '-')
+			last = (int) strtol(end + 1, &end, 10);
+		for (int cpu = first; cpu <= last && count < max; cpu++)
+			cpus[count++] = cpu;
+		p = (*end == ',') ? end + 1 : end;
+	}
+	return count;
+}
+/* =================================================================== */
+
+
+/* =================================================================== */
+/* Put every saved setting back */
+void restore_all()
+{
+	int failed = 0;
+	for (int i = 0; i < g_saved_count; i++)
+		failed |= cpufreq::restore(g_root, &g_saved[i]) != 0;
+	for (int i = 0; i < g_uncore_count; i++)
+		failed |= cpufreq::uncore_restore(g_root, &g_uncore[i]) != 0;
+	if (failed)
+		fprintf(stderr, "Warning: some frequency settings could not be restored\n");
+	g_saved_count = 0;
+	g_uncore_count = 0;
+}
+
+/* Only note the signal: restoring uses stdio, which is not
+	 async-signal-safe */
+void note_signal(int sig)
+{
+	g_signal = sig;
+}
+
+/* Restore and die of the noted signal, so the caller sees how we ended */
+void exit_on_signal()
+{
+	if (g_signal == 0)
+		return;
+	const int sig = g_signal;
+	fprintf(stderr, "Interrupted; restoring frequency settings\n");
+	restore_all();
+	signal(sig, SIG_DFL);
+	raise(sig);
+}
+/* =================================================================== */
+
+
+/* =================================================================== */
+/* Output file and cache key of one run */
+void output_file(const options_t* o, int index, unsigned long core_khz, unsigned long uncore_khz,
+								 char* file, size_t len)
+{
+	snprintf(file, len, "%s/%d-%lu-%lu.txt", o->output, index, core_khz, uncore_khz);
+}
+
+void cache_config(const options_t* o, int index, unsigned long core_khz, unsigned long uncore_khz,
+									char* config, size_t len)
+{
+	snprintf(config, len, "dvfs-sweep; %s; cpus %s; core %lu kHz; uncore %lu kHz", o->commands[index],
+					 o->cpu_list != NULL ? o->cpu_list : "all", core_khz, uncore_khz);
+}
+
+void print_row(int index, unsigned long core_khz, unsigned long uncore_khz,
+							 const resultcache::record_t* r, const char* status)
+{
+	printf("%d" "\t" "%lu" "\t" "%lu" "\t" "%4.06lf", index, core_khz, uncore_khz, r->secs);
+	if (r->joules >= 0.0)
+		printf("\t" "%4.03lf" "\t" "%4.03lf", r->joules, r->joules / r->secs);
+	else
+		printf("\t" "n/a" "\t" "n/a");
+	printf("\t" "%s" "\n", status);
+	fflush(stdout);
+}
+
+/* Reuse a cached run: copy its output and print its row. Returns 1 on a
+	 hit, 0 when the command has to run. */
+int reuse(const options_t* o, int index, unsigned long core_khz, unsigned long uncore_khz)
+{
+	if (o->cache == NULL || !o->cacheable[index])
+		return 0;
+	char file[512], config[4096];
+	output_file(o, index, core_khz, uncore_khz, file, sizeof(file));
+	cache_config(o, index, core_khz, uncore_khz, config, sizeof(config));
+	resultcache::record_t r;
+	if (!resultcache::lookup(o->cache, &o->fp, config, o->binary[index], &r, file))
+		return 0;
+	print_row(index, core_khz, uncore_khz, &r, "cached");
+	return 1;
+}
+
+/* Run a shell command with stdout in a file and return its wait status.
+	 Unlike system(), SIGINT and SIGTERM stay live in the driver: they are
+	 passed on to the command and noted in g_signal. */
+int shell(const char* command, const char* file)
+{
+	const pid_t pid = fork();
+	if (pid < 0)
+		return -1;
+	if (pid == 0) {
+		signal(SIGINT, SIG_DFL);
+		signal(SIGTERM, SIG_DFL);
+		const int fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0 || dup2(fd, STDOUT_FILENO) < 0)
+			_exit(127);
+		close(fd);
+		execl("/bin/sh", "sh", "-c", command, (char*) NULL);
+		_exit(127);
+	}
+	int status;
+	int forwarded = 0;
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR)
+			return -1;
+		if (g_signal != 0 && !forwarded) {
+			kill(pid, g_signal);
+			forwarded = 1;
+		}
+	}
+	return status;
+}
+
+/* Run one command with its output in a file; time and energy it */
+void run(const options_t* o, int index, unsigned long core_khz, unsigned long uncore_khz)
+{
+	char file[512];
+	output_file(o, index, core_khz, uncore_khz, file, sizeof(file));
+
+	powercap::reading_t before, after;
+	const int zones = powercap::read(o->root, &before);
+	const uint64_t start = timer::get_ticks_acquire();
+	const int status = shell(o->commands[index], file);
+	const uint64_t end = timer::get_ticks_release();
+	powercap::read(o->root, &after);
+
+	resultcache::record_t r;
+	r.secs = timer::ticks_to_secs(timer::elapsed_ticks(start, end));
+	r.joules = zones > 0 ? powercap::joules(&before, &after) : -1.0;
+	r.status = status;
+	print_row(index, core_khz, uncore_khz, &r, status == 0 ? "ok" : g_signal != 0 ? "interrupted" : "FAILED");
+
+	/* Only complete runs are worth reusing */
+	if (o->cache != NULL && o->cacheable[index] && status == 0) {
+		char config[4096];
+		cache_config(o, index, core_khz, uncore_khz, config, sizeof(config));
+		if (resultcache::store(o->cache, &o->fp, config, o->binary[index], &r, file) != 0)
+			fprintf(stderr, "Warning: cannot cache the result of benchmark %d\n", index);
+	}
+}
+/* =================================================================== */
+
+
+int main(int argc, char** argv)
+{
+	options_t o;
+	usage(argc, argv, &o);
+	g_root = o.root;
+
+	fingerprint::build(&o.fp);
+	if (o.print_fingerprint) {
+		printf("%s" "hash = %016llx\n", o.fp.text, (unsigned long long) o.fp.hash);
+		return 0;
+	}
+	if (o.cache != NULL && resultcache::prepare(o.cache, &o.fp) != 0) {
+		fprintf(stderr, "Warning: cannot use result cache %s; caching off\n", o.cache);
+		o.cache = NULL;
+	}
+	/* Results are only reused for the same build of each benchmark */
+	for (int i = 0; i < o.command_count && o.cache != NULL; i++) {
+		char binary[1024];
+		o.cacheable[i] = fingerprint::command_binary(o.commands[i], binary, sizeof(binary)) == 0 &&
+			fingerprint::hash_file(binary, &o.binary[i]) == 0;
+		if (!o.cacheable[i])
+			fprintf(stderr, "Warning: cannot hash the binary of benchmark %d; not cached\n", i);
+	}
+
+	int* cpus = (int*) malloc(MAX_CPUS * sizeof(int));
+	const int cpu_count = select_cpus(o.root, o.cpu_list, cpus, MAX_CPUS);
+	if (cpu_count == 0) {
+		fprintf(stderr, "No cpufreq CPUs under %s/devices/system/cpu\n", o.root);
+		return 1;
+	}
+	if (o.core_count == 0)
+		o.core_count = cpufreq::frequencies(o.root, cpus[0], o.core_khz,
+																				 CPUFREQ_MAX_FREQUENCIES, o.steps);
+	if (o.core_count == 0) {
+		fprintf(stderr, "No frequencies listed for CPU %d\n", cpus[0]);
+		return 1;
+	}
+
+	/* Save before touching anything; restore on any exit path */
+	for (int i = 0; i < cpu_count; i++) {
+		if (cpufreq::save(o.root, cpus[i], &g_saved[g_saved_count]) == 0)
+			g_saved_count++;
+		else
+			fprintf(stderr, "Warning: cannot read cpufreq settings of CPU %d\n", cpus[i]);
+	}
+	if (o.uncore_count > 0) {
+		g_uncore_count = cpufreq::uncore_save(o.root, g_uncore, CPUFREQ_MAX_UNCORE);
+		if (g_uncore_count == 0)
+			fprintf(stderr, "Warning: no intel_uncore_frequency domains; uncore not swept\n");
+	}
+	atexit(restore_all);
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = note_signal;
+	sigemptyset(&action.sa_mask);
+	/* No SA_RESTART: waitpid returns on the signal so it can be passed on */
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	mkdir(o.output, 0755);
+	timer::init();
+
+	for (int i = 0; i < o.command_count; i++)
+		fprintf(stderr, "Benchmark %d: %s\n", i, o.commands[i]);
+	if (o.cache != NULL)
+		fprintf(stderr, "Result cache: %s/%016llx\n", o.cache, (unsigned long long) o.fp.hash);
+	printf("Benchmark" "\t" "Core kHz" "\t" "Uncore kHz" "\t" "Secs" "\t" "Joules" "\t"
+				 "Watts" "\t" "Status" "\n");
+	fflush(stdout);
+
+	const int uncore_points = g_uncore_count > 0 ? o.uncore_count : 1;
+	for (int u = 0; u < uncore_points; u++) {
+		const unsigned long uncore_khz = g_uncore_count > 0 ? o.uncore_khz[u] : 0;
+		for (int d = 0; d < g_uncore_count; d++) {
+			if (cpufreq::uncore_write(o.root, g_uncore[d].name, uncore_khz, uncore_khz) != 0)
+				fprintf(stderr, "Warning: cannot set uncore %s to %lu kHz\n", g_uncore[d].name, uncore_khz);
+		}
+		for (int f = 0; f < o.core_count; f++) {
+			exit_on_signal();
+			/* Cached runs first; the frequency is only set when one is missing */
+			int missing[MAX_COMMANDS], missing_count = 0;
+			for (int c = 0; c < o.command_count; c++) {
+				if (!reuse(&o, c, o.core_khz[f], uncore_khz))
+					missing[missing_count++] = c;
+			}
+			if (missing_count == 0)
+				continue;
+			for (int i = 0; i < g_saved_count; i++) {
+				if (cpufreq::pin(o.root, g_saved[i].cpu, o.core_khz[f]) != 0)
+					fprintf(stderr, "Warning: cannot set CPU %d to %lu kHz\n", g_saved[i].cpu, o.core_khz[f]);
+			}
+			for (int c = 0; c < missing_count; c++) {
+				run(&o, missing[c], o.core_khz[f], uncore_khz);
+				exit_on_signal();
+			}
+		}
+	}
+
+	restore_all();
+	free(cpus);
+	return 0;
+}
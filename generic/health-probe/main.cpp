@@ -0,0 +1,381 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Fleet health probe: a daemon that runs short latency, bandwidth and
+	 compute probes at a low duty cycle and compares them with the machine
+	 profile, so that a node with degraded DIMMs, a stuck low frequency or
+	 thermal throttling shows up in its time series. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <malloc.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <omp.h>
+#include "timer.h"
+#include "profile.h"
+#include "chase.h"
+#include "cpufreq.h"
+#include "intensity.h"
+
+#define MAX_CPUS 1024
+
+/* MADs per element of the compute probe: far right of the ridge */
+#define COMPUTE_MADS 128
+
+/* Bandwidth probe granularity: the deadline is checked every chunk */
+#define CHUNK_BYTES (size_t(1) << 20)
+
+enum probe_t {
+	PROBE_LATENCY,
+	PROBE_BANDWIDTH,
+	PROBE_COMPUTE,
+	PROBE_COUNT
+};
+
+static const char* probe_names[PROBE_COUNT] = { "latency", "bandwidth", "compute" };
+
+static volatile sig_atomic_t g_stop = 0;
+
+struct options_t {
+	const char* profile;
+	const char* output;
+	const char* root;
+	double interval;
+	double budget;
+	double duty;
+	double tolerance;
+	int consecutive;
+	int rounds;
+	int threads;
+	size_t memory;
+};
+
+/* =================================================================== */
+/* Parse program input */
+void usage(int argc, char** argv, options_t* o)
+{
+	memset(o, 0, sizeof(*o));
+	o->profile = profile::default_path();
+	o->root = "/sys";
+	o->interval = 60.0;
+	o->budget = 0.1;
+	o->duty = 0.01;
+	o->tolerance = 0.2;
+	o->consecutive = 3;
+	int c;
+	while ((c = getopt(argc, argv, "p:o:r:i:b:d:t:k:n:j:m:h")) != -1) {
+		switch (c) {
+			case 'p': o->profile = optarg; break;
+			case 'o': o->output = optarg; break;
+			case 'r': o->root = optarg; break;
+			case 'i': o->interval = atof(optarg); break;
+			case 'b': o->budget = atof(optarg) / 1.0e+3; break;
+			case 'd': o->duty = atof(optarg) / 100.0; break;
+			case 't': o->tolerance = atof(optarg) / 100.0; break;
+			case 'k': o->consecutive = atoi(optarg); break;
+			case 'n': o->rounds = atoi(optarg); break;
+			case 'j': o->threads = atoi(optarg); break;
+			case 'm': o->memory = size_t(atol(optarg)) << 20; break;
+			default:
+				fprintf(stderr,
+								"usage: %s [-p profile] [-o output] [-i interval secs] [-b probe ms]\n"
+								"          [-d max duty %%] [-t tolerance %%] [-k consecutive] [-n rounds]\n"
+								"          [-j threads] [-m memory MB] [-r sysfs root]\n", argv[0]);
+				exit(c != 'h');
+		}
+	}
+	if (o->budget <= 0.0 || o->duty <= 0.0 || o->duty > 1.0) {
+		fprintf(stderr, "Probe time and duty cycle must be positive, duty at most 100%%\n");
+		exit(1);
+	}
+	if (o->consecutive < 1)
+		o->consecutive = 1;
+}
+/* =================================================================== */
+
+
+/* =================================================================== */
+void on_signal(int)
+{
+	g_stop = 1;
+}
+
+/* Sleep in steps so that a signal ends the daemon promptly */
+void pause_for(double secs)
+{
+	while (secs > 0.0 && !g_stop) {
+		const double step = secs < 1.0 ? secs : 1.0;
+		struct timespec ts;
+		ts.tv_sec = time_t(step);
+		ts.tv_nsec = long((step - double(ts.tv_sec)) * 1.0e+9);
+		nanosleep(&ts, NULL);
+		secs -= step;
+	}
+}
+/* =================================================================== */
+
+
+/* =================================================================== */
+/* Probes. Each runs for about `budget` seconds and returns its figure:
+	 ns per dependent load, GB/s read, GFLOPS. */
+
+/* Dependent loads over a DRAM-sized chain; the walk continues where the
+	 previous probe stopped, so no warm-up lap is needed */
+double probe_latency(void*** position, double budget)
+{
+	size_t steps = 1 << 12;
+	double secs = 0.0;
+	size_t total = 0;
+	const uint64_t start = timer::get_ticks_acquire();
+	while (secs < budget) {
+		*position = chase::walk(*position, steps);
+		total += steps;
+		secs = timer::ticks_to_secs(timer::elapsed_ticks(start, timer::get_ticks_release()));
+		/* Fewer deadline checks once the rate is known */
+		if (steps < (size_t(1) << 20))
+			steps *= 2;
+	}
+	return secs * 1.0e+9 / double(total);
+}
+
+/* Every thread reads its own DRAM-sized array chunk by chunk until the
+	 deadline; the rate is all bytes over the slowest thread's time */
+double probe_bandwidth(const intensity::entry_t* k, void** data, size_t bytes, int threads,
+											 double budget)
+{
+	double total_bytes = 0.0;
+	double slowest = 0.0;
+	const size_t element_bytes = intensity::type_bytes(k->type);
+	const size_t per_iteration = size_t(k->lanes) * size_t(k->accumulators);
+	size_t chunk = CHUNK_BYTES / element_bytes;
+	chunk -= chunk % per_iteration;
+	const size_t chunks = bytes / (chunk * element_bytes);
+
+	#pragma omp parallel num_threads(threads) reduction(+:total_bytes) reduction(max:slowest)
+	{
+		const int tid = omp_get_thread_num();
+		uint8_t result[16 * 64] __attribute__((aligned(64)));
+		size_t next = 0, done = 0;
+		double secs = 0.0;
+		#pragma omp barrier
+		const uint64_t start = timer::get_ticks_acquire();
+		while (secs < budget) {
+			k->function((const char*) data[tid] + next * chunk * element_bytes, chunk, result);
+			next = (next + 1 == chunks) ? 0 : next + 1;
+			done++;
+			secs = timer::ticks_to_secs(timer::elapsed_ticks(start, timer::get_ticks_release()));
+		}
+		total_bytes = double(done) * double(chunk * element_bytes);
+		slowest = secs;
+	}
+	return total_bytes / slowest / 1.0e+9;
+}
+
+/* High-intensity kernel over an L1-resident array per thread */
+double probe_compute(const intensity::entry_t* k, void** data, size_t length, int threads,
+										 double budget)
+{
+	double total_flops = 0.0;
+	double slowest = 0.0;
+
+	#pragma omp parallel num_threads(threads) reduction(+:total_flops) reduction(max:slowest)
+	{
+		const int tid = omp_get_thread_num();
+		uint8_t result[16 * 64] __attribute__((aligned(64)));
+		size_t done = 0;
+		double secs = 0.0;
+		#pragma omp barrier
+		const uint64_t start = timer::get_ticks_acquire();
+		while (secs < budget) {
+			k->function(data[tid], length, result);
+			done++;
+			secs = timer::ticks_to_secs(timer::elapsed_ticks(start, timer::get_ticks_release()));
+		}
+		total_flops = 2.0 * double(length) * double(k->mads) * double(done);
+		slowest = secs;
+	}
+	return total_flops / slowest / 1.0e+9;
+}
+/* =================================================================== */
+
+
+int main(int argc, char** argv)
+{
+	options_t o;
+	usage(argc, argv, &o);
+
+	timer::init();
+
+	profile::machine_t machine;
+	profile::init(&machine);
+	if (profile::load(&machine, o.profile) != 0)
+		fprintf(stderr, "No profile at %s: the first probes are the baseline\n", o.profile);
+	profile::fill_caches(&machine);
+
+	/* The bandwidth and compute figures are compared with the roofline
+		 fit, so run with as many threads as its sweep did */
+	int threads = o.threads;
+	if (threads < 1)
+		threads = machine.roofline.threads > 0 ? machine.roofline.threads : omp_get_max_threads();
+
+	/* Expected figure per probe; 0 until known */
+	double expected[PROBE_COUNT] = {
+		machine.dram_latency_ns, machine.roofline.peak_gbps, machine.roofline.peak_gflops
+	};
+	/* Lower is better for latency, higher for the others */
+	const int lower_is_better[PROBE_COUNT] = { 1, 0, 0 };
+
+	const int isa = intensity::best_isa(intensity::TYPE_DOUBLE);
+	const intensity::entry_t* read_kernel = intensity::select(isa, intensity::TYPE_DOUBLE, 1, 8);
+	const intensity::entry_t* compute_kernel =
+		intensity::select(isa, intensity::TYPE_DOUBLE, COMPUTE_MADS, 8);
+	if (read_kernel == NULL || compute_kernel == NULL) {
+		fprintf(stderr, "No double-precision kernels for this CPU\n");
+		return 1;
+	}
+	const size_t per_iteration = size_t(compute_kernel->lanes) * size_t(compute_kernel->accumulators);
+
+	/* Buffers live for the daemon's lifetime: allocating and faulting in
+		 DRAM-sized arrays every round would cost more than the probes. Twice
+		 the LLC is enough to miss it and keeps the resident footprint (the
+		 chain plus the arrays, 2x this) modest on a production node. */
+	size_t dram_bytes = o.memory;
+	if (dram_bytes == 0) {
+		const size_t llc = profile::cache_bytes(&machine, machine.cache_levels);
+		dram_bytes = llc != 0 ? 2 * llc : size_t(256) << 20;
+	}
+	const size_t chain_bytes = dram_bytes;
+	const size_t stream_bytes = dram_bytes / size_t(threads) / CHUNK_BYTES * CHUNK_BYTES;
+	size_t l1_length = profile::resident_bytes(&machine, 1, threads, size_t(16) << 10) / sizeof(double);
+	l1_length -= l1_length % per_iteration;
+	if (l1_length == 0)
+		l1_length = per_iteration;
+	if (stream_bytes < CHUNK_BYTES) {
+		fprintf(stderr, "Bandwidth arrays of %zu bytes are too small\n", stream_bytes);
+		return 1;
+	}
+
+	void* chain_memory = chase::allocate(chain_bytes);
+	void** position = chain_memory != NULL ? chase::build(chain_memory, chain_bytes, 64, 0x9e3779b97f4a7c15ull) : NULL;
+	if (position == NULL) {
+		fprintf(stderr, "Could not allocate a %zu-byte chain\n", chain_bytes);
+		return 1;
+	}
+	void** stream = (void**) calloc(threads, sizeof(void*));
+	void** l1 = (void**) calloc(threads, sizeof(void*));
+	#pragma omp parallel num_threads(threads)
+	{
+		/* First touch from the thread that reads the array */
+		const int tid = omp_get_thread_num();
+		stream[tid] = memalign(64, stream_bytes);
+		memset(stream[tid], 0, stream_bytes);
+		l1[tid] = memalign(64, l1_length * sizeof(double));
+		memset(l1[tid], 0, l1_length * sizeof(double));
+	}
+
+	FILE* out = stdout;
+	if (o.output != NULL) {
+		out = fopen(o.output, "a");
+		if (out == NULL) {
+			fprintf(stderr, "Could not open %s\n", o.output);
+			return 1;
+		}
+	}
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	fprintf(stderr, "%s, %d threads, chain %zu MB, arrays %zu MB per thread\n",
+					intensity::isa_name(isa), threads, chain_bytes >> 20, stream_bytes >> 20);
+	fprintf(out, "# expected: %.3f ns, %.3f GB/s, %.3f GFLOPS, tolerance %.0f%%\n",
+					expected[PROBE_LATENCY], expected[PROBE_BANDWIDTH], expected[PROBE_COMPUTE],
+					o.tolerance * 100.0);
+	fprintf(out, "Time" "\t" "Latency ns" "\t" "GB/s" "\t" "GFLOPS" "\t" "MHz" "\t"
+					"Probe secs" "\t" "Duty %%" "\t" "Flags" "\n");
+	fflush(out);
+
+	int streak[PROBE_COUNT] = { 0, 0, 0 };
+	for (int round = 0; (o.rounds == 0 || round < o.rounds) && !g_stop; round++) {
+		const uint64_t start = timer::get_ticks_acquire();
+		double value[PROBE_COUNT];
+		value[PROBE_LATENCY] = probe_latency(&position, o.budget);
+		value[PROBE_BANDWIDTH] = probe_bandwidth(read_kernel, stream, stream_bytes, threads, o.budget);
+		value[PROBE_COMPUTE] = probe_compute(compute_kernel, l1, l1_length, threads, o.budget);
+		/* Right after the compute probe: the frequency under load */
+		const unsigned long khz = cpufreq::average_khz(o.root, MAX_CPUS);
+		const double probe_secs = timer::ticks_to_secs(timer::elapsed_ticks(start, timer::get_ticks_release()));
+
+		/* Overhead bound: idle at least long enough that probing stays
+			 within the duty cycle, even when the interval is shorter */
+		double idle = o.interval - probe_secs;
+		const double minimum = probe_secs * (1.0 / o.duty - 1.0);
+		if (idle < minimum)
+			idle = minimum;
+
+		/* A probe is flagged when it is worse than expected by more than
+			 the tolerance; -k flagged rounds in a row make an anomaly */
+		char flags[64] = "";
+		for (int p = 0; p < PROBE_COUNT; p++) {
+			if (expected[p] == 0.0)
+				expected[p] = value[p];
+			const double ratio = value[p] / expected[p];
+			const int bad = lower_is_better[p] ? ratio > 1.0 + o.tolerance : ratio < 1.0 - o.tolerance;
+			streak[p] = bad ? streak[p] + 1 : 0;
+			if (bad) {
+				if (flags[0] != '\0')
+					strcat(flags, ",");
+				strcat(flags, probe_names[p]);
+			}
+			if (streak[p] == o.consecutive)
+				fprintf(stderr, "Anomaly: %s at %.2fx of expected for %d probes\n", probe_names[p],
+								ratio, streak[p]);
+		}
+
+		fprintf(out, "%ld" "\t" "%4.03lf" "\t" "%4.03lf" "\t" "%4.03lf" "\t", (long) time(NULL),
+						value[PROBE_LATENCY], value[PROBE_BANDWIDTH], value[PROBE_COMPUTE]);
+		if (khz != 0)
+			fprintf(out, "%lu", khz / 1000);
+		else
+			fprintf(out, "n/a");
+		fprintf(out, "\t" "%4.03lf" "\t" "%4.03lf" "\t" "%s" "\n", probe_secs,
+						probe_secs / (probe_secs + idle) * 100.0, flags[0] != '\0' ? flags : "-");
+		fflush(out);
+
+		if (o.rounds == 0 || round + 1 < o.rounds)
+			pause_for(idle);
+	}
+
+	if (out != stdout)
+		fclose(out);
+	#pragma omp parallel num_threads(threads)
+	{
+		const int tid = omp_get_thread_num();
+		free(stream[tid]);
+		free(l1[tid]);
+	}
+	free(stream);
+	free(l1);
+	chase::release(chain_memory, chain_bytes);
+	return 0;
+}
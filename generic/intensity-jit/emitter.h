@@ -0,0 +1,283 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Runtime x86-64 emitter for the load/multiply-add intensity loop.
+
+	 The generated function has the shape of sumsq in the ivy_bridge and
+	 bobcat benchmarks, but the multiply-add count per element (the
+	 MAD_PER_ELEMENT macro there), the vector width and the number of
+	 independent accumulators are chosen at runtime:
+
+		 void kernel(const void* data, size_t length, void* result);
+
+	 Each iteration loads `accumulators` vectors and applies `mads` operations
+	 to every one of them, either
+		 MULADD: x = x * x; acc = acc + x   (as in sumsq.asm)
+		 FMA:    acc = x * x + acc          (vfmadd231)
+	 which is 2 flops per element per operation either way. `length` is in
+	 elements and must be a multiple of the elements loaded per iteration.
+	 The accumulators are stored to `result` (accumulators * width bytes) so
+	 that the output can be checked and the loop cannot be discarded.
+
+	 128- and 256-bit kernels use VEX encoding (AVX, plus FMA for the FMA
+	 form); 512-bit kernels use EVEX encoding (AVX-512F) and may use up to 16
+	 accumulators since zmm16-zmm31 are available.
+ */
+
+#ifndef UBENCH_INTENSITY_EMITTER_H
+#define UBENCH_INTENSITY_EMITTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+
+namespace jit {
+
+	enum op_t {
+		OP_MULADD,
+		OP_FMA
+	};
+
+	struct kernel_config_t {
+		int is_double;     /* 1: double, 0: float */
+		int width_bits;    /* 128, 256 or 512 */
+		int accumulators;  /* 1..8 (1..16 for 512-bit) */
+		int mads;          /* operations per element, >= 1 */
+		op_t op;
+	};
+
+	typedef void (*kernel_t)(const void* data, size_t length, void* result);
+
+	/* Executable mapping holding one generated function */
+	struct code_t {
+		uint8_t* base;
+		size_t capacity;
+		size_t size;
+		int overflow;
+		kernel_t function;
+	};
+
+	/* ----------------------------------------------------------------- */
+	/* Byte emission */
+
+	inline static void emit_byte(code_t* c, uint8_t byte) {
+		if (c->size < c->capacity)
+			c->base[c->size++] = byte;
+		else
+			c->overflow = 1;
+	}
+
+	inline static void emit_u32(code_t* c, uint32_t value) {
+		for (int i = 0; i < 4; i++)
+			emit_byte(c, uint8_t(value >> (8 * i)));
+	}
+
+	/* Register numbers */
+	enum {
+		RAX = 0, RDX = 2, RSI = 6, RDI = 7
+	};
+
+	/* Memory operand [base + disp32] for rdi/rdx (no SIB needed), or
+		 register-direct when base < 0 */
+	inline static void emit_modrm(code_t* c, int reg, int rm_reg, int base, int32_t disp) {
+		if (base < 0) {
+			emit_byte(c, uint8_t(0xC0 | ((reg & 7) << 3) | (rm_reg & 7)));
+		} else {
+			emit_byte(c, uint8_t(0x80 | ((reg & 7) << 3) | (base & 7)));
+			emit_u32(c, uint32_t(disp));
+		}
+	}
+
+	/* VEX map select */
+	enum {
+		MAP_0F = 1, MAP_0F38 = 2
+	};
+
+	/* VEX pp field */
+	enum {
+		PP_NONE = 0, PP_66 = 1
+	};
+
+	/* Three-byte VEX instruction. `rm` is a vector register when base < 0,
+		 otherwise the operand is [base + disp]. */
+	inline static void emit_vex(code_t* c, int map, int pp, int w, int l256,
+															uint8_t opcode, int reg, int vvvv, int rm, int base, int32_t disp) {
+		const int rm_high = base < 0 ? (rm >> 3) & 1 : 0;
+		emit_byte(c, 0xC4);
+		emit_byte(c, uint8_t(((~reg >> 3) & 1) << 7 | 1 << 6 | (rm_high ^ 1) << 5 | map));
+		emit_byte(c, uint8_t(w << 7 | ((~vvvv) & 0xF) << 3 | l256 << 2 | pp));
+		emit_byte(c, opcode);
+		emit_modrm(c, reg, rm, base, disp);
+	}
+
+	/* Four-byte EVEX instruction, 512-bit, no masking or broadcast */
+	inline static void emit_evex(code_t* c, int map, int pp, int w,
+															 uint8_t opcode, int reg, int vvvv, int rm, int base, int32_t disp) {
+		const int b = base < 0 ? (rm >> 3) & 1 : 0;
+		const int x = base < 0 ? (rm >> 4) & 1 : 0;
+		emit_byte(c, 0x62);
+		emit_byte(c, uint8_t((((reg >> 3) & 1) ^ 1) << 7 | (x ^ 1) << 6 | (b ^ 1) << 5 |
+												 (((reg >> 4) & 1) ^ 1) << 4 | map));
+		emit_byte(c, uint8_t(w << 7 | ((~vvvv) & 0xF) << 3 | 1 << 2 | pp));
+		emit_byte(c, uint8_t(2 << 5 | (((vvvv >> 4) & 1) ^ 1) << 3));
+		emit_byte(c, opcode);
+		emit_modrm(c, reg, rm, base, disp);
+	}
+
+	/* Vector instruction in the encoding the configured width needs */
+	inline static void emit_vector(code_t* c, const kernel_config_t* k, int map, int w,
+																 uint8_t opcode, int reg, int vvvv, int rm, int base, int32_t disp) {
+		const int pp = k->is_double ? PP_66 : PP_NONE;
+		if (k->width_bits == 512)
+			emit_evex(c, map, map == MAP_0F38 ? PP_66 : pp, w, opcode, reg, vvvv, rm, base, disp);
+		else
+			emit_vex(c, map, map == MAP_0F38 ? PP_66 : pp, w, k->width_bits == 256,
+							 opcode, reg, vvvv, rm, base, disp);
+	}
+
+	/* ----------------------------------------------------------------- */
+
+	/** \brief Check a configuration against the encodings implemented here.
+	 * Returns 0 when it can be generated.
+	 */
+	inline static int validate(const kernel_config_t* k) {
+		const int max_accumulators = k->width_bits == 512 ? 16 : 8;
+		if (k->width_bits != 128 && k->width_bits != 256 && k->width_bits != 512)
+			return -1;
+		if (k->accumulators < 1 || k->accumulators > max_accumulators)
+			return -1;
+		if (k->mads < 1)
+			return -1;
+		return 0;
+	}
+
+	/** \brief Elements consumed by one loop iteration. */
+	inline static size_t elements_per_iteration(const kernel_config_t* k) {
+		return size_t(k->accumulators) * size_t(k->width_bits / 8) / (k->is_double ? 8 : 4);
+	}
+
+	/** \brief Bytes of code the generated kernel needs (upper bound). */
+	inline static size_t code_bytes(const kernel_config_t* k) {
+		const size_t per_op = 11;
+		return 256 + size_t(k->accumulators) * (3 * per_op + size_t(k->mads) * 2 * per_op);
+	}
+
+	/** \brief Generate the kernel into a fresh executable mapping.
+	 * Returns 0 on success; release the mapping with release().
+	 */
+	inline static int generate(code_t* c, const kernel_config_t* k) {
+		memset(c, 0, sizeof(*c));
+		if (validate(k) != 0)
+			return -1;
+		const size_t page = 4096;
+		c->capacity = (code_bytes(k) + page - 1) / page * page;
+		void* memory = mmap(NULL, c->capacity, PROT_READ | PROT_WRITE,
+												MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (memory == MAP_FAILED)
+			return -1;
+		c->base = (uint8_t*) memory;
+
+		const int n = k->accumulators;
+		const int vector_bytes = k->width_bits / 8;
+		/* EVEX.W distinguishes pd from ps for every instruction used here;
+			 VEX ignores it except for the FMA */
+		const int w = k->is_double;
+		const size_t step_elements = elements_per_iteration(k);
+		const int32_t step_bytes = int32_t(n * vector_bytes);
+		/* Accumulators in registers 0..n-1, loaded values in n..2n-1 */
+		const int acc = 0;
+		const int x = n;
+
+		/* Clear the accumulators: vpxor/vpxord acc, acc, acc */
+		for (int i = 0; i < n; i++) {
+			if (k->width_bits == 512)
+				emit_evex(c, MAP_0F, PP_66, 0, 0xEF, acc + i, acc + i, acc + i, -1, 0);
+			else
+				emit_vex(c, MAP_0F, PP_66, 0, 0, 0xEF, acc + i, acc + i, acc + i, -1, 0);
+		}
+
+		/* sub rsi, step_elements; jb .finish */
+		emit_byte(c, 0x48); emit_byte(c, 0x81); emit_byte(c, 0xEE);
+		emit_u32(c, uint32_t(step_elements));
+		emit_byte(c, 0x0F); emit_byte(c, 0x82);
+		const size_t jb_patch = c->size;
+		emit_u32(c, 0);
+
+		/* Align the loop head to 32 bytes with single-byte NOPs */
+		while (c->size % 32 != 0)
+			emit_byte(c, 0x90);
+		const size_t loop = c->size;
+
+		/* vmovups/vmovupd x_i, [rdi + i * vector_bytes] */
+		for (int i = 0; i < n; i++)
+			emit_vector(c, k, MAP_0F, w, 0x10, x + i, 0, 0, RDI, i * vector_bytes);
+
+		for (int m = 0; m < k->mads; m++) {
+			for (int i = 0; i < n; i++) {
+				if (k->op == OP_FMA) {
+					/* vfmadd231 acc_i, x_i, x_i */
+					emit_vector(c, k, MAP_0F38, w, 0xB8, acc + i, x + i, x + i, -1, 0);
+				} else {
+					/* vmul x_i, x_i, x_i; vadd acc_i, acc_i, x_i */
+					emit_vector(c, k, MAP_0F, w, 0x59, x + i, x + i, x + i, -1, 0);
+					emit_vector(c, k, MAP_0F, w, 0x58, acc + i, acc + i, x + i, -1, 0);
+				}
+			}
+		}
+
+		/* add rdi, step_bytes */
+		emit_byte(c, 0x48); emit_byte(c, 0x81); emit_byte(c, 0xC7);
+		emit_u32(c, uint32_t(step_bytes));
+		/* sub rsi, step_elements; jae loop */
+		emit_byte(c, 0x48); emit_byte(c, 0x81); emit_byte(c, 0xEE);
+		emit_u32(c, uint32_t(step_elements));
+		emit_byte(c, 0x0F); emit_byte(c, 0x83);
+		emit_u32(c, uint32_t(int32_t(loop) - int32_t(c->size + 4)));
+
+		/* .finish: store the accumulators to [rdx + i * vector_bytes] */
+		const size_t finish = c->size;
+		const int32_t rel = int32_t(finish) - int32_t(jb_patch + 4);
+		if (jb_patch + 4 <= c->capacity)
+			memcpy(c->base + jb_patch, &rel, 4);
+		for (int i = 0; i < n; i++)
+			emit_vector(c, k, MAP_0F, w, 0x11, acc + i, 0, 0, RDX, i * vector_bytes);
+
+		/* vzeroupper; ret */
+		emit_byte(c, 0xC5); emit_byte(c, 0xF8); emit_byte(c, 0x77);
+		emit_byte(c, 0xC3);
+
+		if (c->overflow || mprotect(c->base, c->capacity, PROT_READ | PROT_EXEC) != 0) {
+			munmap(c->base, c->capacity);
+			memset(c, 0, sizeof(*c));
+			return -1;
+		}
+		c->function = (kernel_t) (void*) c->base;
+		return 0;
+	}
+
+	inline static void release(code_t* c) {
+		if (c->base != NULL)
+			munmap(c->base, c->capacity);
+		memset(c, 0, sizeof(*c));
+	}
+
+}
+
+#endif /* UBENCH_INTENSITY_EMITTER_H */
@@ -0,0 +1,165 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <malloc.h>
+#include <string.h>
+#include <omp.h>
+#include "timer.h"
+#include "cpuid.h"
+#include "profile.h"
+#include "emitter.h"
+
+/* Multiply-adds per element swept when no list is given; a sumsq build
+	 with MAD_PER_ELEMENT=M corresponds to the MULADD row with M */
+static const int default_mads[] = { 1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128 };
+
+/* =================================================================== */
+/* Parse program input */
+void usage(int argc, char** argv, jit::kernel_config_t* k, int* max_mads)
+{
+	const int widest = cpu::has_avx512f() ? 512 : 256;
+	k->is_double = 1;
+	k->width_bits = widest;
+	k->accumulators = 8;
+	k->mads = 1;
+	k->op = cpu::has_fma() ? jit::OP_FMA : jit::OP_MULADD;
+	*max_mads = 128;
+
+	if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+		fprintf(stderr, "usage: %s [single|double] [128|256|512] [accumulators] "
+						"[fma|muladd] [max multiply-adds per element]\n", argv[0]);
+		exit(0);
+	}
+	if (argc > 1)
+		k->is_double = strcmp(argv[1], "single") != 0;
+	if (argc > 2)
+		k->width_bits = atoi(argv[2]);
+	if (argc > 3)
+		k->accumulators = atoi(argv[3]);
+	if (argc > 4)
+		k->op = strcmp(argv[4], "muladd") == 0 ? jit::OP_MULADD : jit::OP_FMA;
+	if (argc > 5)
+		*max_mads = atoi(argv[5]);
+
+	if (jit::validate(k) != 0) {
+		fprintf(stderr, "Unsupported configuration: width %d, %d accumulators\n",
+						k->width_bits, k->accumulators);
+		exit(1);
+	}
+	if (!cpu::has_avx() || (k->width_bits == 512 && !cpu::has_avx512f()) ||
+			(k->op == jit::OP_FMA && !cpu::has_fma())) {
+		fprintf(stderr, "This CPU does not support %d-bit %s\n", k->width_bits,
+						k->op == jit::OP_FMA ? "FMA" : "AVX");
+		exit(1);
+	}
+}
+/* =================================================================== */
+
+
+int main(int argc, char** argv)
+{
+	jit::kernel_config_t k;
+	int max_mads;
+	usage(argc, argv, &k, &max_mads);
+
+	timer::init();
+
+	/* Each thread streams its own DRAM-resident array */
+	const int threads = omp_get_max_threads();
+	profile::machine_t machine;
+	profile::init(&machine);
+	profile::load(&machine, profile::default_path());
+	const size_t element_bytes = k.is_double ? sizeof(double) : sizeof(float);
+	const size_t per_iteration = jit::elements_per_iteration(&k);
+	size_t bytes = profile::resident_bytes(&machine, machine.cache_levels + 1, threads,
+																				 size_t(256) << 20);
+	size_t length = bytes / element_bytes;
+	length -= length % per_iteration;
+	bytes = length * element_bytes;
+	/* Stream at least 1 GiB per thread per measurement */
+	const size_t passes = ((size_t(1) << 30) + bytes - 1) / bytes;
+
+	fprintf(stderr, "%s, %d-bit, %d accumulators, %s, %d threads, %zu MB per thread\n",
+					k.is_double ? "Double" : "Single", k.width_bits, k.accumulators,
+					k.op == jit::OP_FMA ? "FMA" : "MUL+ADD", threads, bytes >> 20);
+
+	void** data = (void**) calloc(threads, sizeof(void*));
+	uint64_t* ticks = (uint64_t*) calloc(threads, sizeof(uint64_t));
+	jit::code_t code;
+	int failed = 0;
+
+	printf("MADs" "\t" "Threads" "\t" "Flop/byte" "\t" "Secs" "\t" "GB/s" "\t" "GFLOPS" "\n");
+
+	#pragma omp parallel num_threads(threads)
+	{
+		const int tid = omp_get_thread_num();
+		/* First touch from the thread that uses the array */
+		data[tid] = memalign(64, bytes);
+		memset(data[tid], 0, bytes);
+		uint8_t result[16 * 64] __attribute__((aligned(64)));
+
+		for (size_t i = 0; i < sizeof(default_mads) / sizeof(default_mads[0]); i++) {
+			if (default_mads[i] > max_mads)
+				break;
+
+			#pragma omp single
+			{
+				k.mads = default_mads[i];
+				if (jit::generate(&code, &k) != 0) {
+					fprintf(stderr, "Code generation failed for %d MADs\n", k.mads);
+					failed = 1;
+				}
+			}
+			/* implicit barrier: code is ready and all threads start together */
+			if (failed)
+				break;
+
+			const uint64_t start = timer::get_ticks_acquire();
+			for (size_t pass = 0; pass < passes; pass++)
+				code.function(data[tid], length, result);
+			const uint64_t end = timer::get_ticks_release();
+			ticks[tid] = timer::elapsed_ticks(start, end);
+
+			#pragma omp barrier
+			#pragma omp single
+			{
+				uint64_t slowest = 0;
+				for (int t = 0; t < threads; t++)
+					slowest = ticks[t] > slowest ? ticks[t] : slowest;
+				const double secs = timer::ticks_to_secs(slowest);
+				const double total_bytes = double(bytes) * double(passes) * threads;
+				const double flops = 2.0 * double(length) * double(passes) * k.mads * threads;
+				printf("%d" "\t" "%d" "\t" "%4.03lf" "\t" "%4.06lf" "\t" "%4.03lf" "\t" "%4.03lf" "\n",
+							 k.mads, threads, flops / total_bytes, secs, total_bytes / secs / 1.0e+9,
+							 flops / secs / 1.0e+9);
+				fflush(stdout);
+				jit::release(&code);
+			}
+		}
+		free(data[tid]);
+	}
+
+	free(data);
+	free(ticks);
+	return failed;
+}
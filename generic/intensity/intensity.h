@@ -0,0 +1,629 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Intensity kernels as C++ templates.
+
+	 Portable counterpart of sumsq in the ivy_bridge and bobcat benchmarks and
+	 of the runtime-generated kernels in ../intensity-jit. A kernel is a
+	 template on element type, vector ISA, multiply-adds per element (the
+	 MAD_PER_ELEMENT macro of sumsq.asm) and number of accumulators:
+
+		 intensity::kernel<T, ISA, MADS, ACCUMULATORS>(data, length, result)
+
+	 Each iteration loads ACCUMULATORS aligned vectors and applies MADS
+	 operations to each one; the accumulator loops are unrolled at compile
+	 time so that the generated code is one load per vector plus
+		 ISA_SSE, ISA_AVX:        x = x * x; acc = acc + x   (sumsq.asm)
+		 ISA_AVX2_FMA, ISA_AVX512: acc = x * x + acc         (one FMA)
+	 per operation, i.e. the same loads and 2 flops per element per operation
+	 as the asm. `length` is in elements and must be a multiple of the
+	 elements loaded per iteration; the accumulators are stored to `result`.
+
+	 Reduced-precision and integer elements (fp16_t, bf16_t, int8_t,
+	 int16_t) use the same loop; their multiply-add is the format's
+	 widening dot product, accumulated in fp32 or int32 except for native
+	 FP16:
+		 FP16  AVX2-FMA:      VCVTPH2PS to fp32 (F16C), then FMA
+		       AVX512-FP16:   VFMADDPH on 32 halves
+		 BF16  AVX2-FMA:      even/odd halves widened by shift/mask, two FMAs
+		       AVX512-BF16:   VDPBF16PS (pairs of bf16 into fp32)
+		 INT8  AVX2-FMA:      VPMADDUBSW + VPMADDWD + VPADDD
+		       AVX512-VNNI:   VPDPBUSD (u8 x s8 quads into int32)
+		 INT16 AVX2-FMA:      VPMADDWD + VPADDD
+		       AVX512-VNNI:   VPDPWSSD (pairs of int16 into int32)
+	 Every one is counted as 2 operations (multiply and add) per element
+	 per MAD, so ops/byte and ops/s line up with the float kernels.
+
+	 ISA traits are only defined when the translation unit is compiled for
+	 that ISA, so each ISA lives in its own file (kernels-<isa>.cpp) built
+	 with the matching -m flags. Those files instantiate the table for the
+	 MADs in INTENSITY_MADS and the caller picks an entry at runtime with
+	 select().
+ */
+
+#ifndef UBENCH_INTENSITY_H
+#define UBENCH_INTENSITY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+	#include <immintrin.h>
+#endif
+#include "cpuid.h"
+
+namespace intensity {
+
+	enum isa_t {
+		ISA_SSE,
+		ISA_AVX,
+		ISA_AVX2_FMA,
+		ISA_AVX512,
+		ISA_AVX512_FP16,
+		ISA_AVX512_BF16,
+		ISA_AVX512_VNNI,
+		ISA_COUNT
+	};
+
+	enum type_t {
+		TYPE_FLOAT,
+		TYPE_DOUBLE,
+		TYPE_FP16,
+		TYPE_BF16,
+		TYPE_INT8,
+		TYPE_INT16,
+		TYPE_COUNT
+	};
+
+	/* 16-bit storage formats; only ever loaded, never computed on in C++ */
+	struct fp16_t { uint16_t bits; };
+	struct bf16_t { uint16_t bits; };
+
+	template <typename T> struct type_of;
+	template <> struct type_of<float> { enum { value = TYPE_FLOAT }; };
+	template <> struct type_of<double> { enum { value = TYPE_DOUBLE }; };
+	template <> struct type_of<fp16_t> { enum { value = TYPE_FP16 }; };
+	template <> struct type_of<bf16_t> { enum { value = TYPE_BF16 }; };
+	template <> struct type_of<int8_t> { enum { value = TYPE_INT8 }; };
+	template <> struct type_of<int16_t> { enum { value = TYPE_INT16 }; };
+
+	inline static const char* isa_name(int isa) {
+		switch (isa) {
+			case ISA_SSE: return "SSE";
+			case ISA_AVX: return "AVX";
+			case ISA_AVX2_FMA: return "AVX2-FMA";
+			case ISA_AVX512: return "AVX-512";
+			case ISA_AVX512_FP16: return "AVX512-FP16";
+			case ISA_AVX512_BF16: return "AVX512-BF16";
+			case ISA_AVX512_VNNI: return "AVX512-VNNI";
+			default: return "?";
+		}
+	}
+
+	inline static const char* type_name(int type) {
+		switch (type) {
+			case TYPE_FLOAT: return "single";
+			case TYPE_DOUBLE: return "double";
+			case TYPE_FP16: return "fp16";
+			case TYPE_BF16: return "bf16";
+			case TYPE_INT8: return "int8";
+			case TYPE_INT16: return "int16";
+			default: return "?";
+		}
+	}
+
+	inline static size_t type_bytes(int type) {
+		switch (type) {
+			case TYPE_DOUBLE: return 8;
+			case TYPE_FLOAT: return 4;
+			case TYPE_INT8: return 1;
+			default: return 2;
+		}
+	}
+
+	/* What a kernel does with each element after its multiply-adds */
+	enum store_t {
+		STORE_NONE,
+		STORE_REGULAR,
+		STORE_STREAM
+	};
+
+	/* STORE_NONE: `result` receives the accumulators. Otherwise it is an
+		 array of `length` elements (64-byte aligned for STORE_STREAM) that
+		 receives every updated element; it may be `data` itself. */
+	typedef void (*function_t)(const void* data, size_t length, void* result);
+
+	struct entry_t {
+		int isa;
+		int type;
+		int mads;
+		int accumulators;
+		int lanes;
+		function_t function;
+		int store;
+	};
+
+	/* ----------------------------------------------------------------- */
+	/* Vector traits: one specialisation per element type and ISA.
+		 vector_t is what a load produces, acc_t what the multiply-adds
+		 accumulate into; lanes counts elements per load. The float and
+		 double traits also have stream(), an aligned non-temporal store. */
+
+	template <typename T, int ISA> struct simd;
+
+#if defined(__SSE2__)
+	template <> struct simd<float, ISA_SSE> {
+		typedef __m128 vector_t;
+		typedef vector_t acc_t;
+		enum { lanes = 4, fused = 0 };
+		static inline vector_t zero() { return _mm_setzero_ps(); }
+		static inline vector_t load(const float* p) { return _mm_load_ps(p); }
+		static inline void store(float* p, vector_t v) { _mm_storeu_ps(p, v); }
+		static inline void stream(float* p, vector_t v) { _mm_stream_ps(p, v); }
+		static inline vector_t mul(vector_t a, vector_t b) { return _mm_mul_ps(a, b); }
+		static inline vector_t add(vector_t a, vector_t b) { return _mm_add_ps(a, b); }
+		static inline vector_t fmadd(vector_t a, vector_t b, vector_t c) { return add(mul(a, b), c); }
+	};
+
+	template <> struct simd<double, ISA_SSE> {
+		typedef __m128d vector_t;
+		typedef vector_t acc_t;
+		enum { lanes = 2, fused = 0 };
+		static inline vector_t zero() { return _mm_setzero_pd(); }
+		static inline vector_t load(const double* p) { return _mm_load_pd(p); }
+		static inline void store(double* p, vector_t v) { _mm_storeu_pd(p, v); }
+		static inline void stream(double* p, vector_t v) { _mm_stream_pd(p, v); }
+		static inline vector_t mul(vector_t a, vector_t b) { return _mm_mul_pd(a, b); }
+		static inline vector_t add(vector_t a, vector_t b) { return _mm_add_pd(a, b); }
+		static inline vector_t fmadd(vector_t a, vector_t b, vector_t c) { return add(mul(a, b), c); }
+	};
+#endif
+
+#if defined(__AVX__)
+	template <> struct simd<float, ISA_AVX> {
+		typedef __m256 vector_t;
+		typedef vector_t acc_t;
+		enum { lanes = 8, fused = 0 };
+		static inline vector_t zero() { return _mm256_setzero_ps(); }
+		static inline vector_t load(const float* p) { return _mm256_load_ps(p); }
+		static inline void store(float* p, vector_t v) { _mm256_storeu_ps(p, v); }
+		static inline void stream(float* p, vector_t v) { _mm256_stream_ps(p, v); }
+		static inline vector_t mul(vector_t a, vector_t b) { return _mm256_mul_ps(a, b); }
+		static inline vector_t add(vector_t a, vector_t b) { return _mm256_add_ps(a, b); }
+		static inline vector_t fmadd(vector_t a, vector_t b, vector_t c) { return add(mul(a, b), c); }
+	};
+
+	template <> struct simd<double, ISA_AVX> {
+		typedef __m256d vector_t;
+		typedef vector_t acc_t;
+		enum { lanes = 4, fused = 0 };
+		static inline vector_t zero() { return _mm256_setzero_pd(); }
+		static inline vector_t load(const double* p) { return _mm256_load_pd(p); }
+		static inline void store(double* p, vector_t v) { _mm256_storeu_pd(p, v); }
+		static inline void stream(double* p, vector_t v) { _mm256_stream_pd(p, v); }
+		static inline vector_t mul(vector_t a, vector_t b) { return _mm256_mul_pd(a, b); }
+		static inline vector_t add(vector_t a, vector_t b) { return _mm256_add_pd(a, b); }
+		static inline vector_t fmadd(vector_t a, vector_t b, vector_t c) { return add(mul(a, b), c); }
+	};
+#endif
+
+#if defined(__AVX2__) && defined(__FMA__)
+	template <> struct simd<float, ISA_AVX2_FMA> : simd<float, ISA_AVX> {
+		enum { fused = 1 };
+		static inline vector_t fmadd(vector_t a, vector_t b, vector_t c) { return _mm256_fmadd_ps(a, b, c); }
+	};
+
+	template <> struct simd<double, ISA_AVX2_FMA> : simd<double, ISA_AVX> {
+		enum { fused = 1 };
+		static inline vector_t fmadd(vector_t a, vector_t b, vector_t c) { return _mm256_fmadd_pd(a, b, c); }
+	};
+
+	/* FP16 through F16C: converted to fp32 on load */
+	template <> struct simd<fp16_t, ISA_AVX2_FMA> {
+		typedef __m256 vector_t;
+		typedef __m256 acc_t;
+		enum { lanes = 8, fused = 1 };
+		static inline acc_t zero() { return _mm256_setzero_ps(); }
+		static inline vector_t load(const fp16_t* p) { return _mm256_cvtph_ps(_mm_load_si128((const __m128i*) p)); }
+		static inline void store(fp16_t* p, acc_t v) { _mm256_storeu_ps((float*) p, v); }
+		static inline acc_t fmadd(vector_t a, vector_t b, acc_t c) { return _mm256_fmadd_ps(a, b, c); }
+	};
+
+	/* BF16 is the top half of an fp32: the odd element of each 32-bit pair
+		 is that pair with the low half cleared, the even one shifted up */
+	template <> struct simd<bf16_t, ISA_AVX2_FMA> {
+		typedef __m256i vector_t;
+		typedef __m256 acc_t;
+		enum { lanes = 16, fused = 1 };
+		static inline acc_t zero() { return _mm256_setzero_ps(); }
+		static inline vector_t load(const bf16_t* p) { return _mm256_load_si256((const __m256i*) p); }
+		static inline void store(bf16_t* p, acc_t v) { _mm256_storeu_ps((float*) p, v); }
+		static inline acc_t fmadd(vector_t a, vector_t b, acc_t c) {
+			const __m256 a_even = _mm256_castsi256_ps(_mm256_slli_epi32(a, 16));
+			const __m256 b_even = _mm256_castsi256_ps(_mm256_slli_epi32(b, 16));
+			const __m256i high = _mm256_set1_epi32(int(0xFFFF0000u));
+			const __m256 a_odd = _mm256_castsi256_ps(_mm256_and_si256(a, high));
+			const __m256 b_odd = _mm256_castsi256_ps(_mm256_and_si256(b, high));
+			return _mm256_fmadd_ps(a_odd, b_odd, _mm256_fmadd_ps(a_even, b_even, c));
+		}
+	};
+
+	/* The emulated integer dot products only read their operands, so x * x
+		 would be the same every MAD and the compiler hoists the multiplies
+		 out of the MADS loop, leaving one add per MAD. The empty asm makes
+		 each MAD's operand look new, as the fused kernels' accumulator
+		 chain does for them. */
+	static inline __attribute__((always_inline)) __m256i opaque(__m256i v) {
+		__asm__ volatile("" : "+x"(v));
+		return v;
+	}
+
+	/* INT8 as VPDPBUSD does it: u8 x s8, four products per int32 lane */
+	template <> struct simd<int8_t, ISA_AVX2_FMA> {
+		typedef __m256i vector_t;
+		typedef __m256i acc_t;
+		enum { lanes = 32, fused = 1 };
+		static inline acc_t zero() { return _mm256_setzero_si256(); }
+		static inline vector_t load(const int8_t* p) { return _mm256_load_si256((const __m256i*) p); }
+		static inline void store(int8_t* p, acc_t v) { _mm256_storeu_si256((__m256i*) p, v); }
+		static inline acc_t fmadd(vector_t a, vector_t b, acc_t c) {
+			const __m256i pairs = _mm256_maddubs_epi16(opaque(a), b);
+			return _mm256_add_epi32(c, _mm256_madd_epi16(pairs, _mm256_set1_epi16(1)));
+		}
+	};
+
+	template <> struct simd<int16_t, ISA_AVX2_FMA> {
+		typedef __m256i vector_t;
+		typedef __m256i acc_t;
+		enum { lanes = 16, fused = 1 };
+		static inline acc_t zero() { return _mm256_setzero_si256(); }
+		static inline vector_t load(const int16_t* p) { return _mm256_load_si256((const __m256i*) p); }
+		static inline void store(int16_t* p, acc_t v) { _mm256_storeu_si256((__m256i*) p, v); }
+		static inline acc_t fmadd(vector_t a, vector_t b, acc_t c) {
+			return _mm256_add_epi32(c, _mm256_madd_epi16(opaque(a), b));
+		}
+	};
+#endif
+
+#if defined(__AVX512F__)
+	template <> struct simd<float, ISA_AVX512> {
+		typedef __m512 vector_t;
+		typedef vector_t acc_t;
+		enum { lanes = 16, fused = 1 };
+		static inline vector_t zero() { return _mm512_setzero_ps(); }
+		static inline vector_t load(const float* p) { return _mm512_load_ps(p); }
+		static inline void store(float* p, vector_t v) { _mm512_storeu_ps(p, v); }
+		static inline void stream(float* p, vector_t v) { _mm512_stream_ps(p, v); }
+		static inline vector_t mul(vector_t a, vector_t b) { return _mm512_mul_ps(a, b); }
+		static inline vector_t add(vector_t a, vector_t b) { return _mm512_add_ps(a, b); }
+		static inline vector_t fmadd(vector_t a, vector_t b, vector_t c) { return _mm512_fmadd_ps(a, b, c); }
+	};
+
+	template <> struct simd<double, ISA_AVX512> {
+		typedef __m512d vector_t;
+		typedef vector_t acc_t;
+		enum { lanes = 8, fused = 1 };
+		static inline vector_t zero() { return _mm512_setzero_pd(); }
+		static inline vector_t load(const double* p) { return _mm512_load_pd(p); }
+		static inline void store(double* p, vector_t v) { _mm512_storeu_pd(p, v); }
+		static inline void stream(double* p, vector_t v) { _mm512_stream_pd(p, v); }
+		static inline vector_t mul(vector_t a, vector_t b) { return _mm512_mul_pd(a, b); }
+		static inline vector_t add(vector_t a, vector_t b) { return _mm512_add_pd(a, b); }
+		static inline vector_t fmadd(vector_t a, vector_t b, vector_t c) { return _mm512_fmadd_pd(a, b, c); }
+	};
+#endif
+
+#if defined(__AVX512FP16__)
+	template <> struct simd<fp16_t, ISA_AVX512_FP16> {
+		typedef __m512h vector_t;
+		typedef __m512h acc_t;
+		enum { lanes = 32, fused = 1 };
+		static inline acc_t zero() { return _mm512_setzero_ph(); }
+		static inline vector_t load(const fp16_t* p) { return _mm512_load_ph(p); }
+		static inline void store(fp16_t* p, acc_t v) { _mm512_storeu_ph(p, v); }
+		static inline acc_t fmadd(vector_t a, vector_t b, acc_t c) { return _mm512_fmadd_ph(a, b, c); }
+	};
+#endif
+
+#if defined(__AVX512BF16__)
+	template <> struct simd<bf16_t, ISA_AVX512_BF16> {
+		typedef __m512bh vector_t;
+		typedef __m512 acc_t;
+		enum { lanes = 32, fused = 1 };
+		static inline acc_t zero() { return _mm512_setzero_ps(); }
+		static inline vector_t load(const bf16_t* p) { return (__m512bh) _mm512_load_si512(p); }
+		static inline void store(bf16_t* p, acc_t v) { _mm512_storeu_ps(p, v); }
+		static inline acc_t fmadd(vector_t a, vector_t b, acc_t c) { return _mm512_dpbf16_ps(c, a, b); }
+	};
+#endif
+
+#if defined(__AVX512VNNI__)
+	template <> struct simd<int8_t, ISA_AVX512_VNNI> {
+		typedef __m512i vector_t;
+		typedef __m512i acc_t;
+		enum { lanes = 64, fused = 1 };
+		static inline acc_t zero() { return _mm512_setzero_si512(); }
+		static inline vector_t load(const int8_t* p) { return _mm512_load_si512(p); }
+		static inline void store(int8_t* p, acc_t v) { _mm512_storeu_si512(p, v); }
+		static inline acc_t fmadd(vector_t a, vector_t b, acc_t c) { return _mm512_dpbusd_epi32(c, a, b); }
+	};
+
+	template <> struct simd<int16_t, ISA_AVX512_VNNI> {
+		typedef __m512i vector_t;
+		typedef __m512i acc_t;
+		enum { lanes = 32, fused = 1 };
+		static inline acc_t zero() { return _mm512_setzero_si512(); }
+		static inline vector_t load(const int16_t* p) { return _mm512_load_si512(p); }
+		static inline void store(int16_t* p, acc_t v) { _mm512_storeu_si512(p, v); }
+		static inline acc_t fmadd(vector_t a, vector_t b, acc_t c) { return _mm512_dpwssd_epi32(c, a, b); }
+	};
+#endif
+
+	/* ----------------------------------------------------------------- */
+	/* Compile-time unrolling: body(I) for I = BEGIN .. END-1 */
+
+	template <int BEGIN, int END> struct unroll {
+		template <typename Body>
+		static inline __attribute__((always_inline)) void run(Body& body) {
+			body(BEGIN);
+			unroll<BEGIN + 1, END>::run(body);
+		}
+	};
+
+	template <int END> struct unroll<END, END> {
+		template <typename Body>
+		static inline __attribute__((always_inline)) void run(Body&) {}
+	};
+
+	/* One multiply-add of sumsq: fused (FMA or dot product) or MUL+ADD */
+	template <int FUSED> struct mad_op {
+		template <typename S>
+		static inline __attribute__((always_inline))
+		void run(typename S::vector_t& x, typename S::acc_t& acc) {
+			acc = S::fmadd(x, x, acc);
+		}
+	};
+
+	template <> struct mad_op<0> {
+		template <typename S>
+		static inline __attribute__((always_inline))
+		void run(typename S::vector_t& x, typename S::acc_t& acc) {
+			x = S::mul(x, x);
+			acc = S::add(acc, x);
+		}
+	};
+
+	/* One multiply-add of sumsq applied to every loaded vector */
+	template <typename T, int ISA, int ACCUMULATORS>
+	struct mad_step {
+		typedef simd<T, ISA> S;
+		typename S::vector_t* x;
+		typename S::acc_t* acc;
+		inline __attribute__((always_inline)) void operator()(int i) {
+			mad_op<S::fused>::template run<S>(x[i], acc[i]);
+		}
+	};
+
+	template <typename T, int ISA>
+	struct load_step {
+		typedef simd<T, ISA> S;
+		typename S::vector_t* x;
+		const T* p;
+		inline __attribute__((always_inline)) void operator()(int i) {
+			x[i] = S::load(p + i * S::lanes);
+		}
+	};
+
+	/** \brief sumsq with compile-time shape; see the top of this file. */
+	template <typename T, int ISA, int MADS, int ACCUMULATORS>
+	void kernel(const void* data, size_t length, void* result) {
+		typedef simd<T, ISA> S;
+		const size_t step = size_t(ACCUMULATORS) * S::lanes;
+		const T* p = (const T*) data;
+		typename S::vector_t x[ACCUMULATORS];
+		typename S::acc_t acc[ACCUMULATORS];
+		for (int i = 0; i < ACCUMULATORS; i++)
+			acc[i] = S::zero();
+
+		load_step<T, ISA> load = { x, p };
+		mad_step<T, ISA, ACCUMULATORS> mad = { x, acc };
+		for (size_t n = 0; n + step <= length; n += step) {
+			load.p = p + n;
+			unroll<0, ACCUMULATORS>::run(load);
+			/* The accumulators are unrolled so that they stay in registers;
+				 the MADS rounds are a counted loop, which costs one add and
+				 branch per round instead of a copy of the body per MAD */
+			for (int m = 0; m < MADS; m++)
+				unroll<0, ACCUMULATORS>::run(mad);
+		}
+
+		/* Accumulators may be wider than the loads (F16C), so they are
+			 stored one accumulator size apart */
+		for (int i = 0; i < ACCUMULATORS; i++)
+			S::store((T*) ((uint8_t*) result + i * sizeof(acc[0])), acc[i]);
+	}
+
+	template <typename T, int ISA>
+	struct copy_step {
+		typedef simd<T, ISA> S;
+		typename S::vector_t* x;
+		typename S::acc_t* y;
+		inline __attribute__((always_inline)) void operator()(int i) {
+			y[i] = x[i];
+		}
+	};
+
+	/* Store the updated vectors of one iteration */
+	template <typename T, int ISA, int STORE>
+	struct store_step {
+		typedef simd<T, ISA> S;
+		typename S::acc_t* y;
+		T* q;
+		inline __attribute__((always_inline)) void operator()(int i) {
+			if (STORE == STORE_STREAM)
+				S::stream(q + i * S::lanes, y[i]);
+			else
+				S::store(q + i * S::lanes, y[i]);
+		}
+	};
+
+	/** \brief Streaming update: every element gets MADS multiply-adds
+	 * (y = x * x + y from y = x, or MUL+ADD) and is written to `output`.
+	 */
+	template <typename T, int ISA, int MADS, int ACCUMULATORS, int STORE>
+	void update(const void* data, size_t length, void* output) {
+		typedef simd<T, ISA> S;
+		const size_t step = size_t(ACCUMULATORS) * S::lanes;
+		const T* p = (const T*) data;
+		T* q = (T*) output;
+		typename S::vector_t x[ACCUMULATORS];
+		typename S::acc_t y[ACCUMULATORS];
+
+		load_step<T, ISA> load = { x, p };
+		mad_step<T, ISA, ACCUMULATORS> mad = { x, y };
+		copy_step<T, ISA> copy = { x, y };
+		store_step<T, ISA, STORE> store = { y, q };
+		for (size_t n = 0; n + step <= length; n += step) {
+			load.p = p + n;
+			unroll<0, ACCUMULATORS>::run(load);
+			unroll<0, ACCUMULATORS>::run(copy);
+			for (int m = 0; m < MADS; m++)
+				unroll<0, ACCUMULATORS>::run(mad);
+			store.q = q + n;
+			unroll<0, ACCUMULATORS>::run(store);
+		}
+		/* Non-temporal stores are weakly ordered */
+		if (STORE == STORE_STREAM)
+			_mm_sfence();
+	}
+
+	/* ----------------------------------------------------------------- */
+	/* Compile-time table */
+
+	/* MADs per element instantiated for every ISA, type and accumulator
+		 count; the same points ../intensity-jit sweeps by default */
+	#define INTENSITY_MADS(X, T, ISA, A) \
+		X(T, ISA, 1, A) X(T, ISA, 2, A) X(T, ISA, 3, A) X(T, ISA, 4, A) \
+		X(T, ISA, 6, A) X(T, ISA, 8, A) X(T, ISA, 12, A) X(T, ISA, 16, A) \
+		X(T, ISA, 24, A) X(T, ISA, 32, A) X(T, ISA, 48, A) X(T, ISA, 64, A) \
+		X(T, ISA, 96, A) X(T, ISA, 128, A)
+
+	#define INTENSITY_ENTRY(T, ISA, M, A) \
+		{ ISA, intensity::type_of<T>::value, M, A, int(intensity::simd<T, ISA>::lanes), \
+			&intensity::kernel<T, ISA, M, A>, intensity::STORE_NONE },
+
+	#define INTENSITY_UPDATE_ENTRY(T, ISA, M, A) \
+		{ ISA, intensity::type_of<T>::value, M, A, int(intensity::simd<T, ISA>::lanes), \
+			&intensity::update<T, ISA, M, A, intensity::STORE_REGULAR>, intensity::STORE_REGULAR }, \
+		{ ISA, intensity::type_of<T>::value, M, A, int(intensity::simd<T, ISA>::lanes), \
+			&intensity::update<T, ISA, M, A, intensity::STORE_STREAM>, intensity::STORE_STREAM },
+
+	/* 4 and 8 accumulators (8 is the asm's shape) for both precisions,
+		 read-only and with regular and non-temporal stores */
+	#define INTENSITY_TABLE(ISA) \
+		INTENSITY_MADS(INTENSITY_ENTRY, float, ISA, 4) \
+		INTENSITY_MADS(INTENSITY_ENTRY, float, ISA, 8) \
+		INTENSITY_MADS(INTENSITY_ENTRY, double, ISA, 4) \
+		INTENSITY_MADS(INTENSITY_ENTRY, double, ISA, 8) \
+		INTENSITY_MADS(INTENSITY_UPDATE_ENTRY, float, ISA, 4) \
+		INTENSITY_MADS(INTENSITY_UPDATE_ENTRY, float, ISA, 8) \
+		INTENSITY_MADS(INTENSITY_UPDATE_ENTRY, double, ISA, 4) \
+		INTENSITY_MADS(INTENSITY_UPDATE_ENTRY, double, ISA, 8)
+
+	/* 4, 8 and 16 accumulators of one element type */
+	#define INTENSITY_TYPE_TABLE(T, ISA) \
+		INTENSITY_MADS(INTENSITY_ENTRY, T, ISA, 4) \
+		INTENSITY_MADS(INTENSITY_ENTRY, T, ISA, 8) \
+		INTENSITY_MADS(INTENSITY_ENTRY, T, ISA, 16)
+
+	/* Defined in kernels-<isa>.cpp */
+	extern const entry_t table_sse[];
+	extern const size_t table_sse_size;
+	extern const entry_t table_avx[];
+	extern const size_t table_avx_size;
+	extern const entry_t table_avx2_fma[];
+	extern const size_t table_avx2_fma_size;
+	extern const entry_t table_avx512[];
+	extern const size_t table_avx512_size;
+	extern const entry_t table_avx512_fp16[];
+	extern const size_t table_avx512_fp16_size;
+	extern const entry_t table_avx512_bf16[];
+	extern const size_t table_avx512_bf16_size;
+	extern const entry_t table_avx512_vnni[];
+	extern const size_t table_avx512_vnni_size;
+
+	/** \brief Whether the running CPU can execute kernels of an ISA. */
+	inline static int supported(int isa) {
+	#if defined(__x86_64__) || defined(__i386__)
+		switch (isa) {
+			case ISA_SSE: return 1;
+			case ISA_AVX: return cpu::has_avx();
+			case ISA_AVX2_FMA: return cpu::has_avx2() && cpu::has_fma() && cpu::has_f16c();
+			case ISA_AVX512: return cpu::has_avx512f();
+			case ISA_AVX512_FP16: return cpu::has_avx512_fp16();
+			case ISA_AVX512_BF16: return cpu::has_avx512_bf16();
+			case ISA_AVX512_VNNI: return cpu::has_avx512_vnni();
+		}
+	#endif
+		return 0;
+	}
+
+	inline static const entry_t* table(int isa, size_t* size) {
+		switch (isa) {
+			case ISA_SSE: *size = table_sse_size; return table_sse;
+			case ISA_AVX: *size = table_avx_size; return table_avx;
+			case ISA_AVX2_FMA: *size = table_avx2_fma_size; return table_avx2_fma;
+			case ISA_AVX512: *size = table_avx512_size; return table_avx512;
+			case ISA_AVX512_FP16: *size = table_avx512_fp16_size; return table_avx512_fp16;
+			case ISA_AVX512_BF16: *size = table_avx512_bf16_size; return table_avx512_bf16;
+			case ISA_AVX512_VNNI: *size = table_avx512_vnni_size; return table_avx512_vnni;
+		}
+		*size = 0;
+		return NULL;
+	}
+
+	/** \brief Table entry for a kernel shape, NULL if it was not
+	 * instantiated.
+	 */
+	inline static const entry_t* select(int isa, int type, int mads, int accumulators,
+																			int store = STORE_NONE) {
+		size_t size;
+		const entry_t* entries = table(isa, &size);
+		for (size_t i = 0; i < size; i++) {
+			if (entries[i].type == type && entries[i].mads == mads &&
+					entries[i].accumulators == accumulators && entries[i].store == store)
+				return &entries[i];
+		}
+		return NULL;
+	}
+
+	/** \brief Widest ISA the running CPU supports that has kernels for an
+	 * element type; the native reduced-precision ISAs come after AVX-512,
+	 * so they win over the AVX2 widening fallback. -1 if there is none.
+	 */
+	inline static int best_isa(int type) {
+		for (int isa = ISA_COUNT - 1; isa >= ISA_SSE; isa--) {
+			if (supported(isa) && select(isa, type, 1, 8) != NULL)
+				return isa;
+		}
+		return -1;
+	}
+
+}
+
+#endif /* UBENCH_INTENSITY_H */
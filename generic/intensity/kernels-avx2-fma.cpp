@@ -0,0 +1,38 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* AVX2+FMA instantiation of the intensity kernel table (build with -mavx2 -mfma -mf16c) */
+
+#include "intensity.h"
+
+const intensity::entry_t intensity::table_avx2_fma[] = {
+	INTENSITY_TABLE(intensity::ISA_AVX2_FMA)
+	/* Reduced-precision and integer formats by conversion or widening */
+	INTENSITY_MADS(INTENSITY_ENTRY, intensity::fp16_t, intensity::ISA_AVX2_FMA, 4)
+	INTENSITY_MADS(INTENSITY_ENTRY, intensity::fp16_t, intensity::ISA_AVX2_FMA, 8)
+	INTENSITY_MADS(INTENSITY_ENTRY, intensity::bf16_t, intensity::ISA_AVX2_FMA, 4)
+	INTENSITY_MADS(INTENSITY_ENTRY, intensity::bf16_t, intensity::ISA_AVX2_FMA, 8)
+	INTENSITY_MADS(INTENSITY_ENTRY, int8_t, intensity::ISA_AVX2_FMA, 4)
+	INTENSITY_MADS(INTENSITY_ENTRY, int8_t, intensity::ISA_AVX2_FMA, 8)
+	INTENSITY_MADS(INTENSITY_ENTRY, int16_t, intensity::ISA_AVX2_FMA, 4)
+	INTENSITY_MADS(INTENSITY_ENTRY, int16_t, intensity::ISA_AVX2_FMA, 8)
+};
+
+const size_t intensity::table_avx2_fma_size =
+	sizeof(intensity::table_avx2_fma) / sizeof(intensity::table_avx2_fma[0]);
@@ -0,0 +1,32 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* AVX-512 instantiation of the intensity kernel table (build with -mavx512f) */
+
+#include "intensity.h"
+
+const intensity::entry_t intensity::table_avx512[] = {
+	INTENSITY_TABLE(intensity::ISA_AVX512)
+	/* zmm16-zmm31 leave room for 16 accumulators */
+	INTENSITY_MADS(INTENSITY_ENTRY, float, intensity::ISA_AVX512, 16)
+	INTENSITY_MADS(INTENSITY_ENTRY, double, intensity::ISA_AVX512, 16)
+};
+
+const size_t intensity::table_avx512_size =
+	sizeof(intensity::table_avx512) / sizeof(intensity::table_avx512[0]);
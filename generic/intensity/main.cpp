@@ -0,0 +1,490 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <malloc.h>
+#include <string.h>
+#include <omp.h>
+#include <atomic>
+#include "timer.h"
+#include "profile.h"
+#include "powercap.h"
+#include "tasks.h"
+#include "barrier.h"
+#include "intensity.h"
+
+/* Multiply-adds per element swept: every point in the kernel table */
+static const int default_mads[] = { 1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128 };
+
+struct options_t {
+	int type;
+	int isa;
+	int accumulators;
+	int max_mads;
+	/* Memory level the arrays live in: 1..N caches, N+1 DRAM, 0 all */
+	int level;
+	int mode;
+	int schedule;
+	/* Task size of the dynamic schedules */
+	size_t chunk_bytes;
+};
+
+/* What happens to each element after its multiply-adds:
+	 read    discarded (sumsq)
+	 update  stored back in place: read + write
+	 copy    stored to a second array: read + RFO + write
+	 stream  non-temporal store to a second array: read + write */
+enum access_t {
+	MODE_READ,
+	MODE_UPDATE,
+	MODE_COPY,
+	MODE_STREAM,
+	MODE_COUNT
+};
+
+static const char* mode_names[MODE_COUNT] = { "read", "update", "copy", "stream" };
+
+/* Bytes moved per element byte, counting the read-for-ownership of a
+	 regular store to a line that is not yet in the cache (none when the
+	 output is L1-resident) */
+static const int mode_traffic[MODE_COUNT] = { 1, 2, 3, 2 };
+
+static const int mode_store[MODE_COUNT] = {
+	intensity::STORE_NONE, intensity::STORE_REGULAR, intensity::STORE_REGULAR, intensity::STORE_STREAM
+};
+
+/* How the arrays are split between threads:
+	 static  each thread streams its own array
+	 share   chunks of all arrays, pass by pass, from one shared queue
+	 steal   each thread queues the chunks of its own array, pass by pass,
+	         in a work-stealing deque; idle threads steal from the others */
+enum schedule_t {
+	SCHEDULE_STATIC,
+	SCHEDULE_SHARE,
+	SCHEDULE_STEAL,
+	SCHEDULE_COUNT
+};
+
+static const char* schedule_names[SCHEDULE_COUNT] = { "static", "share", "steal" };
+
+#define LEVEL_ALL 0
+#define LEVEL_DRAM (PROFILE_MAX_LEVELS + 1)
+
+/* =================================================================== */
+/* Parse program input */
+void usage(int argc, char** argv, options_t* o)
+{
+	o->type = intensity::TYPE_DOUBLE;
+	o->isa = -1;
+	o->accumulators = 8;
+	o->max_mads = 128;
+	o->level = LEVEL_DRAM;
+	o->mode = MODE_READ;
+	o->schedule = SCHEDULE_STATIC;
+	o->chunk_bytes = size_t(64) << 10;
+
+	if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+		fprintf(stderr, "usage: %s [single|double|fp16|bf16|int8|int16] "
+						"[sse|avx|avx2|avx512|avx512fp16|avx512bf16|avx512vnni] [accumulators] "
+						"[max multiply-adds per element] [l1|l2|l3|dram|all] "
+						"[read|update|copy|stream] [static|share|steal] [chunk KB]\n", argv[0]);
+		exit(0);
+	}
+	if (argc > 1) {
+		o->type = -1;
+		for (int t = 0; t < intensity::TYPE_COUNT; t++) {
+			if (strcmp(argv[1], intensity::type_name(t)) == 0)
+				o->type = t;
+		}
+		if (o->type < 0) {
+			fprintf(stderr, "Unknown element type %s\n", argv[1]);
+			exit(1);
+		}
+	}
+	if (argc > 2 && strcmp(argv[2], "best") != 0) {
+		if (strcmp(argv[2], "sse") == 0)
+			o->isa = intensity::ISA_SSE;
+		else if (strcmp(argv[2], "avx") == 0)
+			o->isa = intensity::ISA_AVX;
+		else if (strcmp(argv[2], "avx2") == 0)
+			o->isa = intensity::ISA_AVX2_FMA;
+		else if (strcmp(argv[2], "avx512") == 0)
+			o->isa = intensity::ISA_AVX512;
+		else if (strcmp(argv[2], "avx512fp16") == 0)
+			o->isa = intensity::ISA_AVX512_FP16;
+		else if (strcmp(argv[2], "avx512bf16") == 0)
+			o->isa = intensity::ISA_AVX512_BF16;
+		else if (strcmp(argv[2], "avx512vnni") == 0)
+			o->isa = intensity::ISA_AVX512_VNNI;
+		else {
+			fprintf(stderr, "Unknown ISA %s\n", argv[2]);
+			exit(1);
+		}
+	}
+	if (argc > 3)
+		o->accumulators = atoi(argv[3]);
+	if (argc > 4)
+		o->max_mads = atoi(argv[4]);
+	if (argc > 5) {
+		if (strcmp(argv[5], "all") == 0)
+			o->level = LEVEL_ALL;
+		else if (strcmp(argv[5], "dram") == 0)
+			o->level = LEVEL_DRAM;
+		else if ((argv[5][0] == 'l' || argv[5][0] == 'L') && atoi(argv[5] + 1) >= 1 &&
+						 atoi(argv[5] + 1) <= PROFILE_MAX_LEVELS)
+			o->level = atoi(argv[5] + 1);
+		else {
+			fprintf(stderr, "Unknown memory level %s\n", argv[5]);
+			exit(1);
+		}
+	}
+	if (argc > 6) {
+		o->mode = -1;
+		for (int m = 0; m < MODE_COUNT; m++) {
+			if (strcmp(argv[6], mode_names[m]) == 0)
+				o->mode = m;
+		}
+		if (o->mode < 0) {
+			fprintf(stderr, "Unknown mode %s\n", argv[6]);
+			exit(1);
+		}
+	}
+	if (argc > 7) {
+		o->schedule = -1;
+		for (int s = 0; s < SCHEDULE_COUNT; s++) {
+			if (strcmp(argv[7], schedule_names[s]) == 0)
+				o->schedule = s;
+		}
+		if (o->schedule < 0) {
+			fprintf(stderr, "Unknown schedule %s\n", argv[7]);
+			exit(1);
+		}
+	}
+	if (argc > 8) {
+		o->chunk_bytes = size_t(atoi(argv[8])) << 10;
+		if (o->chunk_bytes == 0) {
+			fprintf(stderr, "Invalid chunk size %s\n", argv[8]);
+			exit(1);
+		}
+	}
+
+	/* Native reduced-precision instructions when the CPU has them,
+		 otherwise the AVX2 conversion/widening kernels */
+	if (o->isa < 0)
+		o->isa = intensity::best_isa(o->type);
+	if (o->isa < 0) {
+		fprintf(stderr, "This CPU has no %s kernels\n", intensity::type_name(o->type));
+		exit(1);
+	}
+	if (!intensity::supported(o->isa)) {
+		fprintf(stderr, "This CPU does not support %s\n", intensity::isa_name(o->isa));
+		exit(1);
+	}
+	if (intensity::select(o->isa, o->type, 1, o->accumulators, mode_store[o->mode]) == NULL) {
+		fprintf(stderr, "No %s %s %s kernels with %d accumulators\n", intensity::isa_name(o->isa),
+						intensity::type_name(o->type), mode_names[o->mode], o->accumulators);
+		exit(1);
+	}
+}
+/* =================================================================== */
+
+
+/* =================================================================== */
+/* One task of the dynamic schedules: chunk `c` of thread `owner`'s array,
+	 written where the static schedule would write it (read mode: the
+	 caller's accumulators) */
+void run_chunk(const intensity::entry_t* k, void** data, void** output, void* result, int mode,
+							 int owner, int64_t c, size_t chunk, size_t length, size_t element_bytes)
+{
+	const size_t first = size_t(c) * chunk;
+	const size_t count = first + chunk <= length ? chunk : length - first;
+	const size_t offset = first * element_bytes;
+	void* in = (uint8_t*) data[owner] + offset;
+	void* out = result;
+	if (mode == MODE_UPDATE)
+		out = in;
+	else if (mode == MODE_COPY || mode == MODE_STREAM)
+		out = (uint8_t*) output[owner] + offset;
+	k->function(in, count, out);
+}
+
+/* Chunks of one array completed so far. The dynamic schedules start on a
+	 pass of an array only once every chunk of the previous pass has completed
+	 (taken is not enough: a thief may still be running it), so two passes
+	 never touch the same lines at once */
+struct alignas(TASKS_LINE_BYTES) progress_t {
+	std::atomic<int64_t> done;
+};
+
+void wait_for(const progress_t* p, int64_t count)
+{
+	unsigned spins = 0;
+	while (p->done.load(std::memory_order_acquire) < count)
+		barrier::backoff(&spins);
+}
+
+void level_name(int level, int cache_levels, char* name, size_t size)
+{
+	if (level > cache_levels)
+		snprintf(name, size, "DRAM");
+	else
+		snprintf(name, size, "L%d", level);
+}
+/* =================================================================== */
+
+
+int main(int argc, char** argv)
+{
+	options_t o;
+	usage(argc, argv, &o);
+
+	timer::init();
+
+	const int threads = omp_get_max_threads();
+	profile::machine_t machine;
+	profile::init(&machine);
+	profile::load(&machine, profile::default_path());
+	if (o.level != LEVEL_DRAM)
+		profile::fill_caches(&machine);
+	int first_level = o.level, last_level = o.level;
+	if (o.level == LEVEL_ALL) {
+		first_level = 1;
+		last_level = machine.cache_levels + 1;
+	} else if (o.level == LEVEL_DRAM) {
+		first_level = last_level = machine.cache_levels + 1;
+	} else if (o.level > machine.cache_levels) {
+		fprintf(stderr, "This machine has %d cache levels\n", machine.cache_levels);
+		return 1;
+	}
+
+	const int store = mode_store[o.mode];
+	const int separate = o.mode == MODE_COPY || o.mode == MODE_STREAM;
+	const intensity::entry_t* first = intensity::select(o.isa, o.type, 1, o.accumulators, store);
+	const size_t element_bytes = intensity::type_bytes(o.type);
+	const size_t per_iteration = size_t(first->lanes) * size_t(first->accumulators);
+
+	/* Package energy over each measurement when RAPL is readable */
+	powercap::reading_t energy_start, energy_end;
+	const int have_energy = powercap::read("/sys", &energy_start) > 0;
+
+	fprintf(stderr, "%s, %s, %d accumulators, %d threads, %s, %s\n", intensity::type_name(o.type),
+					intensity::isa_name(o.isa), o.accumulators, threads, mode_names[o.mode],
+					schedule_names[o.schedule]);
+
+	void** data = (void**) calloc(threads, sizeof(void*));
+	void** output = (void**) calloc(threads, sizeof(void*));
+	uint64_t* ticks = (uint64_t*) calloc(threads, sizeof(uint64_t));
+	const int dynamic = o.schedule != SCHEDULE_STATIC;
+	tasks::stats_t* stats = (tasks::stats_t*) aligned_alloc(TASKS_LINE_BYTES, threads * sizeof(tasks::stats_t));
+	static tasks::shared_t shared;
+	progress_t* progress = (progress_t*) aligned_alloc(TASKS_LINE_BYTES, threads * sizeof(progress_t));
+
+	printf("Level" "\t" "MADs" "\t" "Threads" "\t" "Flop/byte" "\t" "Secs" "\t" "GB/s" "\t" "GFLOPS");
+	if (have_energy)
+		printf("\t" "Joules" "\t" "Watts" "\t" "pJ/byte");
+	if (dynamic)
+		printf("\t" "Schedule" "\t" "Tasks" "\t" "Imbalance" "\t" "Steals" "\t" "Overhead %%");
+	printf("\n");
+
+	for (int level = first_level; level <= last_level; level++) {
+		/* Each thread streams its own array, sized to fit its share of the
+			 level (DRAM: 8x the LLC) and re-read from there every pass */
+		char name[16];
+		level_name(level, machine.cache_levels, name, sizeof(name));
+		size_t bytes = profile::resident_bytes(&machine, level, threads, size_t(256) << 20);
+		/* Input and output share the level */
+		if (separate)
+			bytes /= 2;
+		size_t length = bytes / element_bytes;
+		length -= length % per_iteration;
+		if (length == 0)
+			length = per_iteration;
+		bytes = length * element_bytes;
+		/* Stream at least 1 GiB per thread per measurement, 8 GiB from the
+			 caches where a pass takes microseconds */
+		const size_t target = (level > machine.cache_levels) ? (size_t(1) << 30) : (size_t(8) << 30);
+		const size_t passes = (target + bytes - 1) / bytes;
+		const int traffic = (o.mode == MODE_COPY && level == 1) ? 2 : mode_traffic[o.mode];
+		fprintf(stderr, "%s: %zu KB per thread\n", name, bytes >> 10);
+
+		/* Dynamic schedules: the arrays in chunks of whole iterations */
+		size_t chunk = o.chunk_bytes / element_bytes;
+		chunk -= chunk % per_iteration;
+		if (chunk == 0 || chunk > length)
+			chunk = chunk == 0 ? per_iteration : length;
+		const int64_t chunks = int64_t((length + chunk - 1) / chunk);
+		tasks::pool_t pool;
+		if (o.schedule == SCHEDULE_STEAL && tasks::init(&pool, threads, chunks) != 0) {
+			fprintf(stderr, "Cannot allocate %lld-task deques\n", (long long) chunks);
+			return 1;
+		}
+
+		#pragma omp parallel num_threads(threads)
+		{
+			const int tid = omp_get_thread_num();
+			/* First touch from the thread that uses the array */
+			data[tid] = memalign(64, bytes);
+			memset(data[tid], 0, bytes);
+			uint8_t result[16 * 64] __attribute__((aligned(64)));
+			/* Updated elements go back in place, to a second array, or (read)
+				 only the accumulators to `result` */
+			void* out = result;
+			if (o.mode == MODE_UPDATE)
+				out = data[tid];
+			if (separate) {
+				output[tid] = memalign(64, bytes);
+				memset(output[tid], 0, bytes);
+				out = output[tid];
+			}
+
+			for (size_t i = 0; i < sizeof(default_mads) / sizeof(default_mads[0]); i++) {
+				if (default_mads[i] > o.max_mads)
+					break;
+				const intensity::entry_t* k = intensity::select(o.isa, o.type, default_mads[i],
+																											 o.accumulators, store);
+
+				/* One untimed pass brings a cache-sized array back into its level */
+				k->function(data[tid], length, out);
+				memset(&stats[tid], 0, sizeof(stats[tid]));
+				#pragma omp barrier
+				#pragma omp single
+				{
+					for (int t = 0; t < threads; t++)
+						progress[t].done.store(0, std::memory_order_relaxed);
+					if (o.schedule == SCHEDULE_SHARE)
+						tasks::reset(&shared, int64_t(passes) * threads * chunks);
+					else if (o.schedule == SCHEDULE_STEAL)
+						tasks::reset(&pool, threads);
+					if (have_energy)
+						powercap::read("/sys", &energy_start);
+				}
+				const uint64_t start = timer::get_ticks_acquire();
+				if (o.schedule == SCHEDULE_STATIC) {
+					for (size_t pass = 0; pass < passes; pass++)
+						k->function(data[tid], length, out);
+				} else if (o.schedule == SCHEDULE_SHARE) {
+					/* Task = (pass, array, chunk), in that order of significance */
+					for (;;) {
+						const uint64_t s0 = timer::get_ticks_acquire();
+						const int64_t task = tasks::take(&shared, &stats[tid]);
+						const int owner = int((task / chunks) % threads);
+						if (task >= 0)
+							wait_for(&progress[owner], task / (int64_t(threads) * chunks) * chunks);
+						stats[tid].ticks += timer::elapsed_ticks(s0, timer::get_ticks_release());
+						if (task < 0)
+							break;
+						run_chunk(k, data, output, result, o.mode, owner, task % chunks, chunk, length,
+											element_bytes);
+						progress[owner].done.fetch_add(1, std::memory_order_release);
+					}
+				} else {
+					/* Task = (array, chunk); the owner queues a pass once every
+						 chunk of the previous one, stolen ones included, is done */
+					tasks::deque_t* own = &pool.deques[tid];
+					for (size_t pass = 0; pass < passes; pass++) {
+						uint64_t s0 = timer::get_ticks_acquire();
+						wait_for(&progress[tid], int64_t(pass) * chunks);
+						for (int64_t c = chunks - 1; c >= 0; c--)
+							tasks::push(own, int64_t(tid) * chunks + c);
+						for (;;) {
+							const int64_t task = tasks::pop(own);
+							stats[tid].ticks += timer::elapsed_ticks(s0, timer::get_ticks_release());
+							if (task < 0)
+								break;
+							stats[tid].tasks++;
+							run_chunk(k, data, output, result, o.mode, tid, task % chunks, chunk,
+												length, element_bytes);
+							progress[tid].done.fetch_add(1, std::memory_order_release);
+							s0 = timer::get_ticks_acquire();
+						}
+					}
+					tasks::done_producing(&pool);
+					for (;;) {
+						const uint64_t s0 = timer::get_ticks_acquire();
+						const int64_t task = tasks::next(&pool, tid, &stats[tid]);
+						stats[tid].ticks += timer::elapsed_ticks(s0, timer::get_ticks_release());
+						if (task < 0)
+							break;
+						run_chunk(k, data, output, result, o.mode, int(task / chunks), task % chunks,
+											chunk, length, element_bytes);
+						progress[task / chunks].done.fetch_add(1, std::memory_order_release);
+					}
+				}
+				const uint64_t end = timer::get_ticks_release();
+				ticks[tid] = timer::elapsed_ticks(start, end);
+
+				#pragma omp barrier
+				#pragma omp single
+				{
+					if (have_energy)
+						powercap::read("/sys", &energy_end);
+					uint64_t slowest = 0;
+					for (int t = 0; t < threads; t++)
+						slowest = ticks[t] > slowest ? ticks[t] : slowest;
+					const double secs = timer::ticks_to_secs(slowest);
+					const double total_bytes = double(bytes) * double(passes) * threads * traffic;
+					/* Multiply and add per element per MAD for every type, so the
+						 reduced-precision and integer rows read as ops/byte and ops/s */
+					const double flops = 2.0 * double(length) * double(passes) * k->mads * threads;
+					printf("%s" "\t" "%d" "\t" "%d" "\t" "%4.03lf" "\t" "%4.06lf" "\t" "%4.03lf" "\t" "%4.03lf",
+								 name, k->mads, threads, flops / total_bytes, secs,
+								 total_bytes / secs / 1.0e+9, flops / secs / 1.0e+9);
+					if (have_energy) {
+						/* pJ/byte is the whole package energy over the bytes moved;
+							 roofline-fit separates the flop and constant parts */
+						const double joules = powercap::joules(&energy_start, &energy_end);
+						printf("\t" "%4.03lf" "\t" "%4.03lf" "\t" "%4.03lf", joules, joules / secs,
+									 joules / total_bytes * 1.0e+12);
+					}
+					if (dynamic) {
+						/* Slowest thread over the mean, and the share of the threads'
+							 time spent getting tasks */
+						double busy = 0.0, scheduling = 0.0;
+						int64_t steals = 0;
+						for (int t = 0; t < threads; t++) {
+							busy += timer::ticks_to_secs(ticks[t]);
+							scheduling += timer::ticks_to_secs(stats[t].ticks);
+							steals += stats[t].steals;
+						}
+						printf("\t" "%s" "\t" "%lld" "\t" "%4.03lf" "\t" "%lld" "\t" "%4.02lf",
+									 schedule_names[o.schedule], (long long) (chunks * threads),
+									 busy > 0.0 ? secs / (busy / threads) : 1.0, (long long) steals,
+									 busy > 0.0 ? 100.0 * scheduling / busy : 0.0);
+					}
+					printf("\n");
+					fflush(stdout);
+				}
+			}
+			free(data[tid]);
+			free(output[tid]);
+		}
+		if (o.schedule == SCHEDULE_STEAL)
+			tasks::destroy(&pool);
+	}
+
+	free(stats);
+	free(progress);
+	free(data);
+	free(output);
+	free(ticks);
+	return 0;
+}
@@ -0,0 +1,33 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* SSE instantiation of the polynomial kernel tables (build with -msse2) */
+
+#include "polynomial.h"
+
+const polynomial::entry_t polynomial::table_sse[] = {
+	POLYNOMIAL_TABLE(intensity::ISA_SSE)
+};
+
+const size_t polynomial::table_sse_size =
+	sizeof(polynomial::table_sse) / sizeof(polynomial::table_sse[0]);
+
+const polynomial::ceiling_entry_t polynomial::ceilings_sse[POLYNOMIAL_CEILINGS] = {
+	POLYNOMIAL_CEILING_TABLE(intensity::ISA_SSE, 12)
+};
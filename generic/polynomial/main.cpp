@@ -0,0 +1,277 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <malloc.h>
+#include <string.h>
+#include <omp.h>
+#include "timer.h"
+#include "profile.h"
+#include "polynomial.h"
+
+/* Degrees swept, up to the requested maximum */
+static const int default_degrees[] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+
+/* Multiply-adds per chain when measuring the ceilings */
+#define CEILING_STEPS (size_t(1) << 24)
+
+struct options_t {
+	int type;
+	int isa;
+	int scheme;
+	int max_degree;
+};
+
+/* =================================================================== */
+/* Parse program input */
+void usage(int argc, char** argv, options_t* o)
+{
+	o->type = intensity::TYPE_DOUBLE;
+	o->isa = -1;
+	o->scheme = -1;
+	o->max_degree = 64;
+
+	if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+		fprintf(stderr, "usage: %s [single|double] [best|sse|avx|avx2|avx512] [horner|estrin|all] "
+						"[max degree]\n", argv[0]);
+		exit(0);
+	}
+	if (argc > 1)
+		o->type = strcmp(argv[1], "single") == 0 ? intensity::TYPE_FLOAT : intensity::TYPE_DOUBLE;
+	if (argc > 2 && strcmp(argv[2], "best") != 0) {
+		if (strcmp(argv[2], "sse") == 0)
+			o->isa = intensity::ISA_SSE;
+		else if (strcmp(argv[2], "avx") == 0)
+			o->isa = intensity::ISA_AVX;
+		else if (strcmp(argv[2], "avx2") == 0)
+			o->isa = intensity::ISA_AVX2_FMA;
+		else if (strcmp(argv[2], "avx512") == 0)
+			o->isa = intensity::ISA_AVX512;
+		else {
+			fprintf(stderr, "Unknown ISA %s\n", argv[2]);
+			exit(1);
+		}
+	}
+	if (argc > 3 && strcmp(argv[3], "all") != 0) {
+		for (int s = 0; s < polynomial::SCHEME_COUNT; s++) {
+			if (strcmp(argv[3], polynomial::scheme_name(s)) == 0)
+				o->scheme = s;
+		}
+		if (o->scheme < 0) {
+			fprintf(stderr, "Unknown scheme %s\n", argv[3]);
+			exit(1);
+		}
+	}
+	if (argc > 4)
+		o->max_degree = atoi(argv[4]);
+
+	if (o->isa < 0) {
+		o->isa = intensity::ISA_SSE;
+		for (int isa = intensity::ISA_AVX512; isa > intensity::ISA_SSE; isa--) {
+			if (intensity::supported(isa)) {
+				o->isa = isa;
+				break;
+			}
+		}
+	}
+	if (!intensity::supported(o->isa)) {
+		fprintf(stderr, "This CPU does not support %s\n", intensity::isa_name(o->isa));
+		exit(1);
+	}
+	if (o->max_degree < 1) {
+		fprintf(stderr, "Degree must be at least 1\n");
+		exit(1);
+	}
+}
+/* =================================================================== */
+
+
+/* =================================================================== */
+/* Coefficients c0 .. c<degree> = 1.0 as in polevl, each broadcast to a
+	 vector; ESTRIN gets zero high-order coefficients up to a multiple of 4 */
+int padded_degree(int scheme, int degree)
+{
+	if (scheme != polynomial::SCHEME_ESTRIN)
+		return degree;
+	return (degree + 4) / 4 * 4 - 1;
+}
+
+void fill_coefficients(void* c, int is_double, int lanes, int degree, int padded)
+{
+	for (int k = 0; k <= padded; k++) {
+		for (int l = 0; l < lanes; l++) {
+			const double v = k <= degree ? 1.0 : 0.0;
+			if (is_double)
+				((double*) c)[k * lanes + l] = v;
+			else
+				((float*) c)[k * lanes + l] = float(v);
+		}
+	}
+}
+/* =================================================================== */
+
+
+/* =================================================================== */
+/* GFLOPS of a ceiling kernel on all threads at once */
+double measure_ceiling(const polynomial::ceiling_entry_t* k, int threads, int is_double)
+{
+	uint64_t* ticks = (uint64_t*) calloc(threads, sizeof(uint64_t));
+	#pragma omp parallel num_threads(threads)
+	{
+		const int tid = omp_get_thread_num();
+		uint8_t xc[2 * 64] __attribute__((aligned(64)));
+		uint8_t result[32 * 64] __attribute__((aligned(64)));
+		fill_coefficients(xc, is_double, k->lanes, 1, 1);
+		/* x = 0.5 keeps the chains bounded: acc -> c / (1 - x) */
+		for (int l = 0; l < k->lanes; l++) {
+			if (is_double)
+				((double*) xc)[l] = 0.5;
+			else
+				((float*) xc)[l] = 0.5f;
+		}
+		k->function(CEILING_STEPS / 16, xc, result);
+		#pragma omp barrier
+		const uint64_t start = timer::get_ticks_acquire();
+		k->function(CEILING_STEPS, xc, result);
+		const uint64_t end = timer::get_ticks_release();
+		ticks[tid] = timer::elapsed_ticks(start, end);
+	}
+	uint64_t slowest = 0;
+	for (int t = 0; t < threads; t++)
+		slowest = ticks[t] > slowest ? ticks[t] : slowest;
+	free(ticks);
+	const double flops = 2.0 * double(CEILING_STEPS) * k->chains * k->lanes * threads;
+	return flops / timer::ticks_to_secs(slowest) / 1.0e+9;
+}
+/* =================================================================== */
+
+
+int main(int argc, char** argv)
+{
+	options_t o;
+	usage(argc, argv, &o);
+	const int is_double = o.type == intensity::TYPE_DOUBLE;
+
+	timer::init();
+
+	/* Latency-bound (1 chain) and throughput-bound ceilings, all threads */
+	const int threads = omp_get_max_threads();
+	const polynomial::ceiling_entry_t* latency = polynomial::select_ceiling(o.isa, o.type, 0);
+	const polynomial::ceiling_entry_t* throughput = polynomial::select_ceiling(o.isa, o.type, 1);
+	const double latency_gflops = measure_ceiling(latency, threads, is_double);
+	const double peak_gflops = measure_ceiling(throughput, threads, is_double);
+	fprintf(stderr, "%s, %s, %d threads\n", intensity::type_name(o.type),
+					intensity::isa_name(o.isa), threads);
+	fprintf(stderr, "Latency-bound ceiling:    %4.03lf GFLOPS (1 chain per thread, %d threads)\n",
+					latency_gflops, threads);
+	fprintf(stderr, "Throughput-bound ceiling: %4.03lf GFLOPS (%d chains per thread, %d threads)\n",
+					peak_gflops, throughput->chains, threads);
+
+	/* Each thread evaluates its own DRAM-resident array of x */
+	profile::machine_t machine;
+	profile::init(&machine);
+	profile::load(&machine, profile::default_path());
+	const size_t element_bytes = intensity::type_bytes(o.type);
+	size_t bytes = profile::resident_bytes(&machine, machine.cache_levels + 1, threads,
+																				 size_t(64) << 20);
+	size_t length = bytes / element_bytes;
+	/* A multiple of every kernel's step: 16 chains of 16 lanes */
+	length -= length % 256;
+	bytes = length * element_bytes;
+
+	void** data = (void**) calloc(threads, sizeof(void*));
+	uint64_t* ticks = (uint64_t*) calloc(threads, sizeof(uint64_t));
+	void* coefficients = memalign(64, size_t(default_degrees[7] + 4) * 64);
+
+	printf("Scheme" "\t" "Chains" "\t" "Degree" "\t" "Threads" "\t" "Flop/byte" "\t" "Secs" "\t"
+				 "GB/s" "\t" "GFLOPS" "\t" "Latency bound" "\t" "Throughput bound" "\n");
+
+	size_t size;
+	const polynomial::entry_t* entries = polynomial::table(o.isa, &size);
+
+	#pragma omp parallel num_threads(threads)
+	{
+		const int tid = omp_get_thread_num();
+		/* First touch from the thread that uses the array */
+		data[tid] = memalign(64, bytes);
+		for (size_t i = 0; i < length; i++) {
+			if (is_double)
+				((double*) data[tid])[i] = 0.5;
+			else
+				((float*) data[tid])[i] = 0.5f;
+		}
+		uint8_t result[16 * 64] __attribute__((aligned(64)));
+
+		for (size_t e = 0; e < size; e++) {
+			const polynomial::entry_t* k = &entries[e];
+			if (k->type != o.type || (o.scheme >= 0 && k->scheme != o.scheme))
+				continue;
+			for (size_t d = 0; d < sizeof(default_degrees) / sizeof(default_degrees[0]); d++) {
+				const int degree = default_degrees[d];
+				if (degree > o.max_degree)
+					break;
+				const int padded = padded_degree(k->scheme, degree);
+				/* About 1 GiB of x per thread at degree 1, less as the work grows */
+				size_t passes = (size_t(1) << 30) / bytes / size_t(degree);
+				passes = passes > 0 ? passes : 1;
+
+				#pragma omp single
+				fill_coefficients(coefficients, is_double, k->lanes, degree, padded);
+
+				const uint64_t start = timer::get_ticks_acquire();
+				for (size_t pass = 0; pass < passes; pass++)
+					k->function(data[tid], length, coefficients, padded, result);
+				const uint64_t end = timer::get_ticks_release();
+				ticks[tid] = timer::elapsed_ticks(start, end);
+
+				#pragma omp barrier
+				#pragma omp single
+				{
+					uint64_t slowest = 0;
+					for (int t = 0; t < threads; t++)
+						slowest = ticks[t] > slowest ? ticks[t] : slowest;
+					const double secs = timer::ticks_to_secs(slowest);
+					const double total_bytes = double(bytes) * double(passes) * threads;
+					/* 2 * degree flops per element, as polevl counts them */
+					const double flops = 2.0 * double(length) * double(passes) * degree * threads;
+					/* Independent chains in flight hide the latency until the
+						 throughput ceiling is reached */
+					const int in_flight = k->chains * polynomial::scheme_ways(k->scheme);
+					double bound = latency_gflops * in_flight;
+					bound = bound < peak_gflops ? bound : peak_gflops;
+					printf("%s" "\t" "%d" "\t" "%d" "\t" "%d" "\t" "%4.03lf" "\t" "%4.06lf" "\t"
+								 "%4.03lf" "\t" "%4.03lf" "\t" "%4.03lf" "\t" "%4.03lf" "\n",
+								 polynomial::scheme_name(k->scheme), k->chains, degree, threads,
+								 flops / total_bytes, secs, total_bytes / secs / 1.0e+9,
+								 flops / secs / 1.0e+9, bound, peak_gflops);
+					fflush(stdout);
+				}
+			}
+		}
+		free(data[tid]);
+	}
+
+	free(coefficients);
+	free(data);
+	free(ticks);
+	return 0;
+}
@@ -0,0 +1,316 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Runtime-degree polynomial kernels.
+
+	 Counterpart of polevl in ../../cpu/intel/nehalem/i7-950/polynomial.*.asm,
+	 whose degree (POLYNOMIAL_POWER) is fixed at assembly time. Here the
+	 degree is an argument and the shape is a template on element type, ISA
+	 (the vector traits of ../intensity/intensity.h) and number of
+	 independent chains:
+
+		 SCHEME_HORNER  p = c[n]; p = p * x + c[k] for k = n-1 .. 0
+		                One dependent chain per vector: with 1 chain the
+		                kernel runs at the multiply-add latency, with enough
+		                chains (polevl interleaves 10) at its throughput.
+		 SCHEME_ESTRIN  Estrin's tree on the top two levels and Horner in
+		                x^4 below them:
+		                  p = (q0 + x q1) + x^2 (q2 + x q3),  qj = Horner in
+		                  x^4 over c[4i + j]
+		                Four independent chains per vector for 2 extra
+		                multiplies (x^2, x^4) and a depth of about n/4 + 3.
+
+	 Each chain loads one vector of x, evaluates the polynomial and adds the
+	 value into a per-chain sum that is stored to `result` (polevl discards
+	 its results; the sum keeps the compiler from doing the same). Only the
+	 2 * n flops of the polynomial are counted, as for polevl.
+
+	 Coefficients are passed pre-broadcast: coefficient k is `lanes` copies
+	 starting at element k * lanes. ESTRIN needs (degree + 1) to be a
+	 multiple of 4; pad with zero high-order coefficients.
+
+	 The ceiling kernel runs CHAINS register-resident chains of
+	 acc = acc * x + c with no memory traffic. One chain measures the
+	 multiply-add latency, many chains its throughput; together they bound
+	 every polynomial kernel from above.
+ */
+
+#ifndef UBENCH_POLYNOMIAL_H
+#define UBENCH_POLYNOMIAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "intensity.h"
+
+namespace polynomial {
+
+	enum scheme_t {
+		SCHEME_HORNER,
+		SCHEME_ESTRIN,
+		SCHEME_COUNT
+	};
+
+	inline static const char* scheme_name(int scheme) {
+		switch (scheme) {
+			case SCHEME_HORNER: return "horner";
+			case SCHEME_ESTRIN: return "estrin";
+			default: return "?";
+		}
+	}
+
+	/* Independent polynomial chains per vector of x */
+	inline static int scheme_ways(int scheme) {
+		return scheme == SCHEME_ESTRIN ? 4 : 1;
+	}
+
+	typedef void (*function_t)(const void* data, size_t length, const void* coefficients,
+														 int degree, void* result);
+	typedef void (*ceiling_t)(size_t steps, const void* coefficients, void* result);
+
+	struct entry_t {
+		int isa;
+		int type;
+		int scheme;
+		int chains;
+		int lanes;
+		function_t function;
+	};
+
+	struct ceiling_entry_t {
+		int isa;
+		int type;
+		int chains;
+		int lanes;
+		ceiling_t function;
+	};
+
+	/* ----------------------------------------------------------------- */
+	/* Kernels */
+
+	template <typename S>
+	static inline __attribute__((always_inline))
+	typename S::vector_t mad(typename S::vector_t a, typename S::vector_t b, typename S::vector_t c) {
+		return S::fmadd(a, b, c);
+	}
+
+	/* The chain loops below go through intensity::unroll so that the
+		 per-chain arrays are indexed by constants and stay in registers */
+
+	/** \brief Horner's rule on CHAINS vectors at a time. */
+	template <typename T, int ISA, int CHAINS>
+	void horner(const void* data, size_t length, const void* coefficients, int degree, void* result) {
+		typedef intensity::simd<T, ISA> S;
+		typedef typename S::vector_t V;
+		const size_t step = size_t(CHAINS) * S::lanes;
+		const T* p = (const T*) data;
+		const T* c = (const T*) coefficients;
+		V sum[CHAINS], x[CHAINS], y[CHAINS];
+		for (int i = 0; i < CHAINS; i++)
+			sum[i] = S::zero();
+
+		for (size_t n = 0; n + step <= length; n += step) {
+			const V top = S::load(c + size_t(degree) * S::lanes);
+			const T* pn = p + n;
+			auto start = [&](int i) { x[i] = S::load(pn + i * S::lanes); y[i] = top; };
+			intensity::unroll<0, CHAINS>::run(start);
+			for (int k = degree - 1; k >= 0; k--) {
+				const V ck = S::load(c + size_t(k) * S::lanes);
+				auto step_k = [&](int i) { y[i] = mad<S>(y[i], x[i], ck); };
+				intensity::unroll<0, CHAINS>::run(step_k);
+			}
+			auto accumulate = [&](int i) { sum[i] = S::add(sum[i], y[i]); };
+			intensity::unroll<0, CHAINS>::run(accumulate);
+		}
+
+		for (int i = 0; i < CHAINS; i++)
+			S::store((T*) result + i * S::lanes, sum[i]);
+	}
+
+	/** \brief Estrin top levels over Horner in x^4, CHAINS vectors at a
+	 * time.
+	 */
+	template <typename T, int ISA, int CHAINS>
+	void estrin(const void* data, size_t length, const void* coefficients, int degree, void* result) {
+		typedef intensity::simd<T, ISA> S;
+		typedef typename S::vector_t V;
+		const size_t step = size_t(CHAINS) * S::lanes;
+		const T* p = (const T*) data;
+		const T* c = (const T*) coefficients;
+		const int quads = (degree + 1) / 4;
+		V sum[CHAINS], x[CHAINS], x2[CHAINS], x4[CHAINS];
+		V q0[CHAINS], q1[CHAINS], q2[CHAINS], q3[CHAINS];
+		for (int i = 0; i < CHAINS; i++)
+			sum[i] = S::zero();
+
+		for (size_t n = 0; n + step <= length; n += step) {
+			const T* top = c + size_t(quads - 1) * 4 * S::lanes;
+			const T* pn = p + n;
+			auto start = [&](int i) {
+				x[i] = S::load(pn + i * S::lanes);
+				x2[i] = S::mul(x[i], x[i]);
+				x4[i] = S::mul(x2[i], x2[i]);
+				q0[i] = S::load(top);
+				q1[i] = S::load(top + S::lanes);
+				q2[i] = S::load(top + 2 * S::lanes);
+				q3[i] = S::load(top + 3 * S::lanes);
+			};
+			intensity::unroll<0, CHAINS>::run(start);
+			for (int k = quads - 2; k >= 0; k--) {
+				const T* ck = c + size_t(k) * 4 * S::lanes;
+				const V c0 = S::load(ck);
+				const V c1 = S::load(ck + S::lanes);
+				const V c2 = S::load(ck + 2 * S::lanes);
+				const V c3 = S::load(ck + 3 * S::lanes);
+				auto step_k = [&](int i) {
+					q0[i] = mad<S>(q0[i], x4[i], c0);
+					q1[i] = mad<S>(q1[i], x4[i], c1);
+					q2[i] = mad<S>(q2[i], x4[i], c2);
+					q3[i] = mad<S>(q3[i], x4[i], c3);
+				};
+				intensity::unroll<0, CHAINS>::run(step_k);
+			}
+			auto finish = [&](int i) {
+				const V low = mad<S>(q1[i], x[i], q0[i]);
+				const V high = mad<S>(q3[i], x[i], q2[i]);
+				sum[i] = S::add(sum[i], mad<S>(high, x2[i], low));
+			};
+			intensity::unroll<0, CHAINS>::run(finish);
+		}
+
+		for (int i = 0; i < CHAINS; i++)
+			S::store((T*) result + i * S::lanes, sum[i]);
+	}
+
+	/** \brief `steps` multiply-adds on each of CHAINS register-resident
+	 * chains; coefficients holds the x vector then the c vector.
+	 */
+	template <typename T, int ISA, int CHAINS>
+	void ceiling(size_t steps, const void* coefficients, void* result) {
+		typedef intensity::simd<T, ISA> S;
+		typedef typename S::vector_t V;
+		const V x = S::load((const T*) coefficients);
+		const V c = S::load((const T*) coefficients + S::lanes);
+		V acc[CHAINS];
+		for (int i = 0; i < CHAINS; i++)
+			acc[i] = c;
+		auto step = [&](int i) { acc[i] = mad<S>(acc[i], x, c); };
+		for (size_t n = 0; n < steps; n++)
+			intensity::unroll<0, CHAINS>::run(step);
+		for (int i = 0; i < CHAINS; i++)
+			S::store((T*) result + i * S::lanes, acc[i]);
+	}
+
+	/* ----------------------------------------------------------------- */
+	/* Compile-time tables */
+
+	#define POLYNOMIAL_ENTRY(T, ISA, SCHEME, KERNEL, C) \
+		{ ISA, intensity::type_of<T>::value, SCHEME, C, int(intensity::simd<T, ISA>::lanes), \
+			&polynomial::KERNEL<T, ISA, C> },
+
+	#define POLYNOMIAL_CHAINS(T, ISA) \
+		POLYNOMIAL_ENTRY(T, ISA, polynomial::SCHEME_HORNER, horner, 1) \
+		POLYNOMIAL_ENTRY(T, ISA, polynomial::SCHEME_HORNER, horner, 2) \
+		POLYNOMIAL_ENTRY(T, ISA, polynomial::SCHEME_HORNER, horner, 4) \
+		POLYNOMIAL_ENTRY(T, ISA, polynomial::SCHEME_HORNER, horner, 8) \
+		POLYNOMIAL_ENTRY(T, ISA, polynomial::SCHEME_ESTRIN, estrin, 1) \
+		POLYNOMIAL_ENTRY(T, ISA, polynomial::SCHEME_ESTRIN, estrin, 2) \
+		POLYNOMIAL_ENTRY(T, ISA, polynomial::SCHEME_ESTRIN, estrin, 4)
+
+	#define POLYNOMIAL_TABLE(ISA) \
+		POLYNOMIAL_CHAINS(float, ISA) \
+		POLYNOMIAL_CHAINS(double, ISA)
+
+	#define POLYNOMIAL_CEILING_ENTRY(T, ISA, C) \
+		{ ISA, intensity::type_of<T>::value, C, int(intensity::simd<T, ISA>::lanes), \
+			&polynomial::ceiling<T, ISA, C> },
+
+	/* 1 chain for the latency; THROUGHPUT_CHAINS must cover latency x
+		 throughput (4 or 5 cycles x 2 multiply-adds per cycle) and fit in the
+		 register file: 12 of 16 registers, 24 of 32 on AVX-512 */
+	#define POLYNOMIAL_CEILING_TABLE(ISA, THROUGHPUT_CHAINS) \
+		POLYNOMIAL_CEILING_ENTRY(float, ISA, 1) \
+		POLYNOMIAL_CEILING_ENTRY(float, ISA, THROUGHPUT_CHAINS) \
+		POLYNOMIAL_CEILING_ENTRY(double, ISA, 1) \
+		POLYNOMIAL_CEILING_ENTRY(double, ISA, THROUGHPUT_CHAINS)
+
+	/* Defined in kernels-<isa>.cpp */
+	extern const entry_t table_sse[];
+	extern const size_t table_sse_size;
+	extern const entry_t table_avx[];
+	extern const size_t table_avx_size;
+	extern const entry_t table_avx2_fma[];
+	extern const size_t table_avx2_fma_size;
+	extern const entry_t table_avx512[];
+	extern const size_t table_avx512_size;
+	extern const ceiling_entry_t ceilings_sse[];
+	extern const ceiling_entry_t ceilings_avx[];
+	extern const ceiling_entry_t ceilings_avx2_fma[];
+	extern const ceiling_entry_t ceilings_avx512[];
+	/* Every ceiling table has POLYNOMIAL_CEILINGS entries */
+	#define POLYNOMIAL_CEILINGS 4
+
+	inline static const entry_t* table(int isa, size_t* size) {
+		switch (isa) {
+			case intensity::ISA_SSE: *size = table_sse_size; return table_sse;
+			case intensity::ISA_AVX: *size = table_avx_size; return table_avx;
+			case intensity::ISA_AVX2_FMA: *size = table_avx2_fma_size; return table_avx2_fma;
+			case intensity::ISA_AVX512: *size = table_avx512_size; return table_avx512;
+		}
+		*size = 0;
+		return NULL;
+	}
+
+	/** \brief Table entry for a kernel shape, NULL if it was not
+	 * instantiated.
+	 */
+	inline static const entry_t* select(int isa, int type, int scheme, int chains) {
+		size_t size;
+		const entry_t* entries = table(isa, &size);
+		for (size_t i = 0; i < size; i++) {
+			if (entries[i].type == type && entries[i].scheme == scheme &&
+					entries[i].chains == chains)
+				return &entries[i];
+		}
+		return NULL;
+	}
+
+	/** \brief Latency (1 chain) or throughput (most chains) ceiling kernel. */
+	inline static const ceiling_entry_t* select_ceiling(int isa, int type, int throughput) {
+		const ceiling_entry_t* entries;
+		switch (isa) {
+			case intensity::ISA_SSE: entries = ceilings_sse; break;
+			case intensity::ISA_AVX: entries = ceilings_avx; break;
+			case intensity::ISA_AVX2_FMA: entries = ceilings_avx2_fma; break;
+			case intensity::ISA_AVX512: entries = ceilings_avx512; break;
+			default: return NULL;
+		}
+		const ceiling_entry_t* found = NULL;
+		for (int i = 0; i < POLYNOMIAL_CEILINGS; i++) {
+			if (entries[i].type != type)
+				continue;
+			if (found == NULL || (throughput ? entries[i].chains > found->chains
+																			 : entries[i].chains < found->chains))
+				found = &entries[i];
+		}
+		return found;
+	}
+
+}
+
+#endif /* UBENCH_POLYNOMIAL_H */
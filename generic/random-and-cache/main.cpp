@@ -21,12 +21,16 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <stddef.h>
 #include <stdint.h>
 #include <malloc.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <time.h>
 #ifndef __ANDROID__
 	#include <omp.h>
 #endif
+#include "timer.h"
+#include "profile.h"
+#include "counters.h"
 
 class XorShift {
 public:
@@ -199,14 +203,104 @@ private:
 	uint32_t bits;
 };
 
-namespace timer {
-	
-	inline static uint64_t get_nsecs() {
-		struct timespec ts;
-		clock_gettime(CLOCK_MONOTONIC, &ts);
-		return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+/* Access pattern of the parameterised cache-random kernel.
+	 The array is walked region by region. Within a region, `loads` 32-bit
+	 loads touch `lines` cache lines spread evenly over the region, in an
+	 order given by one of `permutations` random permutations; the
+	 permutation changes from region to region so that no fixed offset
+	 sequence repeats for a prefetcher to learn. The defaults (2 KiB, 32
+	 lines, 512 loads) reproduce the hand-written 2KRandom kernels. */
+class CacheRandomPattern {
+public:
+	/* Offsets are 16-bit and packed four per word */
+	static const size_t max_region_bytes = 1u << 16;
+	static const size_t line_bytes = 64;
+
+	CacheRandomPattern(size_t region_bytes, size_t lines, size_t loads, uint32_t permutation_bits, uint32_t seed) {
+		assert(region_bytes >= line_bytes && region_bytes <= max_region_bytes);
+		assert((region_bytes & (region_bytes - 1)) == 0);
+		assert(lines >= 1 && lines <= region_bytes / line_bytes);
+		assert(loads >= 4 && loads % 4 == 0);
+		assert(permutation_bits <= 8);
+		this->region_bytes = region_bytes;
+		this->lines = lines;
+		this->loads = loads;
+		this->permutation_bits = permutation_bits;
+		this->offsets = (uint64_t*) memalign(64, (loads / 4) * sizeof(uint64_t) << permutation_bits);
+
+		/* Loads go round-robin over the chosen lines, moving to the next
+			 32-bit word of each line on every pass */
+		const size_t region_lines = region_bytes / line_bytes;
+		const size_t words_per_line = line_bytes / sizeof(uint32_t);
+		uint16_t* order = (uint16_t*) malloc(loads * sizeof(uint16_t));
+		uint32_t state = seed | 1u;
+		for (size_t p = 0; p < (size_t(1) << permutation_bits); p++) {
+			for (size_t i = 0; i < loads; i++) {
+				const size_t line = (i % lines) * region_lines / lines;
+				const size_t word = (i / lines) % words_per_line;
+				order[i] = uint16_t(line * line_bytes + word * sizeof(uint32_t));
+			}
+			/* Fisher-Yates shuffle */
+			for (size_t i = loads - 1; i > 0; i--) {
+				state ^= state << 13;
+				state ^= state >> 17;
+				state ^= state << 5;
+				const size_t j = state % (i + 1);
+				const uint16_t t = order[i];
+				order[i] = order[j];
+				order[j] = t;
+			}
+			uint64_t* packed = this->offsets + p * (loads / 4);
+			for (size_t i = 0; i < loads; i += 4) {
+				packed[i / 4] = uint64_t(order[i]) | (uint64_t(order[i + 1]) << 16) |
+					(uint64_t(order[i + 2]) << 32) | (uint64_t(order[i + 3]) << 48);
+			}
+		}
+		free(order);
+	}
+
+	~CacheRandomPattern() {
+		free(this->offsets);
+	}
+
+	/* Offsets for the given region: a multiplicative hash of the region
+		 index picks the permutation */
+	inline const uint64_t* region_offsets(size_t region) const {
+		const uint32_t hash = uint32_t(region) * 2654435761u;
+		const size_t p = this->permutation_bits == 0 ? 0 : hash >> (32 - this->permutation_bits);
+		return this->offsets + p * (this->loads / 4);
 	}
 
+	size_t region_bytes;
+	size_t lines;
+	size_t loads;
+	uint32_t permutation_bits;
+
+private:
+	uint64_t* offsets;
+};
+
+/* Keeps a loaded value alive without spending an instruction on it */
+#define UBENCH_KEEP(value) __asm__ __volatile__ ("" : : "r" (value))
+
+void uBench_ReadMemory_CacheRandom(const void* memory, size_t bytes, const CacheRandomPattern* pattern) {
+	const size_t regions = bytes / pattern->region_bytes;
+	const size_t groups = pattern->loads / 4;
+	for (size_t r = 0; r < regions; r++) {
+		const char* region = (const char*) memory + r * pattern->region_bytes;
+		const uint64_t* offsets = pattern->region_offsets(r);
+		for (size_t g = 0; g < groups; g++) {
+			const uint64_t packed = offsets[g];
+			const uint32_t v0 = *(const uint32_t*) (region + (packed & 0xFFFF));
+			const uint32_t v1 = *(const uint32_t*) (region + ((packed >> 16) & 0xFFFF));
+			const uint32_t v2 = *(const uint32_t*) (region + ((packed >> 32) & 0xFFFF));
+			const uint32_t v3 = *(const uint32_t*) (region + (packed >> 48));
+			UBENCH_KEEP(v0);
+			UBENCH_KEEP(v1);
+			UBENCH_KEEP(v2);
+			UBENCH_KEEP(v3);
+		}
+	}
 }
 
 extern "C" void uBench_ReadMemory_Sequential_KNC_NoPrefetch(const void* memory, size_t bytes);
@@ -552,30 +646,66 @@ extern "C" void uBench_UpdateMemory_RandomAtomic30_LLSC_Stride64(const void* mem
 extern "C" void uBench_UpdateMemory_RandomAtomic30_LLSC_Stride128(const void* memory);
 
 void Benchmark_ReadSequential(void (*memory_read_function)(const void*, size_t), const char* function_name, const void* memory, size_t bytes, size_t read_iterations) {
-	const uint64_t start = timer::get_nsecs ();
+	const uint64_t start = timer::get_ticks_acquire();
 	for (size_t iteration = 0; iteration < read_iterations; iteration++) {
 		memory_read_function (memory, bytes);
 	}
-	const uint64_t end = timer::get_nsecs ();
+	const uint64_t end = timer::get_ticks_release();
 	double gb = double (bytes) * double (read_iterations) / 0x1.0p+30;
-	double secs = double (end - start) / 1.0e+9;
+	double secs = timer::ticks_to_secs(timer::elapsed_ticks(start, end));
 	double gbps = gb / secs;
 	printf ("%s" "\t" "%4.03lf\n", function_name, gbps);
 }
 
 void Benchmark_ReadCacheRandom(void (*memory_read_function)(const void*, size_t), const char* function_name, const void* memory, size_t bytes, size_t read_iterations, size_t bytes_per_access) {
-	const uint64_t start = timer::get_nsecs ();
+	const uint64_t start = timer::get_ticks_acquire();
 	for (size_t iteration = 0; iteration < read_iterations; iteration++) {
 		memory_read_function (memory, bytes);
 	}
-	const uint64_t end = timer::get_nsecs();
+	const uint64_t end = timer::get_ticks_release();
 	double gb = double(bytes) * double(read_iterations) / 
 							double (bytes_per_access) / 0x1.0p+30;
-	double secs = double (end - start) / 1.0e+9;
+	double secs = timer::ticks_to_secs(timer::elapsed_ticks(start, end));
 	double gbps = gb / secs;
 	printf("%s" "\t" "%4.03lf\n", function_name, gbps);
 }
 
+/* Parameterised cache-random read. Besides the bandwidth it reports L1D
+	 read misses and prefetches per touched line where the PMU exposes them:
+	 with the working set outside L1, about one miss per line means the
+	 prefetchers did not follow the pattern, while few misses or many
+	 prefetches mean they did and the number is not a random-access number. */
+void Benchmark_ReadCacheRandomPattern(const char* function_name, const void* memory, size_t bytes, size_t read_iterations, const CacheRandomPattern* pattern) {
+	counters::group_t group;
+	counters::open(&group);
+
+	counters::start(&group);
+	const uint64_t start = timer::get_ticks_acquire();
+	for (size_t iteration = 0; iteration < read_iterations; iteration++) {
+		uBench_ReadMemory_CacheRandom (memory, bytes, pattern);
+	}
+	const uint64_t end = timer::get_ticks_release();
+	counters::stop(&group);
+
+	const double regions = double(bytes / pattern->region_bytes) * double(read_iterations);
+	const double lines = regions * double(pattern->lines);
+	double gb = regions * double(pattern->loads) * sizeof(uint32_t) / 0x1.0p+30;
+	double secs = timer::ticks_to_secs(timer::elapsed_ticks(start, end));
+	double gbps = gb / secs;
+	printf("%s" "\t" "%zu" "\t" "%zu" "\t" "%zu" "\t" "%zu" "\t" "%4.03lf", function_name,
+				 bytes, pattern->region_bytes, pattern->lines, pattern->loads, gbps);
+	const int events[2] = { counters::L1D_READ_MISS, counters::L1D_PREFETCH };
+	for (int e = 0; e < 2; e++) {
+		const int64_t count = counters::value(&group, events[e]);
+		if (count < 0)
+			printf("\t" "n/a");
+		else
+			printf("\t" "%4.03lf", double(count) / lines);
+	}
+	printf("\n");
+	counters::close(&group);
+}
+
 void Benchmark_ReadRandom(const char* function_name, const void* memory, size_t bytes, size_t stride, size_t random_iterations) {
 	void (*memory_read_function)(const void*) = 0;
 	#ifdef __arm__
@@ -731,15 +861,15 @@ void Benchmark_ReadRandom(const char* function_name, const void* memory, size_t
 	#endif
 	// First pass to load data to caches (if it fits)
 	memory_read_function(memory);
-	const uint64_t start = timer::get_nsecs();
+	const uint64_t start = timer::get_ticks_acquire();
 	for (size_t i = 0; i < random_iterations; i++) {
 		memory_read_function (memory);
 	}
-	const uint64_t end = timer::get_nsecs();
+	const uint64_t end = timer::get_ticks_release();
 
 	double mega_accesses = (double (bytes / stride) / 1.0e+6) * 
 													double (random_iterations);
-	double secs = double (end - start) / 1.0e+9;
+	double secs = timer::ticks_to_secs(timer::elapsed_ticks(start, end));
 	double maps = mega_accesses / secs;
 	printf("%s" "\t" "%u" "\t" "%4.03lf\n", function_name, unsigned(stride),
 				 maps);
@@ -900,14 +1030,14 @@ void Benchmark_UpdateRandomAtomic(const char* function_name, const void* memory,
 	#endif
 	// First pass to load data to caches (if it fits)
 	memory_read_function(memory);
-	const uint64_t start = timer::get_nsecs();
+	const uint64_t start = timer::get_ticks_acquire();
 	for (size_t i = 0; i < random_iterations; i++) {
 		memory_read_function(memory);
 	}
-	const uint64_t end = timer::get_nsecs();
+	const uint64_t end = timer::get_ticks_release();
 
 	double mega_accesses = (double(bytes / stride) / 1.0e+6) * double(random_iterations);
-	double secs = double(end - start) / 1.0e+9;
+	double secs = timer::ticks_to_secs(timer::elapsed_ticks(start, end));
 	double maps = mega_accesses / secs;
 	printf("%s" "\t" "%u" "\t" "%4.03lf\n", function_name, unsigned(stride), maps);
 }
@@ -919,7 +1049,41 @@ int main(int argc, char** argv) {
 	 * e.g., DRAM test ==> Large; 
 		 Cache test ==> ~2 * lower level cache <= size <= ~1/4 cache size
 	 */
-	const size_t array_length = 1024 * 1024 * 32;
+	/* With a machine profile (see generic/cache-hierarchy) the array is
+		 the smallest power of two at least 8x the last-level cache, which
+		 keeps the pointer-chasing test in DRAM; otherwise 32M elements. */
+	uint32_t array_bits = 25;
+	profile::machine_t machine;
+	profile::init(&machine);
+	if (profile::load(&machine, profile::default_path()) == 0 &&
+			machine.cache_levels != 0) {
+		const size_t target = 8 * profile::cache_bytes(&machine, machine.cache_levels);
+		array_bits = 20;
+		while (array_bits < 28 && (sizeof(uint32_t) << array_bits) < target)
+			array_bits++;
+	}
+	const size_t array_length = size_t(1) << array_bits;
+
+	/* Cache random read pattern: ./ubench [region bytes] [lines] [loads] */
+	size_t cache_region_bytes = 2048;
+	size_t cache_region_lines = 32;
+	size_t cache_region_loads = 512;
+	if (argc > 1)
+		cache_region_bytes = size_t(atol(argv[1]));
+	if (argc > 2)
+		cache_region_lines = size_t(atol(argv[2]));
+	if (argc > 3)
+		cache_region_loads = size_t(atol(argv[3]));
+	if (cache_region_bytes < CacheRandomPattern::line_bytes ||
+			cache_region_bytes > CacheRandomPattern::max_region_bytes ||
+			(cache_region_bytes & (cache_region_bytes - 1)) != 0 ||
+			cache_region_lines < 1 ||
+			cache_region_lines > cache_region_bytes / CacheRandomPattern::line_bytes ||
+			cache_region_loads < 4 || cache_region_loads % 4 != 0) {
+		fprintf(stderr, "usage: %s [region bytes: power of two, 64..65536] "
+						"[lines per region] [loads per region: multiple of 4]\n", argv[0]);
+		return 1;
+	}
 
 	/* Number of iterations */
 	const size_t random_iterations = 32;
@@ -931,6 +1095,8 @@ int main(int argc, char** argv) {
 																				 sizeof (uint32_t));
 	memset(data, 0, array_length * sizeof (uint32_t));
 
+	timer::init();
+
 	#ifndef __ANDROID__
 		printf("OpenMP threads: %d\n", omp_get_max_threads());
 	#endif
@@ -938,8 +1104,12 @@ int main(int argc, char** argv) {
 	/* Choose between these for DRAM random access benchmark
 		 1) pointer chasing random access (UBENCH_TEST_RANDOM_POINTER_CHASING)
 		 2) on-the-fly random access (UBENCH_TEST_RANDOM_READ)
+		 Building with -DUBENCH_TEST_SELECTED -D<test> overrides the choice
+		 made here (see the x64-sequential target in the Makefile).
 	 */
+	#ifndef UBENCH_TEST_SELECTED
 	#define UBENCH_TEST_RANDOM_POINTER_CHASING
+	#endif
 	//~ #define UBENCH_TEST_RANDOM_READ
 
 
@@ -976,10 +1146,10 @@ int main(int argc, char** argv) {
 
 		/* The shifting algorithm used for generating the "pointer chasing" 
 			 array 
-			 25 is the number of bits representing the size of the array 
-		   for array_length = 1024 * 1024 * 32 = 32M ==> 25 bits 
+			 array_bits is the number of bits representing the size of the array
+		   e.g. for array_length = 1024 * 1024 * 32 = 32M ==> 25 bits
 		 */
-		XorShift rng = XorShift(1u, 25);
+		XorShift rng = XorShift(1u, array_bits);
 		uint32_t prevIndex = 1;
 		data[0] = 1;
 		/* initialize the array using the algorithm */
@@ -998,7 +1168,7 @@ int main(int argc, char** argv) {
 			initialVector[i] = (array_length / 12) * i + 1;
 		}
 
-		const uint64_t start = timer::get_nsecs();
+		const uint64_t start = timer::get_ticks_acquire();
 		/* For ARM processors */
 		#ifdef __arm__
 			uBench_ReadMemory_12PointerChasing_LDR(array_length, data, 
@@ -1008,11 +1178,11 @@ int main(int argc, char** argv) {
 			uBench_ReadMemory_12PointerChasing_MOV(array_length, data, 
 																						 initialVector);
 		#endif
-		const uint64_t end = timer::get_nsecs();
+		const uint64_t end = timer::get_ticks_release();
 
 		/* Total number of accesses */
 		double mega_accesses = double(array_length) * 12.0 / 1.0e+6;
-		double secs = double(end - start) / 1.0e+9;
+		double secs = timer::ticks_to_secs(timer::elapsed_ticks(start, end));
 		/* Millions of accesses per second */
 		double maps = mega_accesses / secs;
 
@@ -1076,6 +1246,28 @@ int main(int argc, char** argv) {
 																data, array_length, read_iterations, 4);
 		#endif
 	#endif
+
+	/* Same pattern with a runtime region size, line count and load count
+		 (program arguments) and a fresh permutation per region, once for a
+		 working set resident in each level of the profile and once in DRAM */
+	{
+		CacheRandomPattern pattern(cache_region_bytes, cache_region_lines,
+															 cache_region_loads, 3, 0x2545F491u);
+		printf("\n" "Version" "\t" "Bytes" "\t" "Region" "\t" "Lines" "\t" "Loads"
+					 "\t" "GB/s" "\t" "L1D misses/line" "\t" "L1D prefetches/line" "\n");
+		for (int level = 1; level <= machine.cache_levels + 1; level++) {
+			size_t bytes = profile::resident_bytes(&machine, level, 1,
+																						 array_length * sizeof(uint32_t));
+			if (bytes > array_length * sizeof(uint32_t))
+				bytes = array_length * sizeof(uint32_t);
+			bytes -= bytes % pattern.region_bytes;
+			if (bytes == 0)
+				continue;
+			/* About 2 GiB of loads per working set */
+			const size_t iterations = ((size_t(1) << 31) + bytes - 1) / bytes;
+			Benchmark_ReadCacheRandomPattern("C++", data, bytes, iterations, &pattern);
+		}
+	}
 #endif
 /* =================================================================== */
 
@@ -0,0 +1,222 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Least-squares fits of the time and energy roofline models.
+
+	 For a run that performs W flops and moves Q bytes in time T with energy E,
+		 T = max(W / peak_flops, Q / peak_bandwidth)
+		 E = W * e_flop + Q * e_byte + p_const * T
+	 The time model is fitted in log space on performance W/T against
+	 intensity W/Q, so every point weighs the same whatever its magnitude.
+	 The energy model is linear in its three parameters and is fitted by
+	 ordinary least squares.
+ */
+
+#ifndef UBENCH_ROOFLINE_FIT_H
+#define UBENCH_ROOFLINE_FIT_H
+
+#include <math.h>
+#include <stddef.h>
+
+namespace fit {
+
+	struct sample_t {
+		double flops;
+		double bytes;
+		double secs;
+		/* Joules, < 0 when the run has no energy measurement */
+		double joules;
+	};
+
+	struct time_model_t {
+		double peak_flops;     /* flop/s */
+		double peak_bandwidth; /* byte/s */
+		double r2;             /* of log(performance) */
+		double rms_relative;   /* RMS of predicted/measured - 1 */
+	};
+
+	struct energy_model_t {
+		double joules_per_flop;
+		double joules_per_byte;
+		double constant_watts;
+		double r2;
+		double rms_relative;
+		int samples;
+	};
+
+	inline static double predict_secs(const time_model_t* m, double flops, double bytes) {
+		const double compute = flops / m->peak_flops;
+		const double memory = bytes / m->peak_bandwidth;
+		return compute > memory ? compute : memory;
+	}
+
+	inline static double predict_joules(const energy_model_t* m, double flops, double bytes, double secs) {
+		return flops * m->joules_per_flop + bytes * m->joules_per_byte + m->constant_watts * secs;
+	}
+
+	/** \brief Fit peak flop rate and bandwidth. Samples must be sorted by
+	 * intensity (flops / bytes). Every split of the sweep into a
+	 * bandwidth-bound prefix and a compute-bound suffix is tried; each side
+	 * has a closed-form log-space fit, and the split whose min() model has the
+	 * smallest squared log error wins. Returns -1 with fewer than 2 samples.
+	 */
+	inline static int fit_time(const sample_t* s, int n, time_model_t* m) {
+		if (n < 2)
+			return -1;
+		double best_sse = -1.0;
+		for (int split = 0; split <= n; split++) {
+			/* log B = mean(log P - log I) over the prefix,
+				 log Pmax = mean(log P) over the suffix */
+			double sum_b = 0.0, sum_p = 0.0;
+			for (int i = 0; i < n; i++) {
+				const double perf = s[i].flops / s[i].secs;
+				const double intensity = s[i].flops / s[i].bytes;
+				if (i < split)
+					sum_b += log(perf / intensity);
+				else
+					sum_p += log(perf);
+			}
+			/* With no sample on one side that roof does not bind; the largest
+				 observed rate is the tightest value consistent with the data */
+			time_model_t candidate;
+			candidate.peak_bandwidth = 0.0;
+			candidate.peak_flops = 0.0;
+			for (int i = 0; i < n; i++) {
+				const double bw = s[i].bytes / s[i].secs;
+				const double perf = s[i].flops / s[i].secs;
+				candidate.peak_bandwidth = bw > candidate.peak_bandwidth ? bw : candidate.peak_bandwidth;
+				candidate.peak_flops = perf > candidate.peak_flops ? perf : candidate.peak_flops;
+			}
+			if (split > 0)
+				candidate.peak_bandwidth = exp(sum_b / split);
+			if (split < n)
+				candidate.peak_flops = exp(sum_p / (n - split));
+			double sse = 0.0;
+			for (int i = 0; i < n; i++) {
+				const double e = log(s[i].secs / predict_secs(&candidate, s[i].flops, s[i].bytes));
+				sse += e * e;
+			}
+			if (best_sse < 0.0 || sse < best_sse) {
+				best_sse = sse;
+				*m = candidate;
+			}
+		}
+
+		/* Goodness of fit */
+		double mean = 0.0;
+		for (int i = 0; i < n; i++)
+			mean += log(s[i].flops / s[i].secs);
+		mean /= n;
+		double total = 0.0, relative = 0.0;
+		for (int i = 0; i < n; i++) {
+			const double d = log(s[i].flops / s[i].secs) - mean;
+			const double r = predict_secs(m, s[i].flops, s[i].bytes) / s[i].secs - 1.0;
+			total += d * d;
+			relative += r * r;
+		}
+		m->r2 = total > 0.0 ? 1.0 - best_sse / total : 1.0;
+		m->rms_relative = sqrt(relative / n);
+		return 0;
+	}
+
+	/* Solve the 3x3 system a x = b by Gaussian elimination with partial
+		 pivoting; returns -1 if it is singular */
+	inline static int solve3(double a[3][3], double b[3], double x[3]) {
+		for (int c = 0; c < 3; c++) {
+			int pivot = c;
+			for (int r = c + 1; r < 3; r++) {
+				if (fabs(a[r][c]) > fabs(a[pivot][c]))
+					pivot = r;
+			}
+			if (fabs(a[pivot][c]) < 1e-300)
+				return -1;
+			for (int k = 0; k < 3; k++) {
+				const double t = a[c][k]; a[c][k] = a[pivot][k]; a[pivot][k] = t;
+			}
+			const double t = b[c]; b[c] = b[pivot]; b[pivot] = t;
+			for (int r = c + 1; r < 3; r++) {
+				const double f = a[r][c] / a[c][c];
+				for (int k = c; k < 3; k++)
+					a[r][k] -= f * a[c][k];
+				b[r] -= f * b[c];
+			}
+		}
+		for (int r = 2; r >= 0; r--) {
+			double sum = b[r];
+			for (int k = r + 1; k < 3; k++)
+				sum -= a[r][k] * x[k];
+			x[r] = sum / a[r][r];
+		}
+		return 0;
+	}
+
+	/** \brief Fit energy per flop, energy per byte and constant power over
+	 * the samples that carry energy. Each equation is divided by the
+	 * measured energy so that the fit minimises relative error.
+	 * Returns -1 with fewer than 3 such samples or a degenerate sweep.
+	 */
+	inline static int fit_energy(const sample_t* s, int n, energy_model_t* m) {
+		double ata[3][3] = { { 0.0 } };
+		double atb[3] = { 0.0 };
+		int used = 0;
+		for (int i = 0; i < n; i++) {
+			if (s[i].joules <= 0.0)
+				continue;
+			const double row[3] = { s[i].flops / s[i].joules, s[i].bytes / s[i].joules,
+															s[i].secs / s[i].joules };
+			for (int r = 0; r < 3; r++) {
+				for (int c = 0; c < 3; c++)
+					ata[r][c] += row[r] * row[c];
+				atb[r] += row[r];
+			}
+			used++;
+		}
+		m->samples = used;
+		if (used < 3)
+			return -1;
+		double x[3];
+		if (solve3(ata, atb, x) != 0)
+			return -1;
+		m->joules_per_flop = x[0];
+		m->joules_per_byte = x[1];
+		m->constant_watts = x[2];
+
+		double mean = 0.0;
+		for (int i = 0; i < n; i++) {
+			if (s[i].joules > 0.0)
+				mean += s[i].joules;
+		}
+		mean /= used;
+		double sse = 0.0, total = 0.0, relative = 0.0;
+		for (int i = 0; i < n; i++) {
+			if (s[i].joules <= 0.0)
+				continue;
+			const double predicted = predict_joules(m, s[i].flops, s[i].bytes, s[i].secs);
+			sse += (predicted - s[i].joules) * (predicted - s[i].joules);
+			total += (s[i].joules - mean) * (s[i].joules - mean);
+			relative += (predicted / s[i].joules - 1.0) * (predicted / s[i].joules - 1.0);
+		}
+		m->r2 = total > 0.0 ? 1.0 - sse / total : 1.0;
+		m->rms_relative = sqrt(relative / used);
+		return 0;
+	}
+
+}
+
+#endif /* UBENCH_ROOFLINE_FIT_H */
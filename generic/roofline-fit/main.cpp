@@ -0,0 +1,310 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "profile.h"
+#include "fit.h"
+
+#define MAX_SAMPLES 4096
+#define MAX_COLUMNS 32
+
+/* Columns of a sweep table that the fit uses; the intensity benchmarks
+	 print Flop/byte, Secs, GB/s and GFLOPS, energy is optional */
+struct columns_t {
+	int intensity;
+	int secs;
+	int gbps;
+	int gflops;
+	int joules;
+	int watts;
+	int threads;
+	int level;
+};
+
+/* =================================================================== */
+/* Parse program input */
+void usage(int argc, char** argv, const char** input, const char** path)
+{
+	if (argc < 2 || strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
+		fprintf(stderr, "usage: %s <sweep results | -> [profile path]\n", argv[0]);
+		exit(argc < 2);
+	}
+	*input = argv[1];
+	*path = (argc > 2) ? argv[2] : profile::default_path();
+}
+/* =================================================================== */
+
+
+/* =================================================================== */
+/* Split a line on tabs and spaces in place */
+int split_fields(char* line, char** fields, int max)
+{
+	int count = 0;
+	for (char* token = strtok(line, " \t\r\n"); token != NULL && count < max;
+			 token = strtok(NULL, " \t\r\n"))
+		fields[count++] = token;
+	return count;
+}
+
+/* A header row names the columns; any row containing "Flop/byte" is one */
+int parse_header(char** fields, int count, columns_t* c)
+{
+	c->intensity = c->secs = c->gbps = c->gflops = c->joules = c->watts = c->threads = -1;
+	c->level = -1;
+	for (int i = 0; i < count; i++) {
+		if (strcmp(fields[i], "Flop/byte") == 0) c->intensity = i;
+		else if (strcmp(fields[i], "Secs") == 0) c->secs = i;
+		else if (strcmp(fields[i], "GB/s") == 0) c->gbps = i;
+		else if (strcmp(fields[i], "GFLOPS") == 0) c->gflops = i;
+		else if (strcmp(fields[i], "Joules") == 0) c->joules = i;
+		else if (strcmp(fields[i], "Watts") == 0) c->watts = i;
+		else if (strcmp(fields[i], "Threads") == 0) c->threads = i;
+		else if (strcmp(fields[i], "Level") == 0) c->level = i;
+	}
+	return (c->intensity >= 0 && c->secs >= 0 && (c->gbps >= 0 || c->gflops >= 0)) ? 0 : -1;
+}
+
+/* "L1".."L<N>" -> 1..N; "DRAM", anything else or no Level column -> 0 */
+int parse_level(const char* text)
+{
+	if ((text[0] == 'L' || text[0] == 'l') && text[1] >= '1' && text[1] <= '9') {
+		const int level = atoi(text + 1);
+		return level <= PROFILE_MAX_LEVELS ? level : 0;
+	}
+	return 0;
+}
+
+/* Rebuild flops and bytes of one run from its rates and time */
+int parse_row(char** fields, int count, const columns_t* c, fit::sample_t* s, int* threads,
+							int* level)
+{
+	const int needed = std::max(std::max(c->intensity, c->secs), std::max(c->gbps, c->gflops));
+	if (count <= needed)
+		return -1;
+	char* end;
+	const double intensity = strtod(fields[c->intensity], &end);
+	if (end == fields[c->intensity] || intensity <= 0.0)
+		return -1;
+	s->secs = atof(fields[c->secs]);
+	if (s->secs <= 0.0)
+		return -1;
+	if (c->gflops >= 0) {
+		s->flops = atof(fields[c->gflops]) * 1.0e+9 * s->secs;
+		s->bytes = s->flops / intensity;
+	} else {
+		s->bytes = atof(fields[c->gbps]) * 1.0e+9 * s->secs;
+		s->flops = s->bytes * intensity;
+	}
+	s->joules = -1.0;
+	if (c->joules >= 0 && c->joules < count)
+		s->joules = atof(fields[c->joules]);
+	else if (c->watts >= 0 && c->watts < count)
+		s->joules = atof(fields[c->watts]) * s->secs;
+	if (c->threads >= 0 && c->threads < count && atoi(fields[c->threads]) > *threads)
+		*threads = atoi(fields[c->threads]);
+	*level = (c->level >= 0 && c->level < count) ? parse_level(fields[c->level]) : 0;
+	return 0;
+}
+
+int read_samples(FILE* f, fit::sample_t* samples, int* levels, int max, int* threads)
+{
+	char line[4096];
+	char* fields[MAX_COLUMNS];
+	columns_t columns;
+	int have_header = 0;
+	int n = 0;
+	while (fgets(line, sizeof(line), f) != NULL && n < max) {
+		const int count = split_fields(line, fields, MAX_COLUMNS);
+		if (count == 0)
+			continue;
+		columns_t c;
+		if (parse_header(fields, count, &c) == 0) {
+			columns = c;
+			have_header = 1;
+			continue;
+		}
+		/* Timer banners, progress messages, etc. are skipped */
+		if (have_header && parse_row(fields, count, &columns, &samples[n], threads, &levels[n]) == 0)
+			n++;
+	}
+	return n;
+}
+
+bool by_intensity(const fit::sample_t& a, const fit::sample_t& b)
+{
+	return a.flops / a.bytes < b.flops / b.bytes;
+}
+/* =================================================================== */
+
+
+/* =================================================================== */
+/* Fit the runs of one memory level, print residuals and parameters */
+struct level_fit_t {
+	fit::time_model_t time;
+	fit::energy_model_t energy;
+	int have_energy;
+};
+
+int fit_level(fit::sample_t* samples, int n, const char* label, level_fit_t* f)
+{
+	std::sort(samples, samples + n, by_intensity);
+	if (fit::fit_time(samples, n, &f->time) != 0) {
+		fprintf(stderr, "%s: need at least 2 runs with Flop/byte, Secs and GB/s or GFLOPS; "
+						"found %d\n", label, n);
+		return -1;
+	}
+	f->have_energy = fit::fit_energy(samples, n, &f->energy) == 0;
+	const fit::time_model_t* time = &f->time;
+	const fit::energy_model_t* energy = &f->energy;
+
+	/* Per-run residuals */
+	printf("%s\n", label);
+	printf("Flop/byte" "\t" "GFLOPS" "\t" "Model" "\t" "Time err %%");
+	if (f->have_energy)
+		printf("\t" "Joules" "\t" "Model" "\t" "Energy err %%");
+	printf("\n");
+	for (int i = 0; i < n; i++) {
+		const fit::sample_t* s = &samples[i];
+		const double predicted = fit::predict_secs(time, s->flops, s->bytes);
+		printf("%4.03lf" "\t" "%4.03lf" "\t" "%4.03lf" "\t" "%+4.02lf", s->flops / s->bytes,
+					 s->flops / s->secs / 1.0e+9, s->flops / predicted / 1.0e+9,
+					 100.0 * (predicted / s->secs - 1.0));
+		if (f->have_energy && s->joules > 0.0) {
+			const double joules = fit::predict_joules(energy, s->flops, s->bytes, s->secs);
+			printf("\t" "%4.03lf" "\t" "%4.03lf" "\t" "%+4.02lf", s->joules, joules,
+						 100.0 * (joules / s->joules - 1.0));
+		}
+		printf("\n");
+	}
+
+	/* Model parameters */
+	printf("\n");
+	printf("Peak performance:  %4.03lf GFLOPS\n", time->peak_flops / 1.0e+9);
+	printf("Peak bandwidth:    %4.03lf GB/s\n", time->peak_bandwidth / 1.0e+9);
+	printf("Ridge point:       %4.03lf flop/byte\n", time->peak_flops / time->peak_bandwidth);
+	printf("Time fit:          R^2 %4.04lf, RMS error %4.02lf %%\n", time->r2,
+				 100.0 * time->rms_relative);
+	if (f->have_energy) {
+		printf("Energy per flop:   %4.03lf pJ\n", energy->joules_per_flop * 1.0e+12);
+		printf("Energy per byte:   %4.03lf pJ\n", energy->joules_per_byte * 1.0e+12);
+		printf("Constant power:    %4.03lf W\n", energy->constant_watts);
+		printf("Energy fit:        R^2 %4.04lf, RMS error %4.02lf %% (%d runs)\n", energy->r2,
+					 100.0 * energy->rms_relative, energy->samples);
+		if (energy->joules_per_flop < 0.0 || energy->joules_per_byte < 0.0 ||
+				energy->constant_watts < 0.0)
+			fprintf(stderr, "Warning: %s: negative energy term; the sweep may not span both "
+							"regimes\n", label);
+	} else {
+		fprintf(stderr, "%s: no energy (Joules or Watts column) in at least 3 runs; energy model "
+						"not fitted\n", label);
+	}
+	printf("\n");
+	return 0;
+}
+/* =================================================================== */
+
+
+int main(int argc, char** argv)
+{
+	const char* input;
+	const char* path;
+	usage(argc, argv, &input, &path);
+
+	FILE* f = strcmp(input, "-") == 0 ? stdin : fopen(input, "r");
+	if (f == NULL) {
+		fprintf(stderr, "Cannot open %s\n", input);
+		return 1;
+	}
+	fit::sample_t* samples = (fit::sample_t*) malloc(MAX_SAMPLES * sizeof(fit::sample_t));
+	fit::sample_t* group = (fit::sample_t*) malloc(MAX_SAMPLES * sizeof(fit::sample_t));
+	int* levels = (int*) malloc(MAX_SAMPLES * sizeof(int));
+	int threads = 0;
+	const int n = read_samples(f, samples, levels, MAX_SAMPLES, &threads);
+	if (f != stdin)
+		fclose(f);
+
+	profile::machine_t m;
+	profile::init(&m);
+	profile::load(&m, path);
+	m.roofline.threads = threads;
+
+	/* One roofline per memory level in the sweep: DRAM (or rows without a
+		 Level column) sets the main parameters, cache levels their own
+		 bandwidth and energy per byte */
+	int have_dram = 0;
+	for (int i = 0; i < n; i++)
+		have_dram |= levels[i] == 0;
+	int fitted = 0;
+	for (int level = 0; level <= PROFILE_MAX_LEVELS; level++) {
+		int count = 0;
+		for (int i = 0; i < n; i++) {
+			if (levels[i] == level)
+				group[count++] = samples[i];
+		}
+		if (count == 0)
+			continue;
+		char label[16];
+		if (level == 0)
+			snprintf(label, sizeof(label), "DRAM");
+		else
+			snprintf(label, sizeof(label), "L%d", level);
+		level_fit_t r;
+		if (fit_level(group, count, label, &r) != 0)
+			continue;
+		fitted++;
+		if (level == 0) {
+			m.roofline.peak_gflops = r.time.peak_flops / 1.0e+9;
+			m.roofline.peak_gbps = r.time.peak_bandwidth / 1.0e+9;
+			m.roofline.time_r2 = r.time.r2;
+			if (r.have_energy) {
+				m.roofline.flop_pj = r.energy.joules_per_flop * 1.0e+12;
+				m.roofline.byte_pj = r.energy.joules_per_byte * 1.0e+12;
+				m.roofline.constant_w = r.energy.constant_watts;
+				m.roofline.energy_r2 = r.energy.r2;
+			}
+		} else {
+			m.roofline.level_gbps[level - 1] = r.time.peak_bandwidth / 1.0e+9;
+			if (r.have_energy)
+				m.roofline.level_byte_pj[level - 1] = r.energy.joules_per_byte * 1.0e+12;
+			/* Without DRAM runs the compute peak comes from the caches */
+			if (!have_dram && r.time.peak_flops / 1.0e+9 > m.roofline.peak_gflops)
+				m.roofline.peak_gflops = r.time.peak_flops / 1.0e+9;
+		}
+	}
+	if (fitted == 0) {
+		fprintf(stderr, "No roofline fitted from %d runs\n", n);
+		return 1;
+	}
+
+	/* Merge into the machine profile, keeping what other tools wrote */
+	if (profile::save(&m, path) != 0) {
+		fprintf(stderr, "Cannot write profile %s\n", path);
+		return 1;
+	}
+	fprintf(stderr, "Profile written to %s\n", path);
+
+	free(samples);
+	free(group);
+	free(levels);
+	return 0;
+}
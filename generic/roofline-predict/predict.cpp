@@ -0,0 +1,98 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "timer.h"
+#include "roofline.h"
+
+/* Queries per timed batch in benchmark mode */
+#define BATCH 100000
+
+/* =================================================================== */
+/* Parse program input */
+void usage(int argc, char** argv)
+{
+	if (argc < 2 || strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
+		fprintf(stderr, "usage: %s <flops> <bytes> [threads] [cache level, 0 = DRAM]\n"
+						"       %s --bench\n"
+						"The profile is $UBENCH_PROFILE or ./machine.profile\n", argv[0], argv[0]);
+		exit(argc < 2);
+	}
+}
+/* =================================================================== */
+
+
+/* Batch throughput over a spread of intensities and thread counts */
+int bench(const roofline::model_t* model)
+{
+	roofline::query_t* q = (roofline::query_t*) malloc(BATCH * sizeof(roofline::query_t));
+	roofline::prediction_t* p = (roofline::prediction_t*) malloc(BATCH * sizeof(roofline::prediction_t));
+	for (int i = 0; i < BATCH; i++) {
+		q[i].flops = 1.0e+9 * (1 + i % 97);
+		q[i].bytes = 1.0e+8 * (1 + i % 89);
+		q[i].threads = 1 + i % 64;
+		q[i].level = i % ROOFLINE_LEVELS;
+	}
+	timer::init();
+	uint64_t best = 0;
+	for (int trial = 0; trial < 10; trial++) {
+		const uint64_t start = timer::get_ticks_acquire();
+		roofline::predict_batch(model, q, p, BATCH);
+		const uint64_t end = timer::get_ticks_release();
+		const uint64_t ticks = timer::elapsed_ticks(start, end);
+		best = (trial == 0 || ticks < best) ? ticks : best;
+	}
+	const double secs = timer::ticks_to_secs(best);
+	printf("Batch of %d: %.6lf secs, %.0lf queries/ms\n", BATCH, secs, BATCH / secs / 1.0e+3);
+	free(q);
+	free(p);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	usage(argc, argv);
+
+	roofline::model_t model;
+	if (roofline::load(&model, profile::default_path()) != 0) {
+		fprintf(stderr, "No fitted roofline in %s (run roofline-fit first)\n",
+						profile::default_path());
+		return 1;
+	}
+
+	if (strcmp(argv[1], "--bench") == 0)
+		return bench(&model);
+
+	roofline::query_t q;
+	q.flops = atof(argv[1]);
+	q.bytes = (argc > 2) ? atof(argv[2]) : 0.0;
+	q.threads = (argc > 3) ? atoi(argv[3]) : model.threads;
+	q.level = (argc > 4) ? atoi(argv[4]) : 0;
+	const roofline::prediction_t p = roofline::predict(&model, &q);
+
+	printf("Time:   %.9lf secs (%s-bound)\n", p.secs,
+				 p.bound == roofline::BOUND_COMPUTE ? "compute" : "memory");
+	if (model.has_energy) {
+		printf("Power:  %.3lf W\n", p.watts);
+		printf("Energy: %.6lf J\n", p.joules);
+	}
+	return 0;
+}
@@ -0,0 +1,81 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <string.h>
+#include "roofline.h"
+
+namespace roofline {
+
+	int from_profile(model_t* model, const profile::machine_t* m) {
+		memset(model, 0, sizeof(*model));
+		const profile::roofline_t* r = &m->roofline;
+		if (r->peak_gflops <= 0.0 || r->peak_gbps <= 0.0)
+			return -1;
+		model->threads = r->threads > 0 ? r->threads : 1;
+		model->flops_per_sec = r->peak_gflops * 1.0e+9;
+		model->bytes_per_sec[0] = r->peak_gbps * 1.0e+9;
+		model->has_energy = r->flop_pj != 0.0 || r->byte_pj != 0.0 || r->constant_w != 0.0;
+		model->joules_per_flop = r->flop_pj * 1.0e-12;
+		model->joules_per_byte[0] = r->byte_pj * 1.0e-12;
+		for (int i = 1; i < ROOFLINE_LEVELS; i++) {
+			const double gbps = r->level_gbps[i - 1];
+			const double pj = r->level_byte_pj[i - 1];
+			model->bytes_per_sec[i] = gbps > 0.0 ? gbps * 1.0e+9 : model->bytes_per_sec[0];
+			model->joules_per_byte[i] = pj != 0.0 ? pj * 1.0e-12 : model->joules_per_byte[0];
+		}
+		model->constant_watts = r->constant_w;
+		return 0;
+	}
+
+	int load(model_t* model, const char* path) {
+		profile::machine_t m;
+		profile::init(&m);
+		if (profile::load(&m, path) != 0)
+			return -1;
+		return from_profile(model, &m);
+	}
+
+	static inline prediction_t evaluate(const model_t* model, const query_t* q) {
+		prediction_t p;
+		int threads = q->threads < 1 ? 1 : q->threads;
+		threads = threads < model->threads ? threads : model->threads;
+		const double share = double(threads) / double(model->threads);
+		const int level = (q->level > 0 && q->level < ROOFLINE_LEVELS) ? q->level : 0;
+
+		const double compute = q->flops / (model->flops_per_sec * share);
+		const double memory = q->bytes / (model->bytes_per_sec[level] * share);
+		p.bound = compute >= memory ? BOUND_COMPUTE : BOUND_MEMORY;
+		p.secs = compute >= memory ? compute : memory;
+		p.joules = q->flops * model->joules_per_flop + q->bytes * model->joules_per_byte[level] +
+			model->constant_watts * p.secs;
+		p.watts = p.secs > 0.0 ? p.joules / p.secs : 0.0;
+		return p;
+	}
+
+	prediction_t predict(const model_t* model, const query_t* query) {
+		return evaluate(model, query);
+	}
+
+	void predict_batch(const model_t* model, const query_t* queries,
+										 prediction_t* out, size_t count) {
+		for (size_t i = 0; i < count; i++)
+			out[i] = evaluate(model, &queries[i]);
+	}
+
+}
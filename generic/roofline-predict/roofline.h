@@ -0,0 +1,101 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Roofline prediction library.
+
+	 Answers "how long, at what power and for how much energy" for a kernel
+	 described by its flops, bytes, thread count and (optionally) the cache
+	 level its working set lives in, using the parameters that
+	 ../roofline-fit and ../cache-hierarchy store in the machine profile.
+
+		 roofline::model_t model;
+		 roofline::load(&model, "machine.profile");
+		 roofline::query_t q = { flops, bytes, threads, 0 };
+		 roofline::prediction_t p = roofline::predict(&model, &q);
+
+	 Threads: the profile's rates were measured with roofline.threads
+	 threads. A query with fewer threads gets a proportional share of the
+	 flop rate and bandwidth; more threads than that gives no further gain.
+	 Level: 0 means DRAM; 1..N use the bandwidth and energy per byte measured
+	 with a working set resident in that cache level, or the DRAM figures if
+	 they are unknown.
+ */
+
+#ifndef UBENCH_ROOFLINE_H
+#define UBENCH_ROOFLINE_H
+
+#include <stddef.h>
+#include "profile.h"
+
+namespace roofline {
+
+	/* Index 0 is DRAM, 1..PROFILE_MAX_LEVELS the cache levels */
+	#define ROOFLINE_LEVELS (PROFILE_MAX_LEVELS + 1)
+
+	struct model_t {
+		int threads;
+		/* Whole-machine rates at `threads` threads */
+		double flops_per_sec;
+		double bytes_per_sec[ROOFLINE_LEVELS];
+		double joules_per_flop;
+		double joules_per_byte[ROOFLINE_LEVELS];
+		double constant_watts;
+		int has_energy;
+	};
+
+	struct query_t {
+		double flops;
+		double bytes;
+		int threads;
+		int level;
+	};
+
+	enum bound_t {
+		BOUND_COMPUTE,
+		BOUND_MEMORY
+	};
+
+	struct prediction_t {
+		double secs;
+		/* Average power and energy; 0 without an energy model */
+		double watts;
+		double joules;
+		int bound;
+	};
+
+	/** \brief Build a model from a profile already in memory.
+	 * Returns -1 if the profile has no fitted roofline.
+	 */
+	int from_profile(model_t* model, const profile::machine_t* m);
+
+	/** \brief Load a profile file and build the model from it.
+	 * Returns -1 if the file cannot be read or has no fitted roofline.
+	 */
+	int load(model_t* model, const char* path);
+
+	/** \brief Predict one query. */
+	prediction_t predict(const model_t* model, const query_t* query);
+
+	/** \brief Predict `count` queries into `out`. */
+	void predict_batch(const model_t* model, const query_t* queries,
+										 prediction_t* out, size_t count);
+
+}
+
+#endif /* UBENCH_ROOFLINE_H */
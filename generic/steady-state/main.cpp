@@ -0,0 +1,242 @@
+/*
+MIT License
+Copyright 2020 Jee W. Choi, Marat Dukhan, and Xing Liu
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in 
+the Software without restriction, including without limitation the rights to use, 
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the 
+Software, and to permit persons to whom the Software is furnished to do so, subject 
+to the following conditions:
+The above copyright notice and this permission notice shall be included in all 
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE 
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Steady-state runner: repeats one intensity kernel on every thread until
+	 its rate and package power settle (../common/steady.h), then reports
+	 the time to steady state and the turbo and sustained rates. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <malloc.h>
+#include <string.h>
+#include <unistd.h>
+#include <omp.h>
+#include "timer.h"
+#include "profile.h"
+#include "cpufreq.h"
+#include "steady.h"
+#include "intensity.h"
+
+#define MAX_CPUS 1024
+
+struct options_t {
+	int type;
+	int mads;
+	/* Memory level of the arrays: 1..N caches, N+1 (or 0 here) DRAM */
+	int level;
+	steady::options_t steady;
+};
+
+/* =================================================================== */
+/* Parse program input */
+void usage(int argc, char** argv, options_t* o)
+{
+	o->type = intensity::TYPE_DOUBLE;
+	o->mads = 16;
+	o->level = 0;
+	steady::default_options(&o->steady);
+	int c;
+	while ((c = getopt(argc, argv, "t:m:l:e:w:s:n:c:h")) != -1) {
+		switch (c) {
+			case 't':
+				o->type = strcmp(optarg, "single") == 0 ? intensity::TYPE_FLOAT :
+					strcmp(optarg, "double") == 0 ? intensity::TYPE_DOUBLE : -1;
+				break;
+			case 'm': o->mads = atoi(optarg); break;
+			case 'l':
+				if (strcmp(optarg, "dram") == 0)
+					o->level = 0;
+				else if ((optarg[0] == 'l' || optarg[0] == 'L') && atoi(optarg + 1) >= 1 &&
+								 atoi(optarg + 1) <= PROFILE_MAX_LEVELS)
+					o->level = atoi(optarg + 1);
+				else
+					o->level = -1;
+				break;
+			case 'e': o->steady.tolerance = atof(optarg) / 100.0; break;
+			case 'w': o->steady.window = atoi(optarg); break;
+			case 's': o->steady.sample_secs = atof(optarg) / 1.0e+3; break;
+			case 'n': o->steady.min_secs = atof(optarg); break;
+			case 'c': o->steady.cap_secs = atof(optarg); break;
+			default:
+				fprintf(stderr,
+								"usage: %s [-t single|double] [-m multiply-adds per element] [-l l1|l2|l3|dram]\n"
+								"          [-e tolerance %%] [-w window samples] [-s sample ms] [-n min secs] [-c cap secs]\n",
+								argv[0]);
+				exit(c != 'h');
+		}
+	}
+	if (o->type < 0 || o->level < 0 || o->steady.window < 2 || o->steady.sample_secs <= 0.0) {
+		fprintf(stderr, "Invalid type, level, window or sample time\n");
+		exit(1);
+	}
+}
+/* =================================================================== */
+
+
+/* =================================================================== */
+/* One sample: every thread runs `passes` kernel passes over its array.
+	 Returns the flops. */
+struct step_t {
+	const intensity::entry_t* kernel;
+	void** data;
+	size_t length;
+	size_t passes;
+	int threads;
+
+	double operator()() {
+		#pragma omp parallel num_threads(threads)
+		{
+			const int tid = omp_get_thread_num();
+			uint8_t result[16 * 64] __attribute__((aligned(64)));
+			for (size_t pass = 0; pass < passes; pass++)
+				kernel->function(data[tid], length, result);
+		}
+		return 2.0 * double(length) * double(passes) * kernel->mads * threads;
+	}
+};
+
+/* The CPU frequency right after each sample, read outside its timing */
+struct frequency_t {
+	unsigned long* khz;
+
+	void operator()(int sample) {
+		khz[sample] = cpufreq::average_khz("/sys", MAX_CPUS);
+	}
+};
+/* =================================================================== */
+
+
+int main(int argc, char** argv)
+{
+	options_t o;
+	usage(argc, argv, &o);
+
+	timer::init();
+
+	const int threads = omp_get_max_threads();
+	profile::machine_t machine;
+	profile::init(&machine);
+	profile::load(&machine, profile::default_path());
+	profile::fill_caches(&machine);
+	if (o.level == 0)
+		o.level = machine.cache_levels + 1;
+
+	const int isa = intensity::best_isa(o.type);
+	const intensity::entry_t* k = intensity::select(isa, o.type, o.mads, 8);
+	if (k == NULL) {
+		fprintf(stderr, "No %s kernel with %d multiply-adds per element\n",
+						intensity::type_name(o.type), o.mads);
+		return 1;
+	}
+	const size_t element_bytes = intensity::type_bytes(o.type);
+	const size_t per_iteration = size_t(k->lanes) * size_t(k->accumulators);
+	size_t length = profile::resident_bytes(&machine, o.level, threads, size_t(256) << 20) / element_bytes;
+	length -= length % per_iteration;
+	if (length == 0)
+		length = per_iteration;
+	const size_t bytes = length * element_bytes;
+	/* GB/s follows from GFLOPS: every element is read once per pass */
+	const double flops_per_byte = 2.0 * k->mads / double(element_bytes);
+
+	void** data = (void**) calloc(threads, sizeof(void*));
+	#pragma omp parallel num_threads(threads)
+	{
+		/* First touch from the thread that reads the array */
+		const int tid = omp_get_thread_num();
+		data[tid] = memalign(64, bytes);
+		memset(data[tid], 0, bytes);
+	}
+
+	steady::sample_t* samples = (steady::sample_t*) calloc(STEADY_MAX_SAMPLES, sizeof(steady::sample_t));
+	unsigned long* khz = (unsigned long*) calloc(STEADY_MAX_SAMPLES, sizeof(unsigned long));
+	step_t step = { k, data, length, 1, threads };
+	frequency_t frequency = { khz };
+
+	/* Size a sample: double the passes until a call takes an eighth of
+		 the sample time (the first call also warms the level) */
+	for (;;) {
+		const uint64_t start = timer::get_ticks_acquire();
+		step();
+		const double secs = timer::ticks_to_secs(timer::elapsed_ticks(start, timer::get_ticks_release()));
+		if (secs >= o.steady.sample_secs / 8.0) {
+			step.passes = size_t(double(step.passes) * o.steady.sample_secs / secs) + 1;
+			break;
+		}
+		step.passes *= 2;
+	}
+
+	fprintf(stderr, "%s, %s, %d MADs, %d threads, %zu KB per thread, %zu passes per sample\n",
+					intensity::type_name(o.type), intensity::isa_name(isa), o.mads, threads, bytes >> 10,
+					step.passes);
+	/* Stopping before the power-limit window ends would report the turbo
+		 plateau as the sustained rate */
+	const double least = steady::min_secs(&o.steady);
+	if (least >= o.steady.cap_secs)
+		fprintf(stderr, "Warning: the %.0f secs cap is not past the %.0f secs minimum run time; "
+						"the sustained figures may still be turbo\n", o.steady.cap_secs, least);
+	else
+		fprintf(stderr, "Running for at least %.0f secs\n", least);
+
+	const int count = steady::run(step, frequency, &o.steady, samples, STEADY_MAX_SAMPLES);
+	steady::result_t r;
+	steady::analyse(samples, count, &o.steady, &r);
+
+	printf("Sample" "\t" "Secs" "\t" "GB/s" "\t" "GFLOPS" "\t" "Watts" "\t" "MHz" "\t" "Phase" "\n");
+	for (int i = 0; i < count; i++) {
+		printf("%d" "\t" "%4.03lf" "\t" "%4.03lf" "\t" "%4.03lf" "\t", i, samples[i].end,
+					 samples[i].rate / flops_per_byte / 1.0e+9, samples[i].rate / 1.0e+9);
+		if (samples[i].watts >= 0.0)
+			printf("%4.02lf", samples[i].watts);
+		else
+			printf("n/a");
+		if (khz[i] != 0)
+			printf("\t" "%lu", khz[i] / 1000);
+		else
+			printf("\t" "n/a");
+		printf("\t" "%s" "\n", !r.converged ? "-" : i < r.steady_index ? "turbo" : "sustained");
+	}
+
+	printf("\n" "Converged" "\t" "Steady secs" "\t" "Turbo GFLOPS" "\t" "Sustained GFLOPS" "\t"
+				 "Turbo GB/s" "\t" "Sustained GB/s" "\t" "Turbo Watts" "\t" "Sustained Watts" "\n");
+	if (r.converged)
+		printf("yes" "\t" "%4.03lf", r.steady_secs);
+	else
+		printf("no" "\t" "n/a");
+	printf("\t" "%4.03lf" "\t" "%4.03lf" "\t" "%4.03lf" "\t" "%4.03lf",
+				 r.turbo_rate / 1.0e+9, r.sustained_rate / 1.0e+9,
+				 r.turbo_rate / flops_per_byte / 1.0e+9, r.sustained_rate / flops_per_byte / 1.0e+9);
+	if (r.turbo_watts >= 0.0)
+		printf("\t" "%4.02lf" "\t" "%4.02lf" "\n", r.turbo_watts, r.sustained_watts);
+	else
+		printf("\t" "n/a" "\t" "n/a" "\n");
+	if (!r.converged)
+		fprintf(stderr, "Not steady within %.0f secs; sustained figures are the last window\n",
+						o.steady.cap_secs);
+
+	#pragma omp parallel num_threads(threads)
+	{
+		free(data[omp_get_thread_num()]);
+	}
+	free(data);
+	free(samples);
+	free(khz);
+	return 0;
+}